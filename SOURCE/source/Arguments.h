@@ -0,0 +1,74 @@
+#pragma once
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace dae
+{
+	//the "--flag value" command lines of the modes that run without a window
+	namespace Arguments
+	{
+		//what a mode made of one flag and its value
+		enum class Result
+		{
+			Applied,
+			Unknown, //not a flag of the mode, or a value it doesn't take
+			Rejected //the mode already printed what's wrong with the value
+		};
+
+		//the non-empty parts of a list like "a,b,c"
+		inline std::vector<std::string> Split(const std::string& text, char separator)
+		{
+			std::vector<std::string> parts{};
+			std::stringstream stream{ text };
+			for (std::string part{}; std::getline(stream, part, separator);)
+			{
+				if (!part.empty())
+					parts.push_back(part);
+			}
+			return parts;
+		}
+
+		/**
+		 * \brief Hands every flag from firstArgument on to apply(argument, value), which returns a Result
+		 * A value apply can't convert (std::stoi and the like throw) counts as invalid
+		 * \return false at the first flag without a value, that's unknown, rejected or invalid; after printing why
+		 */
+		template<typename Apply>
+		bool Parse(int argc, char* args[], int firstArgument, const Apply& apply)
+		{
+			for (int idx{ firstArgument }; idx < argc; ++idx)
+			{
+				const std::string argument{ args[idx] };
+				if (idx + 1 >= argc)
+				{
+					std::cout << "Missing value for " << argument << "\n";
+					return false;
+				}
+
+				const std::string value{ args[++idx] };
+				try
+				{
+					switch (apply(argument, value))
+					{
+					case Result::Applied:
+						break;
+					case Result::Unknown:
+						std::cout << "Unknown argument " << argument << "\n";
+						return false;
+					default:
+						return false;
+					}
+				}
+				catch (const std::exception&)
+				{
+					std::cout << "Invalid value " << value << " for " << argument << "\n";
+					return false;
+				}
+			}
+			return true;
+		}
+	}
+}
@@ -103,4 +103,68 @@ namespace dae
 			return smith2 * smith1;
 		}
 	}
-}
\ No newline at end of file
+}
+#if defined(MATH_AVX2)
+namespace dae
+{
+	/**
+	 * \brief The Cook-Torrance and Phong terms above for 8 (hit, light) pairs at once, every argument holds one component of 8 samples (SoA)
+	 * Roughness dependent factors come in precomputed (see Material), so they're not squared again per call
+	 */
+	namespace BRDF8
+	{
+		inline __m256 Dot(__m256 ax, __m256 ay, __m256 az, __m256 bx, __m256 by, __m256 bz)
+		{
+			return _mm256_fmadd_ps(az, bz, _mm256_fmadd_ps(ay, by, _mm256_mul_ps(ax, bx)));
+		}
+
+		/**
+		 * \param ks Specular Reflection Coefficient
+		 * \param exp Phong Exponent
+		 * \return Phong Specular Reflection (same for every channel)
+		 */
+		inline __m256 Phong(__m256 ks, __m256 exp, __m256 lx, __m256 ly, __m256 lz, __m256 vx, __m256 vy, __m256 vz, __m256 nx, __m256 ny, __m256 nz)
+		{
+			const __m256 twoDot{ _mm256_add_ps(Dot(nx, ny, nz, lx, ly, lz), Dot(nx, ny, nz, lx, ly, lz)) };
+			const __m256 rx{ _mm256_fnmadd_ps(twoDot, nx, lx) };
+			const __m256 ry{ _mm256_fnmadd_ps(twoDot, ny, ly) };
+			const __m256 rz{ _mm256_fnmadd_ps(twoDot, nz, lz) };
+
+			alignas(32) float angles[8];
+			alignas(32) float exponents[8];
+			_mm256_store_ps(angles, _mm256_max_ps(_mm256_setzero_ps(), Dot(rx, ry, rz, vx, vy, vz)));
+			_mm256_store_ps(exponents, exp);
+
+			//no pow in AVX2, every lane goes through the same powf the scalar BRDF uses
+			for (int lane{}; lane < 8; ++lane)
+			{
+				angles[lane] = std::powf(angles[lane], exponents[lane]);
+			}
+			return _mm256_mul_ps(ks, _mm256_load_ps(angles));
+		}
+
+		//Schlick, 1 - dot(h, v) to the fifth, for one channel
+		inline __m256 FresnelFunction_Schlick(__m256 schlick5, __m256 f0)
+		{
+			return _mm256_fmadd_ps(_mm256_sub_ps(_mm256_set1_ps(1.f), f0), schlick5, f0);
+		}
+
+		//Trowbridge-Reitz GGX, a = squared roughness of the material
+		inline __m256 NormalDistribution_GGX(__m256 dotNH, __m256 a)
+		{
+			const __m256 one{ _mm256_set1_ps(1.f) };
+			const __m256 base{ _mm256_fmadd_ps(_mm256_mul_ps(dotNH, dotNH), _mm256_sub_ps(a, one), one) };
+			return _mm256_div_ps(a, _mm256_mul_ps(_mm256_set1_ps(dae::PI), _mm256_mul_ps(base, base)));
+		}
+
+		//Smith with Schlick GGX on both directions, k = squared(roughness + 1) / 8
+		inline __m256 GeometryFunction_Smith(__m256 dotNV, __m256 dotNL, __m256 k)
+		{
+			const __m256 oneMinusK{ _mm256_sub_ps(_mm256_set1_ps(1.f), k) };
+			const __m256 smith1{ _mm256_div_ps(dotNV, _mm256_fmadd_ps(dotNV, oneMinusK, k)) };
+			const __m256 smith2{ _mm256_div_ps(dotNL, _mm256_fmadd_ps(dotNL, oneMinusK, k)) };
+			return _mm256_mul_ps(smith2, smith1);
+		}
+	}
+}
+#endif
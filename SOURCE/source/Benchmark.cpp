@@ -0,0 +1,421 @@
+#include "Benchmark.h"
+
+//Standard includes
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <numeric>
+#include <thread>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+//Project includes
+#include "Arguments.h"
+#include "PerfCounters.h"
+#include "Renderer.h"
+#include "Scene.h"
+#include "Timer.h"
+
+namespace dae
+{
+	namespace Benchmark
+	{
+		struct RunResult
+		{
+			std::string sceneName{};
+			int nrOfThreads{};
+			std::vector<double> frameTimes{}; //ms
+
+			double mean{};
+			double min{};
+			double max{};
+			double p50{};
+			double p95{};
+			double p99{};
+			double primaryMraysPerSecond{};
+
+			RayCounters counters{}; //summed over the measured frames
+			double mraysPerSecond{};
+
+			PerfCounters::PhaseValues perfValues{}; //summed over the measured frames, zero when the counters are off
+		};
+
+		bool ParseArguments(int argc, char* args[], int firstArgument, Settings& settings)
+		{
+			const bool isParsed{ Arguments::Parse(argc, args, firstArgument, [&settings](const std::string& argument, const std::string& value)
+			{
+				if (argument == "--scenes") settings.sceneNames = Arguments::Split(value, ',');
+				else if (argument == "--threads")
+				{
+					settings.threadCounts.clear();
+					for (const std::string& count : Arguments::Split(value, ','))
+						settings.threadCounts.push_back(std::stoi(count));
+				}
+				else if (argument == "--width") settings.width = std::stoi(value);
+				else if (argument == "--height") settings.height = std::stoi(value);
+				else if (argument == "--frames") settings.nrOfFrames = std::stoi(value);
+				else if (argument == "--warmup") settings.nrOfWarmupFrames = std::stoi(value);
+				else if (argument == "--output") settings.outputPath = value;
+				else if (argument == "--compare") settings.baselinePath = value;
+				else if (argument == "--tolerance") settings.tolerance = std::stof(value);
+				else if (argument == "--perf" && (value == "on" || value == "off")) settings.usePerfCounters = value == "on";
+				else return Arguments::Result::Unknown;
+				return Arguments::Result::Applied;
+			}) };
+			if (!isParsed)
+				return false;
+
+			if (settings.width <= 0 || settings.height <= 0 || settings.nrOfFrames <= 0 || settings.nrOfWarmupFrames < 0)
+			{
+				std::cout << "Resolution and frame count have to be positive\n";
+				return false;
+			}
+			return true;
+		}
+
+#pragma region Machine Fingerprint
+		static std::string GetCpuName()
+		{
+			char brand[49]{};
+#if defined(_MSC_VER)
+			int registers[4]{};
+			__cpuid(registers, 0x80000000);
+			if (static_cast<unsigned>(registers[0]) >= 0x80000004)
+			{
+				for (int leaf{}; leaf < 3; ++leaf)
+				{
+					__cpuid(registers, 0x80000002 + leaf);
+					std::memcpy(brand + leaf * 16, registers, 16);
+				}
+			}
+#elif defined(__x86_64__) || defined(__i386__)
+			unsigned int registers[4]{};
+			if (__get_cpuid_max(0x80000000, nullptr) >= 0x80000004)
+			{
+				for (unsigned int leaf{}; leaf < 3; ++leaf)
+				{
+					__get_cpuid(0x80000002 + leaf, &registers[0], &registers[1], &registers[2], &registers[3]);
+					std::memcpy(brand + leaf * 16, registers, 16);
+				}
+			}
+#endif
+			std::string name{ brand };
+			name.erase(0, name.find_first_not_of(' '));
+			return name.empty() ? "unknown" : name;
+		}
+
+		static std::string GetCompiler()
+		{
+#if defined(_MSC_VER)
+			return "MSVC " + std::to_string(_MSC_VER);
+#elif defined(__clang__)
+			return "clang " __clang_version__;
+#elif defined(__GNUC__)
+			return "gcc " __VERSION__;
+#else
+			return "unknown";
+#endif
+		}
+
+		static std::string GetInstructionSet()
+		{
+#if defined(MATH_AVX2)
+			return "AVX2";
+#elif defined(MATH_SSE)
+			return "SSE";
+#else
+			return "scalar";
+#endif
+		}
+
+		static std::string GetOperatingSystem()
+		{
+#if defined(_WIN32)
+			return "Windows";
+#elif defined(__linux__)
+			return "Linux";
+#elif defined(__APPLE__)
+			return "macOS";
+#else
+			return "unknown";
+#endif
+		}
+#pragma endregion
+
+#pragma region Run
+		//gentle sway left/right with a small yaw, the same path for every scene (they all start looking down +z)
+		static void ApplyCameraPath(Camera& camera, const Vector3& startOrigin, int frame, int nrOfFrames)
+		{
+			const float phase{ PI_2 * frame / static_cast<float>(nrOfFrames) };
+			camera.origin = startOrigin + Vector3{ 1.5f * sinf(phase), .5f * sinf(2.f * phase), 0.f };
+			camera.totalYaw = -10.f * sinf(phase);
+			camera.forward = Matrix::CreateRotationY(camera.totalYaw * TO_RADIANS).TransformVector(Vector3::UnitZ).Normalized();
+		}
+
+		//nearest rank on sorted frame times
+		static double GetPercentile(const std::vector<double>& sortedTimes, double percentile)
+		{
+			const size_t rank{ static_cast<size_t>(std::ceil(percentile / 100.0 * sortedTimes.size())) };
+			return sortedTimes[std::clamp<size_t>(rank, 1, sortedTimes.size()) - 1];
+		}
+
+		static bool RunScene(const Settings& settings, const std::string& sceneName, int nrOfThreads, RunResult& result)
+		{
+			const std::unique_ptr<Scene> pScene{ CreateScene(sceneName) };
+			if (!pScene)
+			{
+				std::cout << "Unknown scene " << sceneName << "\n";
+				return false;
+			}
+			pScene->Initialize();
+
+			Renderer renderer{ settings.width, settings.height };
+			renderer.SetThreadCount(nrOfThreads);
+
+			Timer timer{};
+			Camera& camera{ pScene->GetCamera() };
+			const Vector3 startOrigin{ camera.origin };
+
+			result.sceneName = sceneName;
+			result.nrOfThreads = renderer.GetThreadCount();
+			result.frameTimes.clear();
+
+			for (int frame{ -settings.nrOfWarmupFrames }; frame < settings.nrOfFrames; ++frame)
+			{
+				//warmup frames replay the start of the path, so every measured frame sees the same scene state
+				const int pathFrame{ std::max(frame, 0) };
+				timer.Step(frame <= 0 ? 0.f : settings.timeStep);
+				pScene->Update(&timer);
+				ApplyCameraPath(camera, startOrigin, pathFrame, settings.nrOfFrames);
+
+				//drop what the warmup frames counted
+				if (frame == 0 && PerfCounters::IsEnabled())
+					PerfCounters::Collect();
+
+				const auto start{ std::chrono::high_resolution_clock::now() };
+				renderer.Render(pScene.get());
+				const auto end{ std::chrono::high_resolution_clock::now() };
+
+				if (frame >= 0)
+				{
+					result.frameTimes.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+					result.counters += renderer.GetFrameCounters();
+				}
+			}
+
+			if (PerfCounters::IsEnabled())
+				result.perfValues = PerfCounters::Collect();
+
+			std::vector<double> sortedTimes{ result.frameTimes };
+			std::sort(sortedTimes.begin(), sortedTimes.end());
+			result.mean = std::accumulate(sortedTimes.begin(), sortedTimes.end(), 0.0) / sortedTimes.size();
+			result.min = sortedTimes.front();
+			result.max = sortedTimes.back();
+			result.p50 = GetPercentile(sortedTimes, 50.0);
+			result.p95 = GetPercentile(sortedTimes, 95.0);
+			result.p99 = GetPercentile(sortedTimes, 99.0);
+			result.primaryMraysPerSecond = (settings.width * settings.height) / (result.mean * 1000.0);
+			result.mraysPerSecond = result.counters.GetNrOfRays() / (std::accumulate(sortedTimes.begin(), sortedTimes.end(), 0.0) * 1000.0);
+			return true;
+		}
+#pragma endregion
+
+#pragma region JSON
+		static std::string Quote(const std::string& text)
+		{
+			std::string quoted{ "\"" };
+			for (const char character : text)
+			{
+				if (character == '"' || character == '\\')
+					quoted += '\\';
+				quoted += character;
+			}
+			return quoted + "\"";
+		}
+
+		//every run goes on one line, that's what the compare mode reads back
+		static void WriteJson(std::ostream& stream, const Settings& settings, const std::vector<RunResult>& results, bool hasPerfCounters)
+		{
+			stream << "{\n";
+			stream << "  \"machine\": { \"cpu\": " << Quote(GetCpuName())
+				<< ", \"hardwareThreads\": " << std::thread::hardware_concurrency()
+				<< ", \"compiler\": " << Quote(GetCompiler())
+				<< ", \"isa\": " << Quote(GetInstructionSet())
+				<< ", \"os\": " << Quote(GetOperatingSystem())
+#if defined(NDEBUG)
+				<< ", \"build\": \"Release\" },\n";
+#else
+				<< ", \"build\": \"Debug\" },\n";
+#endif
+			stream << "  \"settings\": { \"width\": " << settings.width << ", \"height\": " << settings.height
+				<< ", \"frames\": " << settings.nrOfFrames << ", \"warmupFrames\": " << settings.nrOfWarmupFrames
+				<< ", \"timeStep\": " << settings.timeStep << " },\n";
+
+			stream << "  \"runs\": [\n";
+			for (size_t idx{}; idx < results.size(); ++idx)
+			{
+				const RunResult& result{ results[idx] };
+				stream << "    { \"scene\": " << Quote(result.sceneName) << ", \"threads\": " << result.nrOfThreads
+					<< ", \"width\": " << settings.width << ", \"height\": " << settings.height
+					<< ", \"meanMs\": " << result.mean << ", \"minMs\": " << result.min << ", \"maxMs\": " << result.max
+					<< ", \"p50Ms\": " << result.p50 << ", \"p95Ms\": " << result.p95 << ", \"p99Ms\": " << result.p99
+					<< ", \"primaryMraysPerSecond\": " << result.primaryMraysPerSecond;
+#if defined(RAY_STATS)
+				const double nrOfPixels{ static_cast<double>(settings.width) * settings.height * result.frameTimes.size() };
+				stream << ", \"mraysPerSecond\": " << result.mraysPerSecond
+					<< ", \"shadowRaysPerFrame\": " << result.counters.shadowRays / static_cast<double>(result.frameTimes.size())
+					<< ", \"boxTestsPerPixel\": " << result.counters.boxTests / nrOfPixels
+					<< ", \"triangleTestsPerPixel\": " << result.counters.triangleTests / nrOfPixels;
+#endif
+				if (hasPerfCounters)
+				{
+					constexpr const char* phaseNames[PerfCounters::NrOfPhases]{ "intersection", "shading", "pack" };
+					stream << ", \"perf\": {";
+					for (int phase{}; phase < PerfCounters::NrOfPhases; ++phase)
+					{
+						const PerfCounters::Values& values{ result.perfValues[phase] };
+						stream << (phase == 0 ? " " : ", ") << Quote(phaseNames[phase]) << ": { \"cycles\": " << values.cycles
+							<< ", \"instructions\": " << values.instructions << ", \"llcMisses\": " << values.llcMisses
+							<< ", \"branchMisses\": " << values.branchMisses << " }";
+					}
+					stream << " }";
+				}
+				stream << ", \"frameTimesMs\": [";
+				for (size_t frame{}; frame < result.frameTimes.size(); ++frame)
+				{
+					stream << (frame == 0 ? "" : ", ") << result.frameTimes[frame];
+				}
+				stream << "] }" << (idx + 1 < results.size() ? "," : "") << "\n";
+			}
+			stream << "  ]\n}\n";
+		}
+
+		//value after "key": on a line we wrote ourselves
+		static bool ReadValue(const std::string& line, const std::string& key, std::string& value)
+		{
+			const size_t keyPosition{ line.find("\"" + key + "\": ") };
+			if (keyPosition == std::string::npos)
+				return false;
+
+			size_t begin{ keyPosition + key.size() + 4 };
+			size_t end{};
+			if (line[begin] == '"')
+			{
+				end = line.find('"', ++begin);
+			}
+			else
+			{
+				end = line.find_first_of(",}", begin);
+			}
+			value = line.substr(begin, end - begin);
+			return true;
+		}
+#pragma endregion
+
+#pragma region Compare
+		static std::string GetRunKey(const std::string& sceneName, int nrOfThreads, int width, int height)
+		{
+			return sceneName + " " + std::to_string(width) + "x" + std::to_string(height) + " " + std::to_string(nrOfThreads) + "T";
+		}
+
+		static int Compare(const Settings& settings, const std::vector<RunResult>& results)
+		{
+			std::ifstream baselineFile{ settings.baselinePath };
+			if (!baselineFile)
+			{
+				std::cout << "Could not open baseline " << settings.baselinePath << "\n";
+				return 1;
+			}
+
+			struct BaselineRun { double p50{}; double p95{}; };
+			std::vector<std::pair<std::string, BaselineRun>> baselineRuns{};
+			for (std::string line{}; std::getline(baselineFile, line);)
+			{
+				std::string scene{}, threads{}, width{}, height{}, p50{}, p95{};
+				if (ReadValue(line, "scene", scene) && ReadValue(line, "threads", threads) && ReadValue(line, "width", width)
+					&& ReadValue(line, "height", height) && ReadValue(line, "p50Ms", p50) && ReadValue(line, "p95Ms", p95))
+				{
+					baselineRuns.emplace_back(GetRunKey(scene, std::stoi(threads), std::stoi(width), std::stoi(height)), BaselineRun{ std::stod(p50), std::stod(p95) });
+				}
+			}
+
+			std::cout << "**COMPARE** against " << settings.baselinePath << " (tolerance " << settings.tolerance * 100.f << "%)\n";
+			int nrOfRegressions{};
+			for (const RunResult& result : results)
+			{
+				const std::string key{ GetRunKey(result.sceneName, result.nrOfThreads, settings.width, settings.height) };
+				const auto it{ std::find_if(baselineRuns.begin(), baselineRuns.end(), [&](const auto& run) { return run.first == key; }) };
+				if (it == baselineRuns.end())
+				{
+					std::cout << key << ": not in baseline\n";
+					continue;
+				}
+
+				const double p50Change{ result.p50 / it->second.p50 - 1.0 };
+				const double p95Change{ result.p95 / it->second.p95 - 1.0 };
+				const bool regressed{ p50Change > settings.tolerance || p95Change > settings.tolerance };
+				const bool improved{ p50Change < -settings.tolerance };
+				nrOfRegressions += regressed ? 1 : 0;
+
+				std::cout << key << ": p50 " << it->second.p50 << " -> " << result.p50 << " ms (" << p50Change * 100.0 << "%), p95 "
+					<< it->second.p95 << " -> " << result.p95 << " ms (" << p95Change * 100.0 << "%)"
+					<< (regressed ? " REGRESSION" : improved ? " improved" : "") << "\n";
+			}
+
+			std::cout << nrOfRegressions << " regression(s)\n";
+			return nrOfRegressions > 0 ? 1 : 0;
+		}
+#pragma endregion
+
+		int Run(const Settings& settings)
+		{
+			std::vector<int> threadCounts{ settings.threadCounts };
+			if (threadCounts.empty())
+			{
+				const int nrOfHardwareThreads{ std::max(1, static_cast<int>(std::thread::hardware_concurrency())) };
+				for (int count{ 1 }; count < nrOfHardwareThreads; count *= 2)
+					threadCounts.push_back(count);
+				threadCounts.push_back(nrOfHardwareThreads);
+			}
+
+			//falls back to wall-clock only when the counters can't be opened
+			const bool usePerfCounters{ settings.usePerfCounters && PerfCounters::Enable() };
+
+			std::vector<RunResult> results{};
+			for (const std::string& sceneName : settings.sceneNames)
+			{
+				for (const int nrOfThreads : threadCounts)
+				{
+					RunResult result{};
+					if (!RunScene(settings, sceneName, nrOfThreads, result))
+						return 1;
+
+					std::cout << GetRunKey(sceneName, result.nrOfThreads, settings.width, settings.height) << ": p50 " << result.p50 << " ms, p95 " << result.p95
+						<< " ms, p99 " << result.p99 << " ms, " << result.primaryMraysPerSecond << " primary Mrays/s\n";
+					if (usePerfCounters)
+						PerfCounters::Print(std::cout, result.perfValues);
+					results.push_back(std::move(result));
+				}
+			}
+
+			std::ofstream outputFile{ settings.outputPath };
+			if (!outputFile)
+			{
+				std::cout << "Could not write " << settings.outputPath << "\n";
+				return 1;
+			}
+			WriteJson(outputFile, settings, results, usePerfCounters);
+			std::cout << "Saved " << settings.outputPath << "\n";
+
+			return settings.baselinePath.empty() ? 0 : Compare(settings, results);
+		}
+	}
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <string>
+#include <vector>
+
+namespace dae
+{
+	namespace Benchmark
+	{
+		struct Settings
+		{
+			std::vector<std::string> sceneNames{ "ReferenceScene", "BunnyScene", "ExtraScene", "SphereGridScene", "TriangleFieldScene", "AreaLightScene" };
+			std::vector<int> threadCounts{}; //empty = 1, 2, 4, ... up to the amount of hardware threads
+			int width{ 640 };
+			int height{ 480 };
+			int nrOfFrames{ 60 };
+			int nrOfWarmupFrames{ 5 };
+			float timeStep{ 1.f / 60.f };
+			std::string outputPath{ "benchmark.json" };
+			std::string baselinePath{}; //compare against this earlier output when set
+			float tolerance{ .05f }; //relative slowdown that counts as a regression
+			bool usePerfCounters{ false }; //hardware counters per render phase, when the platform has them
+		};
+
+		/**
+		 * \brief Reads "--scenes a,b --threads 1,2,4 --width <px> --height <px> --frames <n> --warmup <n> --output <path> --compare <baseline> --tolerance <fraction> --perf <on|off>"
+		 * \param firstArgument index of the first argument after the mode switch
+		 * \return false when an argument is unknown or has no valid value
+		 */
+		bool ParseArguments(int argc, char* args[], int firstArgument, Settings& settings);
+
+		/**
+		 * \brief Renders every scene along a fixed camera path for every thread count, writes the frame times as JSON
+		 * \return exit code for main, 1 when a run regressed against the baseline
+		 */
+		int Run(const Settings& settings);
+	}
+}
@@ -0,0 +1,241 @@
+#include "Convergence.h"
+
+//Standard includes
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <memory>
+
+//Project includes
+#include "Arguments.h"
+#include "Renderer.h"
+#include "Scene.h"
+#include "Timer.h"
+
+namespace dae
+{
+	namespace Convergence
+	{
+		struct Point
+		{
+			int nrOfSamples{};
+			double rmse{}; //over all runs
+		};
+
+		struct SamplerResult
+		{
+			SamplerType type{};
+			std::vector<Point> points{};
+			double millisecondsPerSample{}; //one sample of every pixel
+			double samplesToMatch{}; //to get the error random sampling has with all samples, 0 = never did
+		};
+
+		bool ParseArguments(int argc, char* args[], int firstArgument, Settings& settings)
+		{
+			const bool isParsed{ Arguments::Parse(argc, args, firstArgument, [&settings](const std::string& argument, const std::string& value)
+			{
+				if (argument == "--scene") settings.sceneName = value;
+				else if (argument == "--samplers")
+				{
+					settings.samplers.clear();
+					for (const std::string& name : Arguments::Split(value, ','))
+					{
+						SamplerType type{};
+						if (!ParseSamplerName(name, type))
+						{
+							std::cout << "Unknown sampler " << name << "\n";
+							return Arguments::Result::Rejected;
+						}
+						settings.samplers.push_back(type);
+					}
+				}
+				else if (argument == "--width") settings.width = std::stoi(value);
+				else if (argument == "--height") settings.height = std::stoi(value);
+				else if (argument == "--samples") settings.maxSamples = std::stoi(value);
+				else if (argument == "--reference") settings.referenceSamples = std::stoi(value);
+				else if (argument == "--runs") settings.nrOfRuns = std::stoi(value);
+				else if (argument == "--output") settings.outputPath = value;
+				else return Arguments::Result::Unknown;
+				return Arguments::Result::Applied;
+			}) };
+			if (!isParsed)
+				return false;
+
+			if (settings.width <= 0 || settings.height <= 0 || settings.maxSamples <= 0 || settings.nrOfRuns <= 0
+				|| settings.referenceSamples <= settings.maxSamples)
+			{
+				std::cout << "Resolution and sample counts have to be positive, the reference needs more samples than the runs\n";
+				return false;
+			}
+			return true;
+		}
+
+		//mean squared error over every channel, clamped to what the display shows so a firefly doesn't decide the whole score
+		static double GetMse(const std::vector<ColorRGB>& image, const std::vector<ColorRGB>& reference)
+		{
+			double sum{};
+			for (size_t idx{}; idx < image.size(); ++idx)
+			{
+				for (int channel{}; channel < 3; ++channel)
+				{
+					const float* pImage{ &image[idx].r };
+					const float* pReference{ &reference[idx].r };
+					const double difference{ std::min(pImage[channel], 1.f) - std::min(pReference[channel], 1.f) };
+					sum += difference * difference;
+				}
+			}
+			return sum / (image.size() * 3);
+		}
+
+		//interpolated between the measured powers of two, error and sample count are close to a line on a log-log scale
+		static double GetSamplesToReach(const std::vector<Point>& points, double rmse)
+		{
+			for (size_t idx{}; idx < points.size(); ++idx)
+			{
+				if (points[idx].rmse > rmse)
+					continue;
+				if (idx == 0)
+					return points[idx].nrOfSamples;
+
+				const Point& before{ points[idx - 1] };
+				const Point& after{ points[idx] };
+				const double t{ (std::log(rmse) - std::log(before.rmse)) / (std::log(after.rmse) - std::log(before.rmse)) };
+				return std::exp(std::log(before.nrOfSamples) + t * (std::log(after.nrOfSamples) - std::log(before.nrOfSamples)));
+			}
+			return 0.0;
+		}
+
+		static void WriteJson(std::ostream& stream, const Settings& settings, const std::vector<SamplerResult>& results)
+		{
+			stream << "{\n";
+			stream << "  \"settings\": { \"scene\": \"" << settings.sceneName << "\", \"width\": " << settings.width << ", \"height\": " << settings.height
+				<< ", \"maxSamples\": " << settings.maxSamples << ", \"referenceSamples\": " << settings.referenceSamples << ", \"runs\": " << settings.nrOfRuns << " },\n";
+
+			stream << "  \"samplers\": [\n";
+			for (size_t idx{}; idx < results.size(); ++idx)
+			{
+				const SamplerResult& result{ results[idx] };
+				stream << "    { \"name\": \"" << GetSamplerName(result.type) << "\", \"msPerSample\": " << result.millisecondsPerSample
+					<< ", \"samplesToMatchRandom\": " << result.samplesToMatch << ", \"rmse\": [";
+				for (size_t point{}; point < result.points.size(); ++point)
+				{
+					stream << (point == 0 ? " " : ", ") << "{ \"samples\": " << result.points[point].nrOfSamples << ", \"rmse\": " << result.points[point].rmse << " }";
+				}
+				stream << " ] }" << (idx + 1 < results.size() ? "," : "") << "\n";
+			}
+			stream << "  ]\n";
+			stream << "}\n";
+		}
+
+		int Run(const Settings& settings)
+		{
+			const std::unique_ptr<Scene> pScene{ CreateScene(settings.sceneName) };
+			if (!pScene)
+			{
+				std::cout << "Unknown scene " << settings.sceneName << "\n";
+				return 1;
+			}
+			pScene->Initialize();
+
+			//one update without time passing, the scene has to hold still to converge
+			Timer timer{};
+			timer.Step(0.f);
+			pScene->Update(&timer);
+
+			Renderer renderer{ settings.width, settings.height };
+			renderer.ToggleProgressive();
+			//a fixed bounce depth, runs that picked another one would converge to another image
+			renderer.SetBounceBudget(std::numeric_limits<float>::max());
+
+			//another seed than the runs, so its noise doesn't line up with theirs
+			std::cout << "**CONVERGENCE** " << settings.sceneName << " " << settings.width << "x" << settings.height
+				<< ", reference with " << settings.referenceSamples << " samples/pixel, " << settings.nrOfRuns << " runs per sampler\n";
+			renderer.SetSampler(SamplerType::Sobol);
+			renderer.SetSamplerSeed(static_cast<uint32_t>(settings.nrOfRuns));
+			for (int sample{}; sample < settings.referenceSamples; ++sample)
+			{
+				renderer.Render(pScene.get());
+			}
+			const std::vector<ColorRGB> reference{ renderer.GetHdrImage() };
+
+			std::vector<SamplerResult> results{};
+			for (const SamplerType type : settings.samplers)
+			{
+				SamplerResult result{ type };
+				renderer.SetSampler(type);
+
+				double totalMilliseconds{};
+				std::vector<double> squaredErrors{};
+				for (int run{}; run < settings.nrOfRuns; ++run)
+				{
+					renderer.SetSamplerSeed(static_cast<uint32_t>(run));
+					for (int sample{ 1 }, point{}; sample <= settings.maxSamples; ++sample)
+					{
+						const auto start{ std::chrono::high_resolution_clock::now() };
+						renderer.Render(pScene.get());
+						totalMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+						if ((sample & (sample - 1)) == 0 || sample == settings.maxSamples)
+						{
+							if (run == 0)
+							{
+								result.points.push_back(Point{ sample });
+								squaredErrors.push_back(0.0);
+							}
+							squaredErrors[point++] += GetMse(renderer.GetHdrImage(), reference);
+						}
+					}
+				}
+
+				for (size_t point{}; point < result.points.size(); ++point)
+				{
+					result.points[point].rmse = std::sqrt(squaredErrors[point] / settings.nrOfRuns);
+				}
+				result.millisecondsPerSample = totalMilliseconds / (settings.maxSamples * settings.nrOfRuns);
+				results.push_back(result);
+			}
+
+			//how much random sampling gets done with all samples, and what that costs the others
+			const auto randomResult{ std::find_if(results.begin(), results.end(), [](const SamplerResult& result) { return result.type == SamplerType::Random; }) };
+			if (randomResult != results.end())
+			{
+				const double randomRmse{ randomResult->points.back().rmse };
+				for (SamplerResult& result : results)
+				{
+					result.samplesToMatch = GetSamplesToReach(result.points, randomRmse);
+				}
+			}
+
+			for (const SamplerResult& result : results)
+			{
+				std::cout << ">> " << GetSamplerName(result.type) << " (" << result.millisecondsPerSample << " ms/sample):";
+				for (const Point& point : result.points)
+				{
+					std::cout << " " << point.nrOfSamples << "spp " << point.rmse;
+				}
+				std::cout << "\n";
+
+				if (randomResult == results.end() || result.type == SamplerType::Random)
+					continue;
+				if (result.samplesToMatch > 0.0)
+					std::cout << "   matches random at " << settings.maxSamples << "spp with " << result.samplesToMatch << "spp ("
+						<< settings.maxSamples / result.samplesToMatch << "x fewer samples)\n";
+				else
+					std::cout << "   doesn't match random at " << settings.maxSamples << "spp\n";
+			}
+
+			std::ofstream outputFile{ settings.outputPath };
+			if (!outputFile)
+			{
+				std::cout << "Something went wrong. " << settings.outputPath << " not saved!\n";
+				return 1;
+			}
+			WriteJson(outputFile, settings, results);
+			std::cout << "Saved " << settings.outputPath << "\n";
+			return 0;
+		}
+	}
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <string>
+#include <vector>
+
+#include "Sampler.h"
+
+namespace dae
+{
+	namespace Convergence
+	{
+		struct Settings
+		{
+			std::string sceneName{ "ReferenceScene" };
+			std::vector<SamplerType> samplers{ SamplerType::Random, SamplerType::Sobol, SamplerType::BlueNoise };
+			int width{ 320 };
+			int height{ 240 };
+			int maxSamples{ 64 }; //per pixel, the error is measured at every power of two up to this
+			int referenceSamples{ 1024 };
+			int nrOfRuns{ 4 }; //per sampler with another seed each, a single firefly moves the error of one run a lot
+			std::string outputPath{ "convergence.json" };
+		};
+
+		/**
+		 * \brief Reads "--scene <class> --samplers a,b --width <px> --height <px> --samples <n> --reference <n> --runs <n> --output <path>"
+		 * \param firstArgument index of the first argument after the mode switch
+		 * \return false when an argument is unknown or has no valid value
+		 */
+		bool ParseArguments(int argc, char* args[], int firstArgument, Settings& settings);
+
+		/**
+		 * \brief Accumulates the still scene with every sampler and measures the error against a reference with many more samples,
+		 * prints and saves how many samples every sampler needs to get as close as random sampling does with all of them
+		 * \return exit code for main
+		 */
+		int Run(const Settings& settings);
+	}
+}
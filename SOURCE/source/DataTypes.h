@@ -1,7 +1,10 @@
 #pragma once
+#include <algorithm>
 #include <cassert>
+#include <execution>
 
 #include "Math.h"
+#include "Trace.h"
 #include "vector"
 
 namespace dae
@@ -158,34 +161,51 @@ namespace dae
 
 		void UpdateTransforms()
 		{
+			TRACE_SCOPE("UpdateTransforms");
+
 			//calculate final transform 
 			const Matrix finalTransform{ scaleTransform * rotationTransform * translationTransform };
 
-			//clear normals and positions, reserving memory for vectors
-			transformedNormals.clear();
-			transformedNormals.reserve(normals.size());
+			//resize only reallocates when the vertex count changed, every other frame the storage is reused
+			transformedNormals.resize(normals.size());
+			transformedPositions.resize(positions.size());
+
+			//transform positions and normals in batches, big meshes get split over multiple threads
+			TransformInChunks(finalTransform, positions, transformedPositions, true);
+			TransformInChunks(finalTransform, normals, transformedNormals, false);
+
+			//update transforms
+			UpdateTransformedAABB(finalTransform);
+		}
 
-			transformedPositions.clear();
-			transformedPositions.reserve(positions.size());
+		static void TransformInChunks(const Matrix& transform, const std::vector<Vector3>& input, std::vector<Vector3>& output, bool isPoint)
+		{
+			//small enough that a chunk stays in L2, big enough to be worth a thread
+			const size_t chunkSize{ 16384 };
 
-			//transform positions
-			//loops over position, applies finalTransform to each and stores transformed point in vector
-			for (int positionIdx = 0; positionIdx < positions.size(); ++positionIdx)
+			const auto transformChunk{ [&](size_t start)
+			{
+				const size_t count{ std::min(chunkSize, input.size() - start) };
+				if (isPoint)
+					transform.TransformPoints(input.data() + start, output.data() + start, count);
+				else
+					transform.TransformVectors(input.data() + start, output.data() + start, count);
+			} };
+
+			if (input.size() <= chunkSize)
 			{
-				Vector3 result{ finalTransform.TransformPoint(positions[positionIdx]) };
-				transformedPositions.emplace_back(result);
+				transformChunk(0);
+				return;
 			}
 
-			//transform normals
-			//loops over normals, applies finalTransform to each and stores transformed normal in vector
-			for (int normalIdx = 0; normalIdx < normals.size(); ++normalIdx)
+			std::vector<size_t> chunkStarts{};
+			chunkStarts.reserve(input.size() / chunkSize + 1);
+			for (size_t start{}; start < input.size(); start += chunkSize)
 			{
-				Vector3 result{ finalTransform.TransformVector(normals[normalIdx]) };
-				transformedNormals.emplace_back(result);
+				chunkStarts.emplace_back(start);
 			}
 
-			//update transforms
-			UpdateTransformedAABB(finalTransform);
+			std::for_each(std::execution::par, chunkStarts.begin(), chunkStarts.end(), transformChunk);
 		}
 
 		void UpdateTransformedAABB(const Matrix& finalTransform)
@@ -232,17 +252,24 @@ namespace dae
 	enum class LightType
 	{
 		Point,
-		Directional
+		Directional,
+		Rect, //one-sided rectangle, soft shadows
+		Sphere //soft shadows
 	};
 
 	struct Light
 	{
-		Vector3 origin;
+		Vector3 origin; //center of the area lights
 		Vector3 direction;
 		ColorRGB color;
-		float intensity;
+		float intensity; //area lights: of the whole light, so from far away it looks like a point light of this intensity
 
 		LightType type;
+
+		//rect: spans origin +- halfWidth +- halfHeight and shines towards direction = Cross(halfWidth, halfHeight) normalized
+		Vector3 halfWidth{};
+		Vector3 halfHeight{};
+		float radius{}; //sphere
 	};
 #pragma endregion
 #pragma region MISC
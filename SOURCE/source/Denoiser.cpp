@@ -0,0 +1,530 @@
+#include "Denoiser.h"
+
+//Standard includes
+#include <algorithm>
+#include <cmath>
+#include <type_traits>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#include <xmmintrin.h>
+#endif
+
+//Project includes
+#include "ThreadPool.h"
+#include "Trace.h"
+
+using namespace dae;
+
+namespace
+{
+	//B-spline of the À-trous levels, 3 taps per axis instead of the paper's 5 so a level costs 9 taps instead of 25
+	constexpr std::array<float, 3> Kernel{ .25f, .5f, .25f };
+	//the kernel weights of the taps around the center are powers of two, 1 / 8 next to it and 1 / 16 on the diagonals
+	//the vector path adds them to the exponent of the edge stopping weight instead of multiplying
+	constexpr std::array<float, 3> Log2Kernel{ -2.f, -1.f, -2.f };
+	//past this distance in the exp the weight is as good as 0
+	constexpr float MaxDistance{ 40.f };
+	constexpr float Log2E{ 1.44269504f };
+	//keeps pixels without noise from dividing by 0, a luminance step of 1% still stops the filter there
+	constexpr float MinVariance{ 1e-4f };
+	//fewer frames in the history say too little about the variance
+	constexpr uint32_t MinHistoryForVariance{ 4 };
+
+	float GetLuminance(const ColorRGB& color) { return .2126f * color.r + .7152f * color.g + .0722f * color.b; }
+
+#if defined(_M_X64) || defined(__SSE2__)
+	//the weights across edges and the variances of pixels without noise shrink into denormals, and every operation on one costs
+	//a hundred cycles; the filter has no use for them, so they're flushed to 0 while it runs on a thread
+	class FlushDenormals final
+	{
+	public:
+		FlushDenormals() :
+			m_PreviousState{ _mm_getcsr() }
+		{
+			_mm_setcsr(m_PreviousState | _MM_FLUSH_ZERO_ON | 0x0040); //0x0040 = denormals are zero
+		}
+		~FlushDenormals() { _mm_setcsr(m_PreviousState); }
+
+		FlushDenormals(const FlushDenormals&) = delete;
+		FlushDenormals(FlushDenormals&&) noexcept = delete;
+		FlushDenormals& operator=(const FlushDenormals&) = delete;
+		FlushDenormals& operator=(FlushDenormals&&) noexcept = delete;
+
+	private:
+		unsigned int m_PreviousState;
+	};
+#else
+	struct FlushDenormals final {};
+#endif
+
+#if defined(MATH_AVX2)
+	//2^x for x <= 0, the fraction as a polynomial and the whole part straight into the exponent bits
+	//stops at e^-MaxDistance, far below anything the kernel weights would still notice
+	__m256 Exp2Negative(__m256 x)
+	{
+		const __m256 exponent{ _mm256_max_ps(x, _mm256_set1_ps(-MaxDistance * Log2E)) };
+		const __m256 whole{ _mm256_floor_ps(exponent) };
+		const __m256 fraction{ _mm256_sub_ps(exponent, whole) };
+
+		//a minimax fit, within 1e-4 of 2^fraction
+		__m256 power{ _mm256_fmadd_ps(fraction, _mm256_set1_ps(.078024523f), _mm256_set1_ps(.22606716f)) };
+		power = _mm256_fmadd_ps(power, fraction, _mm256_set1_ps(.69583354f));
+		power = _mm256_fmadd_ps(power, fraction, _mm256_set1_ps(.99992522f));
+
+		const __m256i exponentBits{ _mm256_slli_epi32(_mm256_cvtps_epi32(whole), 23) };
+		return _mm256_castsi256_ps(_mm256_add_epi32(_mm256_castps_si256(power), exponentBits));
+	}
+#endif
+}
+
+void Denoiser::Resize(int width, int height, int tileSize)
+{
+	if (width == m_Width && height == m_Height && tileSize == m_TileSize)
+		return;
+
+	m_Width = width;
+	m_Height = height;
+	m_TileSize = tileSize;
+	m_NrOfTilesX = (width + tileSize - 1) / tileSize;
+	m_NrOfTiles = static_cast<uint32_t>(m_NrOfTilesX * ((height + tileSize - 1) / tileSize));
+
+	const size_t nrOfPixels{ static_cast<size_t>(width) * height };
+	for (std::vector<float>* pPlane : { &m_NormalX, &m_NormalY, &m_NormalZ, &m_Depth, &m_AlbedoRed, &m_AlbedoGreen, &m_AlbedoBlue,
+		&m_History[0], &m_History[1], &m_History[2], &m_HistoryLuminance, &m_HistorySquaredLuminance })
+	{
+		pPlane->assign(nrOfPixels, 0.f);
+	}
+	for (auto& planes : m_Light)
+	{
+		for (std::vector<float>& plane : planes)
+			plane.assign(nrOfPixels, 0.f);
+	}
+	m_HistoryLength = 0;
+}
+
+template<typename Task>
+void Denoiser::ForEachTile(ThreadPool* pThreadPool, const Task& task) const
+{
+	if (pThreadPool)
+	{
+		pThreadPool->ParallelFor(m_NrOfTiles, [&](uint32_t tileIndex, int)
+		{
+			[[maybe_unused]] const FlushDenormals flushDenormals{};
+			task(tileIndex);
+		});
+		return;
+	}
+
+	[[maybe_unused]] const FlushDenormals flushDenormals{};
+	for (uint32_t tileIndex{}; tileIndex < m_NrOfTiles; ++tileIndex)
+	{
+		task(tileIndex);
+	}
+}
+
+void Denoiser::Denoise(ThreadPool* pThreadPool, const ConstPlanes& input, const float* pVariance, const Planes& output, bool temporal, bool resetHistory)
+{
+	//the weight of this frame in the history, 1 drops whatever it held
+	m_HistoryLength = !temporal ? 0 : (resetHistory ? 1 : m_HistoryLength + 1);
+	const float historyWeight{ temporal ? std::max(1.f / m_HistoryLength, m_MinHistoryWeight) : 1.f };
+
+	const auto toLevelPlanes = [](std::array<std::vector<float>, 5>& planes)
+	{
+		return LevelPlanes{ planes[0].data(), planes[1].data(), planes[2].data(), planes[3].data(), planes[4].data() };
+	};
+	const auto toConstLevelPlanes = [](const LevelPlanes& planes) { return ConstLevelPlanes{ planes[0], planes[1], planes[2], planes[3], planes[4] }; };
+
+	//the first level filters the history when there is one, the frame's own light only went into its blend
+	LevelPlanes light{ toLevelPlanes(m_Light[0]) };
+	if (temporal)
+	{
+		light = LevelPlanes{ m_History[0].data(), m_History[1].data(), m_History[2].data(), light[3], light[4] };
+	}
+	{
+		TRACE_SCOPE("Demodulate");
+		ForEachTile(pThreadPool, [&](uint32_t tileIndex) { DemodulateTile(tileIndex, input, pVariance, light, temporal, historyWeight); });
+	}
+
+	ConstLevelPlanes source{ toConstLevelPlanes(light) };
+	for (int level{}; level < m_Iterations; ++level)
+	{
+		TRACE_SCOPE("AtrousLevel", static_cast<uint32_t>(level));
+
+		//the last level writes the output, the ones before alternate between the light buffers
+		const bool isLast{ level == m_Iterations - 1 };
+		const LevelPlanes destination{ isLast ? LevelPlanes{ output[0], output[1], output[2], nullptr, nullptr } : toLevelPlanes(m_Light[(level + 1) % 2]) };
+
+		ForEachTile(pThreadPool, [&](uint32_t tileIndex) { FilterTile(tileIndex, source, destination, 1 << level, isLast); });
+		source = toConstLevelPlanes(destination);
+	}
+}
+
+void Denoiser::DemodulateTile(uint32_t tileIndex, const ConstPlanes& input, const float* pVariance, const LevelPlanes& light, bool temporal, float historyWeight)
+{
+	const int tileX{ static_cast<int>(tileIndex % m_NrOfTilesX) * m_TileSize };
+	const int tileY{ static_cast<int>(tileIndex / m_NrOfTilesX) * m_TileSize };
+	const int tileWidth{ std::min(m_TileSize, m_Width - tileX) };
+	const int tileHeight{ std::min(m_TileSize, m_Height - tileY) };
+
+	//the history averages frames, its variance is the one of a mean of that many samples (an exponential average stops at 2 / weight - 1)
+	const float nrOfHistorySamples{ std::min(float(m_HistoryLength), 2.f / m_MinHistoryWeight - 1.f) };
+	const bool hasHistoryVariance{ temporal && m_HistoryLength >= MinHistoryForVariance };
+
+#if defined(MATH_AVX2)
+	const __m256 minAlbedo{ _mm256_set1_ps(m_MinAlbedo) };
+	const __m256 one{ _mm256_set1_ps(1.f) };
+	const __m256 zero{ _mm256_setzero_ps() };
+	const __m256 weight{ _mm256_set1_ps(historyWeight) };
+	const __m256 historySamples{ _mm256_set1_ps(std::max(nrOfHistorySamples, 1.f)) };
+
+	const auto getLuminance = [](__m256 red, __m256 green, __m256 blue)
+	{
+		return _mm256_fmadd_ps(red, _mm256_set1_ps(.2126f), _mm256_fmadd_ps(green, _mm256_set1_ps(.7152f), _mm256_mul_ps(blue, _mm256_set1_ps(.0722f))));
+	};
+	const auto blend = [&](float* pHistory, __m256 value)
+	{
+		const __m256 history{ _mm256_loadu_ps(pHistory) };
+		const __m256 blended{ _mm256_fmadd_ps(_mm256_sub_ps(value, history), weight, history) };
+		_mm256_storeu_ps(pHistory, blended);
+		return blended;
+	};
+#endif
+
+	for (int y{ tileY }; y < tileY + tileHeight; ++y)
+	{
+		for (int x{ tileX }; x < tileX + tileWidth; x += 8)
+		{
+			const int blockWidth{ std::min(8, tileX + tileWidth - x) };
+
+#if defined(MATH_AVX2)
+			//8 pixels at once when their neighbors for the variance estimate are in the row
+			if (blockWidth == 8 && x - 1 >= 0 && x + 9 <= m_Width)
+			{
+				const int pixelIndex{ x + y * m_Width };
+				const __m256 red{ _mm256_loadu_ps(&input[0][pixelIndex]) };
+				const __m256 green{ _mm256_loadu_ps(&input[1][pixelIndex]) };
+				const __m256 blue{ _mm256_loadu_ps(&input[2][pixelIndex]) };
+				const __m256 albedoRed{ _mm256_max_ps(_mm256_loadu_ps(&m_AlbedoRed[pixelIndex]), minAlbedo) };
+				const __m256 albedoGreen{ _mm256_max_ps(_mm256_loadu_ps(&m_AlbedoGreen[pixelIndex]), minAlbedo) };
+				const __m256 albedoBlue{ _mm256_max_ps(_mm256_loadu_ps(&m_AlbedoBlue[pixelIndex]), minAlbedo) };
+				const __m256 lightRed{ _mm256_div_ps(red, albedoRed) };
+				const __m256 lightGreen{ _mm256_div_ps(green, albedoGreen) };
+				const __m256 lightBlue{ _mm256_div_ps(blue, albedoBlue) };
+				const __m256 luminance{ _mm256_min_ps(getLuminance(red, green, blue), one) };
+
+				__m256 variance{ pVariance ? _mm256_loadu_ps(&pVariance[pixelIndex]) : _mm256_set1_ps(-1.f) };
+				if (temporal)
+				{
+					_mm256_storeu_ps(&light[4][pixelIndex], getLuminance(blend(&light[0][pixelIndex], lightRed), blend(&light[1][pixelIndex], lightGreen),
+						blend(&light[2][pixelIndex], lightBlue)));
+
+					const __m256 meanLuminance{ blend(&m_HistoryLuminance[pixelIndex], luminance) };
+					const __m256 meanSquaredLuminance{ blend(&m_HistorySquaredLuminance[pixelIndex], _mm256_mul_ps(luminance, luminance)) };
+					if (hasHistoryVariance)
+					{
+						const __m256 spread{ _mm256_max_ps(_mm256_fnmadd_ps(meanLuminance, meanLuminance, meanSquaredLuminance), zero) };
+						variance = _mm256_div_ps(spread, historySamples);
+					}
+				}
+				else
+				{
+					_mm256_storeu_ps(&light[0][pixelIndex], lightRed);
+					_mm256_storeu_ps(&light[1][pixelIndex], lightGreen);
+					_mm256_storeu_ps(&light[2][pixelIndex], lightBlue);
+					_mm256_storeu_ps(&light[4][pixelIndex], getLuminance(lightRed, lightGreen, lightBlue));
+				}
+
+				const __m256 isUnknown{ _mm256_cmp_ps(variance, zero, _CMP_LT_OQ) };
+				if (_mm256_movemask_ps(isUnknown) != 0)
+				{
+					__m256 luminanceSum{}, squaredLuminanceSum{};
+					int nrOfNeighbors{};
+					for (int tapY{ std::max(y - 1, 0) }; tapY <= std::min(y + 1, m_Height - 1); ++tapY)
+					{
+						for (int tapIndex{ x - 1 + tapY * m_Width }; tapIndex <= x + 1 + tapY * m_Width; ++tapIndex)
+						{
+							const __m256 tapLuminance{ _mm256_min_ps(getLuminance(_mm256_loadu_ps(&input[0][tapIndex]),
+								_mm256_loadu_ps(&input[1][tapIndex]), _mm256_loadu_ps(&input[2][tapIndex])), one) };
+							luminanceSum = _mm256_add_ps(luminanceSum, tapLuminance);
+							squaredLuminanceSum = _mm256_fmadd_ps(tapLuminance, tapLuminance, squaredLuminanceSum);
+							++nrOfNeighbors;
+						}
+					}
+
+					const __m256 scale{ _mm256_set1_ps(1.f / nrOfNeighbors) };
+					const __m256 meanLuminance{ _mm256_mul_ps(luminanceSum, scale) };
+					const __m256 spread{ _mm256_max_ps(_mm256_fmsub_ps(squaredLuminanceSum, scale, _mm256_mul_ps(meanLuminance, meanLuminance)), zero) };
+					variance = _mm256_blendv_ps(variance, _mm256_div_ps(spread, historySamples), isUnknown);
+				}
+
+				const __m256 albedoLuminance{ getLuminance(albedoRed, albedoGreen, albedoBlue) };
+				_mm256_storeu_ps(&light[3][pixelIndex], _mm256_div_ps(variance, _mm256_mul_ps(albedoLuminance, albedoLuminance)));
+				continue;
+			}
+#endif
+			//borders (or everything without AVX2)
+			for (int px{ x }; px < x + blockWidth; ++px)
+			{
+				const int pixelIndex{ px + y * m_Width };
+				const ColorRGB color{ input[0][pixelIndex], input[1][pixelIndex], input[2][pixelIndex] };
+				const ColorRGB albedo{ std::max(m_AlbedoRed[pixelIndex], m_MinAlbedo), std::max(m_AlbedoGreen[pixelIndex], m_MinAlbedo),
+					std::max(m_AlbedoBlue[pixelIndex], m_MinAlbedo) };
+				const ColorRGB frameLight{ color.r / albedo.r, color.g / albedo.g, color.b / albedo.b };
+
+				//clamped to what the display shows, like the renderer's own noise estimate
+				const float luminance{ std::min(GetLuminance(color), 1.f) };
+				float variance{ pVariance ? pVariance[pixelIndex] : -1.f };
+				if (temporal)
+				{
+					light[0][pixelIndex] += (frameLight.r - light[0][pixelIndex]) * historyWeight;
+					light[1][pixelIndex] += (frameLight.g - light[1][pixelIndex]) * historyWeight;
+					light[2][pixelIndex] += (frameLight.b - light[2][pixelIndex]) * historyWeight;
+
+					float& meanLuminance{ m_HistoryLuminance[pixelIndex] };
+					float& meanSquaredLuminance{ m_HistorySquaredLuminance[pixelIndex] };
+					meanLuminance += (luminance - meanLuminance) * historyWeight;
+					meanSquaredLuminance += (luminance * luminance - meanSquaredLuminance) * historyWeight;
+					if (hasHistoryVariance)
+						variance = std::max(meanSquaredLuminance - meanLuminance * meanLuminance, 0.f) / nrOfHistorySamples;
+				}
+				else
+				{
+					light[0][pixelIndex] = frameLight.r;
+					light[1][pixelIndex] = frameLight.g;
+					light[2][pixelIndex] = frameLight.b;
+				}
+				light[4][pixelIndex] = GetLuminance(ColorRGB{ light[0][pixelIndex], light[1][pixelIndex], light[2][pixelIndex] });
+
+				//the frames in a short history are averaged already, but too few to tell their spread
+				if (variance < 0.f)
+					variance = EstimateVariance(input, px, y) / std::max(nrOfHistorySamples, 1.f);
+
+				//the light is the color scaled by 1 / albedo, its variance by the square of that
+				const float albedoLuminance{ GetLuminance(albedo) };
+				light[3][pixelIndex] = variance / (albedoLuminance * albedoLuminance);
+			}
+		}
+	}
+}
+
+float Denoiser::EstimateVariance(const ConstPlanes& input, int px, int py) const
+{
+	//steps to another surface count as noise too, the normal and depth still keep the filter from crossing them
+	float luminanceSum{}, squaredLuminanceSum{};
+	int nrOfNeighbors{};
+	for (int y{ std::max(py - 1, 0) }; y <= std::min(py + 1, m_Height - 1); ++y)
+	{
+		for (int x{ std::max(px - 1, 0) }; x <= std::min(px + 1, m_Width - 1); ++x)
+		{
+			const int tapIndex{ x + y * m_Width };
+			const float luminance{ std::min(GetLuminance(ColorRGB{ input[0][tapIndex], input[1][tapIndex], input[2][tapIndex] }), 1.f) };
+			luminanceSum += luminance;
+			squaredLuminanceSum += luminance * luminance;
+			++nrOfNeighbors;
+		}
+	}
+
+	const float meanLuminance{ luminanceSum / nrOfNeighbors };
+	return std::max(squaredLuminanceSum / nrOfNeighbors - meanLuminance * meanLuminance, 0.f);
+}
+
+void Denoiser::FilterTile(uint32_t tileIndex, const ConstLevelPlanes& source, const LevelPlanes& destination, int step, bool remodulate) const
+{
+	const int tileX{ static_cast<int>(tileIndex % m_NrOfTilesX) * m_TileSize };
+	const int tileY{ static_cast<int>(tileIndex / m_NrOfTilesX) * m_TileSize };
+	const int tileWidth{ std::min(m_TileSize, m_Width - tileX) };
+	const int tileHeight{ std::min(m_TileSize, m_Height - tileY) };
+
+#if defined(MATH_AVX2)
+	//the edge stopping functions are all exponentials, their distances get summed straight in base 2 and negated,
+	//so one 2^x of the sum covers them all and the kernel weight too
+	const __m256 luminanceSigma{ _mm256_set1_ps(m_LuminanceSigma * m_LuminanceSigma) };
+	const __m256 minVariance{ _mm256_set1_ps(MinVariance) };
+	const __m256 normalPower{ _mm256_set1_ps(m_NormalPower * Log2E) };
+	const __m256 depthSigma{ _mm256_set1_ps(m_DepthSigma * step) };
+	const __m256 minDepth{ _mm256_set1_ps(1e-3f) };
+	const __m256 minAlbedo{ _mm256_set1_ps(m_MinAlbedo) };
+	const __m256 negativeLog2E{ _mm256_set1_ps(-Log2E) };
+	const __m256 one{ _mm256_set1_ps(1.f) };
+	const __m256 signMask{ _mm256_set1_ps(-0.f) };
+	const __m256i laneOffsets{ _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7) };
+#endif
+
+	for (int y{ tileY }; y < tileY + tileHeight; ++y)
+	{
+		for (int x{ tileX }; x < tileX + tileWidth; x += 8)
+		{
+			const int blockWidth{ std::min(8, tileX + tileWidth - x) };
+
+#if defined(MATH_AVX2)
+			//8 pixels at once, the taps that leave the image at the top or bottom are skipped for all of them
+			//and the ones that leave it at the sides only for the pixels they leave it for
+			if (blockWidth == 8)
+			{
+				const int pixelIndex{ x + y * m_Width };
+				const __m256 red{ _mm256_loadu_ps(&source[0][pixelIndex]) };
+				const __m256 green{ _mm256_loadu_ps(&source[1][pixelIndex]) };
+				const __m256 blue{ _mm256_loadu_ps(&source[2][pixelIndex]) };
+				const __m256 variance{ _mm256_loadu_ps(&source[3][pixelIndex]) };
+				const __m256 luminance{ _mm256_loadu_ps(&source[4][pixelIndex]) };
+				const __m256 normalX{ _mm256_mul_ps(_mm256_loadu_ps(&m_NormalX[pixelIndex]), normalPower) };
+				const __m256 normalY{ _mm256_mul_ps(_mm256_loadu_ps(&m_NormalY[pixelIndex]), normalPower) };
+				const __m256 normalZ{ _mm256_mul_ps(_mm256_loadu_ps(&m_NormalZ[pixelIndex]), normalPower) };
+				const __m256 depth{ _mm256_loadu_ps(&m_Depth[pixelIndex]) };
+
+				//noisier pixels accept bigger differences, depth differences are relative and grow with the step
+				//(a slanted plane drifts further away over more pixels)
+				const __m256 luminanceScale{ _mm256_div_ps(negativeLog2E, _mm256_fmadd_ps(luminanceSigma, variance, minVariance)) };
+				const __m256 depthScale{ _mm256_div_ps(negativeLog2E, _mm256_fmadd_ps(depthSigma, depth, minDepth)) };
+
+				__m256 weightSum{ _mm256_set1_ps(Kernel[1] * Kernel[1]) };
+				__m256 redSum{ _mm256_mul_ps(red, weightSum) };
+				__m256 greenSum{ _mm256_mul_ps(green, weightSum) };
+				__m256 blueSum{ _mm256_mul_ps(blue, weightSum) };
+				__m256 varianceSum{ _mm256_mul_ps(variance, _mm256_mul_ps(weightSum, weightSum)) };
+
+				for (int dx{ -1 }; dx <= 1; ++dx)
+				{
+					//lanes whose tap is inside the image, the others get loaded as 0 and weigh nothing
+					const int tapX{ x + dx * step };
+					const __m256i tapLanes{ _mm256_add_epi32(laneOffsets, _mm256_set1_epi32(tapX)) };
+					const __m256i insideLanes{ _mm256_andnot_si256(_mm256_cmpgt_epi32(_mm256_setzero_si256(), tapLanes),
+						_mm256_cmpgt_epi32(_mm256_set1_epi32(m_Width), tapLanes)) };
+
+					//a compile time flag, so the columns that are all inside (nearly all of them) don't pay for the masks
+					const auto addTaps = [&](auto isInside)
+					{
+						for (int dy{ -1 }; dy <= 1; ++dy)
+						{
+							const int tapY{ y + dy * step };
+							if ((dx == 0 && dy == 0) || tapY < 0 || tapY >= m_Height)
+								continue;
+
+							const int tapIndex{ tapX + tapY * m_Width };
+							const auto load = [&](const float* pPlane)
+							{
+								if constexpr (isInside)
+									return _mm256_loadu_ps(pPlane + tapIndex);
+								else
+									return _mm256_maskload_ps(pPlane + tapIndex, insideLanes);
+							};
+							const __m256 tapRed{ load(source[0]) };
+							const __m256 tapGreen{ load(source[1]) };
+							const __m256 tapBlue{ load(source[2]) };
+
+							const __m256 luminanceDifference{ _mm256_sub_ps(load(source[4]), luminance) };
+							const __m256 depthDistance{ _mm256_andnot_ps(signMask, _mm256_sub_ps(load(m_Depth.data()), depth)) };
+							const __m256 cosine{ _mm256_fmadd_ps(load(m_NormalX.data()), normalX,
+								_mm256_fmadd_ps(load(m_NormalY.data()), normalY, _mm256_mul_ps(load(m_NormalZ.data()), normalZ))) };
+
+							//log2(kernel) - log2(e) * (luminance + depth + normal distance), the normal one is power * (1 - cosine)
+							__m256 exponent{ _mm256_fmadd_ps(_mm256_mul_ps(luminanceDifference, luminanceDifference), luminanceScale,
+								_mm256_set1_ps(Log2Kernel[dx + 1] + Log2Kernel[dy + 1] - m_NormalPower * Log2E)) };
+							exponent = _mm256_fmadd_ps(depthDistance, depthScale, exponent);
+							exponent = _mm256_add_ps(exponent, cosine);
+
+							__m256 weight{ Exp2Negative(exponent) };
+							if constexpr (!isInside)
+								weight = _mm256_and_ps(weight, _mm256_castsi256_ps(insideLanes));
+
+							weightSum = _mm256_add_ps(weightSum, weight);
+							redSum = _mm256_fmadd_ps(tapRed, weight, redSum);
+							greenSum = _mm256_fmadd_ps(tapGreen, weight, greenSum);
+							blueSum = _mm256_fmadd_ps(tapBlue, weight, blueSum);
+							varianceSum = _mm256_fmadd_ps(_mm256_mul_ps(weight, weight), load(source[3]), varianceSum);
+						}
+					};
+
+					if (tapX >= 0 && tapX + 8 <= m_Width)
+						addTaps(std::true_type{});
+					else
+						addTaps(std::false_type{});
+				}
+
+				const __m256 scale{ _mm256_div_ps(one, weightSum) };
+				if (remodulate)
+				{
+					_mm256_storeu_ps(&destination[0][pixelIndex], _mm256_mul_ps(redSum, _mm256_mul_ps(scale, _mm256_max_ps(_mm256_loadu_ps(&m_AlbedoRed[pixelIndex]), minAlbedo))));
+					_mm256_storeu_ps(&destination[1][pixelIndex], _mm256_mul_ps(greenSum, _mm256_mul_ps(scale, _mm256_max_ps(_mm256_loadu_ps(&m_AlbedoGreen[pixelIndex]), minAlbedo))));
+					_mm256_storeu_ps(&destination[2][pixelIndex], _mm256_mul_ps(blueSum, _mm256_mul_ps(scale, _mm256_max_ps(_mm256_loadu_ps(&m_AlbedoBlue[pixelIndex]), minAlbedo))));
+					continue;
+				}
+
+				//a weighted mean of independent pixels has the variance sum(weight^2 * variance) / sum(weight)^2
+				const __m256 filteredRed{ _mm256_mul_ps(redSum, scale) };
+				const __m256 filteredGreen{ _mm256_mul_ps(greenSum, scale) };
+				const __m256 filteredBlue{ _mm256_mul_ps(blueSum, scale) };
+				_mm256_storeu_ps(&destination[0][pixelIndex], filteredRed);
+				_mm256_storeu_ps(&destination[1][pixelIndex], filteredGreen);
+				_mm256_storeu_ps(&destination[2][pixelIndex], filteredBlue);
+				_mm256_storeu_ps(&destination[3][pixelIndex], _mm256_mul_ps(varianceSum, _mm256_mul_ps(scale, scale)));
+				_mm256_storeu_ps(&destination[4][pixelIndex], _mm256_fmadd_ps(filteredRed, _mm256_set1_ps(.2126f),
+					_mm256_fmadd_ps(filteredGreen, _mm256_set1_ps(.7152f), _mm256_mul_ps(filteredBlue, _mm256_set1_ps(.0722f)))));
+				continue;
+			}
+#endif
+			//the end of a row that isn't a whole block (or everything without AVX2)
+			for (int px{ x }; px < x + blockWidth; ++px)
+			{
+				FilterPixel(px, y, source, destination, step, remodulate);
+			}
+		}
+	}
+}
+
+void Denoiser::FilterPixel(int px, int py, const ConstLevelPlanes& source, const LevelPlanes& destination, int step, bool remodulate) const
+{
+	const int pixelIndex{ px + py * m_Width };
+	const ColorRGB color{ source[0][pixelIndex], source[1][pixelIndex], source[2][pixelIndex] };
+	const float variance{ source[3][pixelIndex] };
+	const Vector3 normal{ m_NormalX[pixelIndex], m_NormalY[pixelIndex], m_NormalZ[pixelIndex] };
+	const float luminance{ source[4][pixelIndex] };
+	const float luminanceScale{ 1.f / (m_LuminanceSigma * m_LuminanceSigma * variance + MinVariance) };
+	const float depthScale{ 1.f / (m_DepthSigma * step * m_Depth[pixelIndex] + 1e-3f) };
+
+	float weightSum{ Kernel[1] * Kernel[1] };
+	ColorRGB sum{ color * weightSum };
+	float varianceSum{ variance * weightSum * weightSum };
+	for (int dy{ -1 }; dy <= 1; ++dy)
+	{
+		const int tapY{ py + dy * step };
+		if (tapY < 0 || tapY >= m_Height)
+			continue;
+
+		for (int dx{ -1 }; dx <= 1; ++dx)
+		{
+			const int tapX{ px + dx * step };
+			if ((dx == 0 && dy == 0) || tapX < 0 || tapX >= m_Width)
+				continue;
+
+			const int tapIndex{ tapX + tapY * m_Width };
+			const ColorRGB tapColor{ source[0][tapIndex], source[1][tapIndex], source[2][tapIndex] };
+			const Vector3 tapNormal{ m_NormalX[tapIndex], m_NormalY[tapIndex], m_NormalZ[tapIndex] };
+
+			const float luminanceDifference{ source[4][tapIndex] - luminance };
+			const float distance{ luminanceDifference * luminanceDifference * luminanceScale
+				+ std::abs(m_Depth[tapIndex] - m_Depth[pixelIndex]) * depthScale
+				+ std::max(1.f - Vector3::Dot(tapNormal, normal), 0.f) * m_NormalPower };
+
+			const float weight{ Kernel[dx + 1] * Kernel[dy + 1] * std::exp(-std::min(distance, MaxDistance)) };
+			weightSum += weight;
+			sum += tapColor * weight;
+			varianceSum += weight * weight * source[3][tapIndex];
+		}
+	}
+
+	ColorRGB filtered{ sum / weightSum };
+	if (remodulate)
+	{
+		destination[0][pixelIndex] = filtered.r * std::max(m_AlbedoRed[pixelIndex], m_MinAlbedo);
+		destination[1][pixelIndex] = filtered.g * std::max(m_AlbedoGreen[pixelIndex], m_MinAlbedo);
+		destination[2][pixelIndex] = filtered.b * std::max(m_AlbedoBlue[pixelIndex], m_MinAlbedo);
+		return;
+	}
+
+	destination[0][pixelIndex] = filtered.r;
+	destination[1][pixelIndex] = filtered.g;
+	destination[2][pixelIndex] = filtered.b;
+	destination[3][pixelIndex] = varianceSum / (weightSum * weightSum);
+	destination[4][pixelIndex] = GetLuminance(filtered);
+}
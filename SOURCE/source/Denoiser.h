@@ -0,0 +1,105 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "Math.h"
+
+namespace dae
+{
+	class ThreadPool;
+
+	/**
+	 * \brief Edge-avoiding À-trous wavelet filter (Dammertz et al. 2010) over the float HDR planes
+	 * The renderer writes what the camera ray of every pixel hit into the guide planes, the filter only mixes pixels whose
+	 * normal and depth agree and whose light differs by no more than its noise (the variance guidance of SVGF, Schied et al. 2017).
+	 * It filters the light with the albedo divided out, so edges between materials stay sharp without comparing albedos per tap.
+	 */
+	class Denoiser final
+	{
+	public:
+		//three planes, red green blue
+		using Planes = std::array<float*, 3>;
+		using ConstPlanes = std::array<const float*, 3>;
+
+		//drops the history when the size changed
+		void Resize(int width, int height, int tileSize);
+
+		//what the camera ray of a pixel hit, depth is the distance along the ray
+		//a weight below 1 averages it with the earlier samples' guides, so the guides of an edge mix like its accumulated colors do
+		void SetGuide(int pixelIndex, const Vector3& normal, float depth, const ColorRGB& albedo, float weight = 1.f)
+		{
+			m_NormalX[pixelIndex] += (normal.x - m_NormalX[pixelIndex]) * weight;
+			m_NormalY[pixelIndex] += (normal.y - m_NormalY[pixelIndex]) * weight;
+			m_NormalZ[pixelIndex] += (normal.z - m_NormalZ[pixelIndex]) * weight;
+			m_Depth[pixelIndex] += (depth - m_Depth[pixelIndex]) * weight;
+			m_AlbedoRed[pixelIndex] += (albedo.r - m_AlbedoRed[pixelIndex]) * weight;
+			m_AlbedoGreen[pixelIndex] += (albedo.g - m_AlbedoGreen[pixelIndex]) * weight;
+			m_AlbedoBlue[pixelIndex] += (albedo.b - m_AlbedoBlue[pixelIndex]) * weight;
+		}
+		//the ray missed, a zero normal never matches a surface
+		void ClearGuide(int pixelIndex, float weight = 1.f) { SetGuide(pixelIndex, Vector3{}, 0.f, ColorRGB{}, weight); }
+
+		/**
+		 * \brief Filters the noisy planes into the output ones (they can be the same), tile by tile on the pool or the calling thread without one
+		 * \param pVariance variance of every input pixel's luminance (negative = too few samples to tell), nullptr when the caller doesn't know any
+		 * \param temporal averages the light with the earlier frames before filtering and takes the variance from them,
+		 * only for a camera and scene that hold still
+		 * \param resetHistory the earlier frames show something else, the average starts over
+		 * The variances nobody knows are estimated from the neighbors on the same surface, that can't tell noise from detail as well
+		 */
+		void Denoise(ThreadPool* pThreadPool, const ConstPlanes& input, const float* pVariance, const Planes& output, bool temporal, bool resetHistory);
+
+		void SetIterations(int iterations) { m_Iterations = iterations; }
+		int GetIterations() const { return m_Iterations; }
+		uint32_t GetHistoryLength() const { return m_HistoryLength; }
+
+	private:
+		//red, green, blue, the variance of the luminance and the luminance, of the light between two levels
+		//the luminance is stored so the taps only load it, every pixel is a tap of its 8 neighbors per level
+		using LevelPlanes = std::array<float*, 5>;
+		using ConstLevelPlanes = std::array<const float*, 5>;
+
+		//light = color / albedo, blended into the history when temporal, and its variance
+		void DemodulateTile(uint32_t tileIndex, const ConstPlanes& input, const float* pVariance, const LevelPlanes& light, bool temporal, float historyWeight);
+		//variance of the luminance of a pixel and its 8 neighbors, for a pixel that has no history of its own
+		float EstimateVariance(const ConstPlanes& input, int px, int py) const;
+		//one À-trous level, taps step pixels apart; the last level multiplies the albedo back in and drops the variance and luminance
+		void FilterTile(uint32_t tileIndex, const ConstLevelPlanes& source, const LevelPlanes& destination, int step, bool remodulate) const;
+		void FilterPixel(int px, int py, const ConstLevelPlanes& source, const LevelPlanes& destination, int step, bool remodulate) const;
+
+		//passes over every tile, parallel when there is a pool
+		template<typename Task>
+		void ForEachTile(ThreadPool* pThreadPool, const Task& task) const;
+
+		int m_Width{};
+		int m_Height{};
+		int m_TileSize{};
+		int m_NrOfTilesX{};
+		uint32_t m_NrOfTiles{};
+
+		int m_Iterations{ 2 }; //taps 1 and 2 pixels apart, a 7 x 7 footprint; the temporal average does the rest of the smoothing
+		float m_LuminanceSigma{ 4.f }; //standard deviations of its noise the light of two pixels can differ by, the variance drops every level
+		float m_DepthSigma{ .02f }; //relative depth difference per pixel of step
+		float m_NormalPower{ 64.f }; //weight = exp(-power * (1 - cos)), 0.5 at about 8 degrees
+		float m_MinHistoryWeight{ 1.f / 32.f }; //past 32 frames the history becomes an exponential average
+		static constexpr float m_MinAlbedo{ .01f }; //albedo of black surfaces and misses, so the light can be divided out and back in
+
+		//guides
+		std::vector<float> m_NormalX{};
+		std::vector<float> m_NormalY{};
+		std::vector<float> m_NormalZ{};
+		std::vector<float> m_Depth{};
+		std::vector<float> m_AlbedoRed{};
+		std::vector<float> m_AlbedoGreen{};
+		std::vector<float> m_AlbedoBlue{};
+
+		//light, variance and luminance of the frame and the levels in between, ping-ponged
+		std::array<std::array<std::vector<float>, 5>, 2> m_Light{};
+		//averaged light, and the first and second moment of the luminance for the variance
+		std::array<std::vector<float>, 3> m_History{};
+		std::vector<float> m_HistoryLuminance{};
+		std::vector<float> m_HistorySquaredLuminance{};
+		uint32_t m_HistoryLength{};
+	};
+}
@@ -0,0 +1,173 @@
+#include "Headless.h"
+
+//Standard includes
+#include <chrono>
+#include <iostream>
+#include <memory>
+
+//Project includes
+#include "Arguments.h"
+#include "Renderer.h"
+#include "Scene.h"
+#include "Timer.h"
+#include "Trace.h"
+
+namespace dae
+{
+	namespace Headless
+	{
+		bool ParseArguments(int argc, char* args[], int firstArgument, Settings& settings)
+		{
+			const bool isParsed{ Arguments::Parse(argc, args, firstArgument, [&settings](const std::string& argument, const std::string& value)
+			{
+				if (argument == "--scene") settings.sceneName = value;
+				else if (argument == "--width") settings.width = std::stoi(value);
+				else if (argument == "--height") settings.height = std::stoi(value);
+				else if (argument == "--frames") settings.nrOfFrames = std::stoi(value);
+				else if (argument == "--timestep") settings.timeStep = std::stof(value);
+				else if (argument == "--output") settings.outputPath = value;
+				else if (argument == "--trace") settings.tracePath = value;
+				else if (argument == "--progressive" && (value == "on" || value == "off")) settings.progressive = value == "on";
+				else if (argument == "--adaptive" && (value == "on" || value == "off")) settings.adaptive = value == "on";
+				else if (argument == "--tile-error") settings.tileError = std::stof(value);
+				else if (argument == "--error-target") settings.errorTarget = std::stof(value);
+				else if (argument == "--time-budget") settings.timeBudget = std::stof(value);
+				else if (argument == "--sample-heatmap") settings.sampleHeatmapPath = value;
+				else if (argument == "--sampler")
+				{
+					if (!ParseSamplerName(value, settings.sampler))
+					{
+						std::cout << "Unknown sampler " << value << "\n";
+						return Arguments::Result::Rejected;
+					}
+				}
+				else if (argument == "--denoise" && (value == "on" || value == "off")) settings.denoise = value == "on";
+				else if (argument == "--temporal" && (value == "on" || value == "off")) settings.temporal = value == "on";
+				else if (argument == "--shadow-samples") settings.shadowSamples = std::stoi(value);
+				else if (argument == "--light-tree" && (value == "on" || value == "off")) settings.lightTree = value == "on";
+				else if (argument == "--resampling" && (value == "on" || value == "off")) settings.resampling = value == "on";
+				else if (argument == "--light-cutoff") settings.lightCutoff = std::stof(value);
+				else return Arguments::Result::Unknown;
+				return Arguments::Result::Applied;
+			}) };
+			if (!isParsed)
+				return false;
+
+			if (settings.width <= 0 || settings.height <= 0 || settings.nrOfFrames <= 0 || settings.shadowSamples <= 0)
+			{
+				std::cout << "Resolution, frame count and shadow samples have to be positive\n";
+				return false;
+			}
+			return true;
+		}
+
+		int Run(const Settings& settings)
+		{
+			const std::unique_ptr<Scene> pScene{ CreateScene(settings.sceneName) };
+			if (!pScene)
+			{
+				std::cout << "Unknown scene " << settings.sceneName << "\n";
+				return 1;
+			}
+			pScene->Initialize();
+
+			Renderer renderer{ settings.width, settings.height };
+			Timer timer{};
+			renderer.SetSampler(settings.sampler);
+			renderer.SetMaxShadowSamples(settings.shadowSamples);
+			if (settings.progressive || settings.adaptive)
+			{
+				renderer.ToggleProgressive();
+			}
+			if (settings.adaptive)
+			{
+				renderer.ToggleAdaptiveSampling();
+				renderer.SetAdaptiveTargets(settings.tileError, settings.errorTarget, settings.timeBudget);
+			}
+
+			if (settings.denoise)
+			{
+				renderer.ToggleDenoiser();
+			}
+			if (!settings.temporal)
+			{
+				renderer.ToggleTemporalDenoising();
+			}
+			if (!settings.lightTree)
+			{
+				renderer.ToggleLightTree();
+			}
+			if (settings.resampling)
+			{
+				renderer.ToggleLightResampling();
+			}
+			if (settings.lightCutoff > 0.f)
+			{
+				renderer.SetLightCutoff(settings.lightCutoff);
+				renderer.ToggleLightCulling();
+			}
+
+			if (!settings.tracePath.empty())
+			{
+				Trace::Start();
+			}
+
+			const auto start{ std::chrono::high_resolution_clock::now() };
+			int nrOfFrames{};
+			double denoiseMilliseconds{};
+			for (; nrOfFrames < settings.nrOfFrames && !renderer.IsAccumulationFinished(); ++nrOfFrames)
+			{
+				timer.Step(settings.timeStep);
+				{
+					TRACE_SCOPE("Scene::Update");
+					pScene->Update(&timer);
+				}
+				renderer.Render(pScene.get());
+				denoiseMilliseconds += renderer.GetDenoiseTime();
+			}
+			const auto end{ std::chrono::high_resolution_clock::now() };
+
+			if (!settings.tracePath.empty())
+			{
+				Trace::Stop();
+				if (!Trace::WriteJson(settings.tracePath))
+					return 1;
+				std::cout << "Saved " << settings.tracePath << "\n";
+			}
+
+			const double totalMilliseconds{ std::chrono::duration<double, std::milli>(end - start).count() };
+			std::cout << "**HEADLESS** " << settings.sceneName << " " << settings.width << "x" << settings.height << ", "
+				<< nrOfFrames << " frames in " << totalMilliseconds << " ms (" << totalMilliseconds / nrOfFrames << " ms/frame)\n";
+			if (settings.progressive || settings.adaptive)
+			{
+				std::cout << "Samples/pixel: " << renderer.GetSamplesPerPixel() << ", noise: " << renderer.EstimateNoise() * 100.f << "%\n";
+			}
+			if (settings.denoise)
+			{
+				std::cout << "Denoise: " << denoiseMilliseconds / nrOfFrames << " ms/frame (" << denoiseMilliseconds * 100.0 / totalMilliseconds << "% of the frame time)\n";
+			}
+#if defined(RAY_STATS)
+			std::cout << "Last frame:\n";
+			RayStats::Print(std::cout, renderer.GetFrameCounters(), settings.width * settings.height);
+#endif
+
+			if (renderer.SaveBufferToImage(settings.outputPath.c_str()))
+			{
+				std::cout << "Something went wrong. " << settings.outputPath << " not saved!\n";
+				return 1;
+			}
+			std::cout << "Saved " << settings.outputPath << "\n";
+
+			if (!settings.sampleHeatmapPath.empty())
+			{
+				if (renderer.SaveSampleHeatmap(settings.sampleHeatmapPath.c_str()))
+				{
+					std::cout << "Something went wrong. " << settings.sampleHeatmapPath << " not saved!\n";
+					return 1;
+				}
+				std::cout << "Saved " << settings.sampleHeatmapPath << "\n";
+			}
+			return 0;
+		}
+	}
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <string>
+
+#include "Sampler.h"
+
+namespace dae
+{
+	namespace Headless
+	{
+		struct Settings
+		{
+			std::string sceneName{ "ReferenceScene" };
+			int width{ 640 };
+			int height{ 480 };
+			int nrOfFrames{ 1 };
+			float timeStep{ 1.f / 60.f }; //fixed, so every run animates the scene the same way
+			std::string outputPath{ "RayTracing_Headless.bmp" };
+			std::string tracePath{}; //empty = no trace
+			bool progressive{ false }; //average the frames, only converges when the scene holds still (--timestep 0)
+			bool adaptive{ false }; //implies progressive, stops early once the accumulation finished
+			float tileError{ .01f };
+			float errorTarget{ .005f };
+			float timeBudget{ 0.f }; //seconds, 0 = only the frame count limits the run
+			std::string sampleHeatmapPath{}; //empty = not saved
+			SamplerType sampler{ SamplerType::Sobol };
+			bool denoise{ false };
+			bool temporal{ true }; //of the denoiser, only without progressive
+			int shadowSamples{ 16 }; //most shadow rays per area light and hit, small lights get fewer
+			bool lightTree{ true }; //picks a few lights per hit in scenes with many
+			bool resampling{ false }; //one reservoir-picked light sample per camera ray hit, only without progressive
+			float lightCutoff{}; //radiance below which lights get culled, 0 = no culling
+		};
+
+		/**
+		 * \brief Reads "--scene <class> --width <px> --height <px> --frames <n> --timestep <s> --output <path> --trace <path> --progressive <on|off>
+		 * --adaptive <on|off> --tile-error <fraction> --error-target <fraction> --time-budget <s> --sample-heatmap <path> --sampler <random|sobol|bluenoise>
+		 * --denoise <on|off> --temporal <on|off> --shadow-samples <n> --light-tree <on|off> --resampling <on|off>
+		 * --light-cutoff <radiance>", every flag is optional
+		 * \param firstArgument index of the first argument after the mode switch
+		 * \return false when an argument is unknown or has no valid value
+		 */
+		bool ParseArguments(int argc, char* args[], int firstArgument, Settings& settings);
+
+		/**
+		 * \brief Renders the frames into an offscreen buffer and saves the last one, the video subsystem is never touched
+		 * \return exit code for main
+		 */
+		int Run(const Settings& settings);
+	}
+}
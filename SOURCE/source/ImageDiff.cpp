@@ -0,0 +1,204 @@
+#include "ImageDiff.h"
+
+//Standard includes
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <iostream>
+#include <limits>
+#include <memory>
+
+//External includes
+#include "SDL.h"
+#include "SDL_surface.h"
+
+//Project includes
+#include "Arguments.h"
+#include "Renderer.h"
+#include "Scene.h"
+#include "Timer.h"
+
+namespace dae
+{
+	namespace ImageDiff
+	{
+		struct DiffResult
+		{
+			int maxError{};
+			double psnr{}; //infinity for identical images
+			int nrOfDifferingPixels{};
+		};
+
+		bool ParseArguments(int argc, char* args[], int firstArgument, Settings& settings)
+		{
+			const bool isParsed{ Arguments::Parse(argc, args, firstArgument, [&settings](const std::string& argument, const std::string& value)
+			{
+				if (argument == "--scenes") settings.sceneNames = Arguments::Split(value, ',');
+				else if (argument == "--width") settings.width = std::stoi(value);
+				else if (argument == "--height") settings.height = std::stoi(value);
+				else if (argument == "--golden") settings.goldenDirectory = value;
+				else if (argument == "--diff") settings.diffDirectory = value;
+				else if (argument == "--update" && (value == "on" || value == "off")) settings.updateGoldens = value == "on";
+				else if (argument == "--max-error") settings.maxError = std::stoi(value);
+				else if (argument == "--min-psnr") settings.minPsnr = std::stof(value);
+				else if (argument == "--threshold") settings.pixelThreshold = std::stoi(value);
+				else if (argument == "--max-differing") settings.maxDifferingPixels = std::stoi(value);
+				else if (argument == "--light-cutoff") settings.lightCutoff = std::stof(value);
+				else return Arguments::Result::Unknown;
+				return Arguments::Result::Applied;
+			}) };
+			if (!isParsed)
+				return false;
+
+			if (settings.width <= 0 || settings.height <= 0)
+			{
+				std::cout << "Resolution has to be positive\n";
+				return false;
+			}
+			return true;
+		}
+
+		static uint8_t GetChannel(const SDL_Surface* pSurface, int pixelIndex, int channel)
+		{
+			const uint32_t pixel{ static_cast<const uint32_t*>(pSurface->pixels)[pixelIndex] };
+			const SDL_PixelFormat* pFormat{ pSurface->format };
+			const uint8_t shifts[3]{ pFormat->Rshift, pFormat->Gshift, pFormat->Bshift };
+			return static_cast<uint8_t>(pixel >> shifts[channel]);
+		}
+
+		//both surfaces are 32 bit with the same size, pDiff gets |a - b| scaled up so small errors stay visible
+		static DiffResult Compare(const SDL_Surface* pActual, const SDL_Surface* pGolden, int pixelThreshold, SDL_Surface* pDiff)
+		{
+			constexpr int diffScale{ 8 };
+
+			DiffResult result{};
+			double squaredErrorSum{};
+
+			const int nrOfPixels{ pActual->w * pActual->h };
+			uint32_t* pDiffPixels{ static_cast<uint32_t*>(pDiff->pixels) };
+			for (int pixelIndex{}; pixelIndex < nrOfPixels; ++pixelIndex)
+			{
+				int errors[3]{};
+				int pixelError{};
+				for (int channel{}; channel < 3; ++channel)
+				{
+					errors[channel] = std::abs(GetChannel(pActual, pixelIndex, channel) - GetChannel(pGolden, pixelIndex, channel));
+					pixelError = std::max(pixelError, errors[channel]);
+					squaredErrorSum += errors[channel] * errors[channel];
+				}
+
+				result.maxError = std::max(result.maxError, pixelError);
+				if (pixelError > pixelThreshold)
+					++result.nrOfDifferingPixels;
+
+				const auto toDiff = [&](int error) { return static_cast<Uint8>(std::min(error * diffScale, 255)); };
+				pDiffPixels[pixelIndex] = SDL_MapRGB(pDiff->format, toDiff(errors[0]), toDiff(errors[1]), toDiff(errors[2]));
+			}
+
+			const double meanSquaredError{ squaredErrorSum / (3.0 * nrOfPixels) };
+			result.psnr = meanSquaredError > 0 ? 10.0 * std::log10(255.0 * 255.0 / meanSquaredError) : std::numeric_limits<double>::infinity();
+			return result;
+		}
+
+		//renders the first frame the scene shows, without advancing its animation
+		static bool RenderScene(const std::string& sceneName, Renderer& renderer)
+		{
+			const std::unique_ptr<Scene> pScene{ CreateScene(sceneName) };
+			if (!pScene)
+			{
+				std::cout << "Unknown scene " << sceneName << "\n";
+				return false;
+			}
+			pScene->Initialize();
+
+			Timer timer{};
+			timer.Step(0.f);
+			pScene->Update(&timer);
+			renderer.Render(pScene.get());
+			return true;
+		}
+
+		//returns whether the scene passed
+		static bool CheckScene(const Settings& settings, const std::string& sceneName, Renderer& renderer)
+		{
+			const std::string goldenPath{ settings.goldenDirectory + "/" + sceneName + ".bmp" };
+			if (settings.updateGoldens)
+			{
+				if (renderer.SaveBufferToImage(goldenPath.c_str()))
+				{
+					std::cout << sceneName << ": could not write " << goldenPath << "\n";
+					return false;
+				}
+				std::cout << sceneName << ": saved " << goldenPath << "\n";
+				return true;
+			}
+
+			SDL_Surface* pLoaded{ SDL_LoadBMP(goldenPath.c_str()) };
+			if (!pLoaded)
+			{
+				std::cout << sceneName << ": FAIL, no golden at " << goldenPath << " (run with --update on to create it)\n";
+				return false;
+			}
+
+			//whatever the BMP was saved as, compare in the renderer's own layout
+			SDL_Surface* pGolden{ SDL_ConvertSurfaceFormat(pLoaded, renderer.GetBuffer()->format->format, 0) };
+			SDL_FreeSurface(pLoaded);
+			if (!pGolden || pGolden->w != settings.width || pGolden->h != settings.height)
+			{
+				std::cout << sceneName << ": FAIL, " << goldenPath << " is not a " << settings.width << "x" << settings.height << " image\n";
+				SDL_FreeSurface(pGolden);
+				return false;
+			}
+
+			SDL_Surface* pDiff{ SDL_CreateRGBSurfaceWithFormat(0, settings.width, settings.height, 32, SDL_PIXELFORMAT_ARGB8888) };
+			const DiffResult result{ Compare(renderer.GetBuffer(), pGolden, settings.pixelThreshold, pDiff) };
+			SDL_FreeSurface(pGolden);
+
+			const bool passed{ result.maxError <= settings.maxError && result.psnr >= settings.minPsnr && result.nrOfDifferingPixels <= settings.maxDifferingPixels };
+			std::cout << sceneName << ": " << (passed ? "PASS" : "FAIL") << ", max error " << result.maxError << ", PSNR " << result.psnr
+				<< " dB, " << result.nrOfDifferingPixels << " differing pixels\n";
+
+			if (!passed)
+			{
+				std::filesystem::create_directories(settings.diffDirectory);
+				const std::string actualPath{ settings.diffDirectory + "/" + sceneName + "_actual.bmp" };
+				const std::string diffPath{ settings.diffDirectory + "/" + sceneName + "_diff.bmp" };
+				if (!renderer.SaveBufferToImage(actualPath.c_str()) && !SDL_SaveBMP(pDiff, diffPath.c_str()))
+					std::cout << ">> saved " << actualPath << " and " << diffPath << "\n";
+			}
+			SDL_FreeSurface(pDiff);
+			return passed;
+		}
+
+		int Run(const Settings& settings)
+		{
+			if (settings.updateGoldens)
+				std::filesystem::create_directories(settings.goldenDirectory);
+
+			std::cout << "**IMAGE DIFF** max error " << settings.maxError << ", min PSNR " << settings.minPsnr << " dB, at most "
+				<< settings.maxDifferingPixels << " pixels off by more than " << settings.pixelThreshold << "\n";
+
+			Renderer renderer{ settings.width, settings.height };
+			if (settings.lightCutoff > 0.f)
+			{
+				renderer.SetLightCutoff(settings.lightCutoff);
+				renderer.ToggleLightCulling();
+			}
+
+			int nrOfFailures{};
+			for (const std::string& sceneName : settings.sceneNames)
+			{
+				if (!RenderScene(sceneName, renderer) || !CheckScene(settings, sceneName, renderer))
+					++nrOfFailures;
+			}
+
+			if (nrOfFailures > 0)
+			{
+				std::cout << nrOfFailures << " of " << settings.sceneNames.size() << " scenes failed\n";
+				return 1;
+			}
+			return 0;
+		}
+	}
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <string>
+#include <vector>
+
+namespace dae
+{
+	namespace ImageDiff
+	{
+		struct Settings
+		{
+			std::vector<std::string> sceneNames{ "ReferenceScene", "BunnyScene", "ExtraScene", "SphereGridScene", "TriangleFieldScene", "AreaLightScene", "ManyLightsScene" };
+			int width{ 640 };
+			int height{ 480 };
+			std::string goldenDirectory{ "Golden" }; //relative to the working directory, the project directory when run from Visual Studio
+			std::string diffDirectory{ "Diff" };
+			bool updateGoldens{ false }; //write the renders as the new goldens instead of comparing
+			float lightCutoff{}; //renders with the light culling at this radiance, 0 = off; goldens made without it show what the culling costs
+
+			//a scene fails when any of these is exceeded, errors are per channel in 8 bit steps
+			int maxError{ 16 };
+			float minPsnr{ 40.f }; //dB
+			int pixelThreshold{ 2 }; //a pixel differs when a channel is off by more than this
+			int maxDifferingPixels{ 100 };
+		};
+
+		/**
+		 * \brief Reads "--scenes a,b --width <px> --height <px> --golden <dir> --diff <dir> --update <on|off>
+		 *	--max-error <0-255> --min-psnr <dB> --threshold <0-255> --max-differing <pixels>
+		 *	--light-cutoff <radiance>"
+		 * \param firstArgument index of the first argument after the mode switch
+		 * \return false when an argument is unknown or has no valid value
+		 */
+		bool ParseArguments(int argc, char* args[], int firstArgument, Settings& settings);
+
+		/**
+		 * \brief Renders every scene at its start camera and compares it per pixel to <golden>/<scene>.bmp
+		 * Failing scenes get <diff>/<scene>_actual.bmp and an amplified <diff>/<scene>_diff.bmp
+		 * \return exit code for main, 1 when a scene failed or has no golden
+		 */
+		int Run(const Settings& settings);
+	}
+}
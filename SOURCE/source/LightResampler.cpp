@@ -0,0 +1,323 @@
+#include "LightResampler.h"
+
+//Standard includes
+#include <algorithm>
+#include <cmath>
+
+//Project includes
+#include "LightTree.h"
+#include "Material.h"
+#include "ThreadPool.h"
+#include "Trace.h"
+
+using namespace dae;
+
+namespace
+{
+	float GetLuminance(const ColorRGB& color) { return .2126f * color.r + .7152f * color.g + .0722f * color.b; }
+}
+
+void LightResampler::Resize(int width, int height, int tileSize)
+{
+	if (width == m_Width && height == m_Height && tileSize == m_TileSize)
+		return;
+
+	m_Width = width;
+	m_Height = height;
+	m_TileSize = tileSize;
+	m_NrOfTilesX = (width + tileSize - 1) / tileSize;
+	m_NrOfTiles = static_cast<uint32_t>(m_NrOfTilesX * ((height + tileSize - 1) / tileSize));
+
+	const size_t nrOfPixels{ static_cast<size_t>(width) * height };
+	for (std::vector<Surface>& surfaces : m_Surfaces)
+		surfaces.assign(nrOfPixels, Surface{});
+	for (std::vector<Reservoir>& reservoirs : m_Reservoirs)
+		reservoirs.assign(nrOfPixels, Reservoir{});
+	m_TemporalReservoirs.assign(nrOfPixels, Reservoir{});
+	m_HasHistory = false;
+}
+
+template<typename Task>
+void LightResampler::ForEachTile(ThreadPool* pThreadPool, const Task& task) const
+{
+	if (pThreadPool)
+	{
+		pThreadPool->ParallelFor(m_NrOfTiles, [&](uint32_t tileIndex, int) { task(tileIndex); });
+		return;
+	}
+
+	for (uint32_t tileIndex{}; tileIndex < m_NrOfTiles; ++tileIndex)
+	{
+		task(tileIndex);
+	}
+}
+
+void LightResampler::Resample(ThreadPool* pThreadPool, const std::vector<Light>& lights, const std::vector<Material>& materials, const LightTree* pLightTree,
+	const View& view, SamplerType samplerType, uint32_t seed, uint32_t frameIndex, bool resetHistory)
+{
+	m_View = view;
+	const bool useHistory{ m_HasHistory && !resetHistory };
+
+	{
+		TRACE_SCOPE("ResampleCandidates");
+		ForEachTile(pThreadPool, [&](uint32_t tileIndex) { SampleCandidatesTile(tileIndex, lights, materials, pLightTree, samplerType, seed, frameIndex, useHistory); });
+	}
+	{
+		TRACE_SCOPE("ResampleNeighbors");
+		ForEachTile(pThreadPool, [&](uint32_t tileIndex) { ReuseNeighborsTile(tileIndex, lights, materials, samplerType, seed, frameIndex); });
+	}
+}
+
+void LightResampler::EndFrame()
+{
+	m_PreviousView = m_View;
+	m_Current ^= 1;
+	m_HasHistory = true;
+}
+
+bool LightResampler::SampleLight(const Light& light, const HitRecord& hit, const LightPoint& point, LightUtils::LightSample& sample)
+{
+	if (LightUtils::IsAreaLight(light))
+	{
+		if (!LightUtils::SampleAreaLight(light, hit.origin, point.u, point.v, sample))
+			return false;
+	}
+	else
+	{
+		sample.direction = LightUtils::GetDirectionToLight(light, hit.origin);
+		sample.distance = sample.direction.Normalize();
+		sample.radiance = LightUtils::GetRadiance(light, hit.origin);
+	}
+	return Vector3::Dot(hit.normal, sample.direction) > 0.f;
+}
+
+float LightResampler::GetTargetPdf(const std::vector<Light>& lights, const std::vector<Material>& materials, const Surface& surface, const LightPoint& point)
+{
+	if (point.lightIndex < 0 || !surface.hit.didHit)
+		return 0.f;
+
+	LightUtils::LightSample sample{};
+	if (!SampleLight(lights[point.lightIndex], surface.hit, point, sample))
+		return 0.f;
+
+	const float observedArea{ Vector3::Dot(surface.hit.normal, sample.direction) };
+	const ColorRGB light{ MaterialShading::Shade(materials[surface.hit.materialIndex], surface.hit.normal, sample.direction, surface.view)
+		* sample.radiance * observedArea };
+	return std::max(GetLuminance(light), 0.f);
+}
+
+bool LightResampler::IsSimilar(const Vector3& normal, float depth, const Surface& other)
+{
+	return other.hit.didHit
+		&& Vector3::Dot(normal, other.hit.normal) >= m_MinNormalCos
+		&& std::abs(other.hit.t - depth) <= m_MaxRelativeDepth * depth;
+}
+
+bool LightResampler::Reproject(const Vector3& point, int& pixelIndex, float& depth) const
+{
+	//the inverse of the camera ray of a pixel center: (cx, cy, 1) along right, up and forward
+	const Vector3 toPoint{ point - m_PreviousView.origin };
+	const float z{ Vector3::Dot(toPoint, m_PreviousView.forward) };
+	if (z <= 0.f)
+		return false;
+
+	const float cx{ Vector3::Dot(toPoint, m_PreviousView.right) / z };
+	const float cy{ Vector3::Dot(toPoint, m_PreviousView.up) / z };
+	const int px{ static_cast<int>(std::floor((cx / (m_PreviousView.aspectRatio * m_PreviousView.fovScale) + 1.f) * .5f * m_Width)) };
+	const int py{ static_cast<int>(std::floor((1.f - cy / m_PreviousView.fovScale) * .5f * m_Height)) };
+	if (px < 0 || px >= m_Width || py < 0 || py >= m_Height)
+		return false;
+
+	pixelIndex = px + py * m_Width;
+	depth = toPoint.Magnitude();
+	return true;
+}
+
+template<size_t maxInputs>
+LightResampler::Reservoir LightResampler::Merge(const std::vector<Light>& lights, const std::vector<Material>& materials, const Surface& surface, const Reservoir& own,
+	const std::array<const Reservoir*, maxInputs>& inputs, const std::array<const Surface*, maxInputs>& inputSurfaces, int nrOfInputs, Sampler& sampler, int firstStep)
+{
+	//the own reservoir first, its target pdf is already the one at this surface
+	std::array<const Reservoir*, maxInputs + 1> reservoirs{ &own };
+	std::array<const Surface*, maxInputs + 1> surfaces{ &surface };
+	for (int idx{}; idx < nrOfInputs; ++idx)
+	{
+		reservoirs[idx + 1] = inputs[idx];
+		surfaces[idx + 1] = inputSurfaces[idx];
+	}
+
+	Reservoir merged{};
+	for (int idx{}; idx <= nrOfInputs; ++idx)
+	{
+		const Reservoir& input{ *reservoirs[idx] };
+		const float targetPdf{ input.weight <= 0.f ? 0.f : (idx == 0 ? input.targetPdf : GetTargetPdf(lights, materials, surface, input.sample)) };
+
+		//balance heuristic: the sample's share of how likely every reservoir was to pick it, by their candidates and target pdfs
+		//a sample only one surface likes gets all of its own weight, a neighbor's light that's much brighter here doesn't turn into a firefly
+		float resamplingWeight{};
+		if (targetPdf > 0.f)
+		{
+			float sum{};
+			for (int other{}; other <= nrOfInputs; ++other)
+			{
+				const float otherTargetPdf{ other == idx ? input.targetPdf : (other == 0 ? targetPdf : GetTargetPdf(lights, materials, *surfaces[other], input.sample)) };
+				sum += reservoirs[other]->nrOfCandidates * otherTargetPdf;
+			}
+			resamplingWeight = input.nrOfCandidates * input.targetPdf / sum * targetPdf * input.weight;
+		}
+
+		merged.Add(input.sample, targetPdf, resamplingWeight, input.nrOfCandidates,
+			sampler.Get1D(SampleDimension::GetResampling(firstStep + idx) + SampleDimension::Keep));
+	}
+
+	merged.weight = merged.targetPdf > 0.f ? merged.weightSum / merged.targetPdf : 0.f;
+	return merged;
+}
+
+void LightResampler::SampleCandidatesTile(uint32_t tileIndex, const std::vector<Light>& lights, const std::vector<Material>& materials, const LightTree* pLightTree,
+	SamplerType samplerType, uint32_t seed, uint32_t frameIndex, bool useHistory)
+{
+	const int tileX{ static_cast<int>(tileIndex % m_NrOfTilesX) * m_TileSize };
+	const int tileY{ static_cast<int>(tileIndex / m_NrOfTilesX) * m_TileSize };
+	const int tileWidth{ std::min(m_TileSize, m_Width - tileX) };
+	const int tileHeight{ std::min(m_TileSize, m_Height - tileY) };
+
+	const std::vector<Surface>& surfaces{ m_Surfaces[m_Current] };
+	const std::vector<Surface>& previousSurfaces{ m_Surfaces[m_Current ^ 1] };
+	const std::vector<Reservoir>& previousReservoirs{ m_Reservoirs[m_Current ^ 1] };
+	const int nrOfLights{ static_cast<int>(lights.size()) };
+
+	Sampler sampler{ samplerType, seed };
+	std::array<LightTree::Pick, m_NrOfCandidates> picks{};
+	std::array<LightPoint, m_NrOfCandidates> points{};
+	std::array<float, m_NrOfCandidates> targetPdfs{};
+	std::array<float, m_NrOfCandidates> weights{};
+
+	for (int y{}; y < tileHeight; ++y)
+	{
+		for (int x{}; x < tileWidth; ++x)
+		{
+			const int pixelIndex{ (tileX + x) + ((tileY + y) * m_Width) };
+			const Surface& surface{ surfaces[pixelIndex] };
+			Reservoir& reservoir{ m_TemporalReservoirs[pixelIndex] };
+			reservoir = Reservoir{};
+			if (!surface.hit.didHit || nrOfLights == 0)
+				continue;
+
+			sampler.StartPixel(tileX + x, tileY + y, frameIndex);
+
+			//stratified candidates, from the tree or uniformly out of all lights
+			const float pickU{ sampler.Get1D(SampleDimension::GetResampling(0) + SampleDimension::LightPick) };
+			if (pLightTree)
+				pLightTree->Sample(surface.hit.origin, surface.hit.normal, pickU, m_NrOfCandidates, picks.data());
+
+			for (int candidate{}; candidate < m_NrOfCandidates; ++candidate)
+			{
+				LightPoint& point{ points[candidate] };
+				point = LightPoint{};
+				float probability{};
+				if (pLightTree)
+				{
+					point.lightIndex = picks[candidate].lightIndex;
+					probability = picks[candidate].probability;
+				}
+				else
+				{
+					point.lightIndex = std::min(static_cast<int>((candidate + pickU) / m_NrOfCandidates * nrOfLights), nrOfLights - 1);
+					probability = 1.f / nrOfLights;
+				}
+				if (point.lightIndex >= 0 && LightUtils::IsAreaLight(lights[point.lightIndex]))
+				{
+					point.u = sampler.Get1D(SampleDimension::GetResampling(candidate) + SampleDimension::LightU);
+					point.v = sampler.Get1D(SampleDimension::GetResampling(candidate) + SampleDimension::LightV);
+				}
+
+				targetPdfs[candidate] = probability > 0.f ? GetTargetPdf(lights, materials, surface, point) : 0.f;
+				weights[candidate] = probability > 0.f ? targetPdfs[candidate] / probability : 0.f;
+				reservoir.weightSum += weights[candidate];
+			}
+			reservoir.nrOfCandidates = static_cast<float>(m_NrOfCandidates);
+
+			//all the weights are known up front, so one random number over their sum picks the sample instead of one per candidate
+			const float threshold{ sampler.Get1D(SampleDimension::GetResampling(0) + SampleDimension::Keep) * reservoir.weightSum };
+			float cumulativeWeight{};
+			for (int candidate{}; candidate < m_NrOfCandidates; ++candidate)
+			{
+				if (weights[candidate] <= 0.f)
+					continue;
+
+				reservoir.sample = points[candidate];
+				reservoir.targetPdf = targetPdfs[candidate];
+				cumulativeWeight += weights[candidate];
+				if (threshold < cumulativeWeight)
+					break;
+			}
+			reservoir.weight = reservoir.targetPdf > 0.f ? reservoir.weightSum / (reservoir.nrOfCandidates * reservoir.targetPdf) : 0.f;
+
+			//last frame's reservoir of the same spot, its candidates capped so old samples fade out
+			int previousIndex{};
+			float previousDepth{};
+			if (!useHistory || !Reproject(surface.hit.origin, previousIndex, previousDepth) || !IsSimilar(surface.hit.normal, previousDepth, previousSurfaces[previousIndex]))
+				continue;
+
+			Reservoir history{ previousReservoirs[previousIndex] };
+			history.nrOfCandidates = std::min(history.nrOfCandidates, m_MaxHistoryCandidates);
+			reservoir = Merge<1>(lights, materials, surface, reservoir, { &history }, { &previousSurfaces[previousIndex] }, 1, sampler, m_NrOfCandidates);
+		}
+	}
+}
+
+void LightResampler::ReuseNeighborsTile(uint32_t tileIndex, const std::vector<Light>& lights, const std::vector<Material>& materials,
+	SamplerType samplerType, uint32_t seed, uint32_t frameIndex)
+{
+	const int tileX{ static_cast<int>(tileIndex % m_NrOfTilesX) * m_TileSize };
+	const int tileY{ static_cast<int>(tileIndex / m_NrOfTilesX) * m_TileSize };
+	const int tileWidth{ std::min(m_TileSize, m_Width - tileX) };
+	const int tileHeight{ std::min(m_TileSize, m_Height - tileY) };
+
+	const std::vector<Surface>& surfaces{ m_Surfaces[m_Current] };
+	std::vector<Reservoir>& reservoirs{ m_Reservoirs[m_Current] };
+
+	//the temporal merge took the steps of the candidates and the one after them
+	constexpr int firstStep{ m_NrOfCandidates + 2 };
+
+	Sampler sampler{ samplerType, seed };
+	std::array<const Reservoir*, m_NrOfNeighbors> neighbors{};
+	std::array<const Surface*, m_NrOfNeighbors> neighborSurfaces{};
+
+	for (int y{}; y < tileHeight; ++y)
+	{
+		for (int x{}; x < tileWidth; ++x)
+		{
+			const int px{ tileX + x };
+			const int py{ tileY + y };
+			const int pixelIndex{ px + py * m_Width };
+			const Surface& surface{ surfaces[pixelIndex] };
+			if (!surface.hit.didHit)
+			{
+				reservoirs[pixelIndex] = Reservoir{};
+				continue;
+			}
+
+			//random pixels of a disk around this one, uniform by area, only the ones on the same surface
+			sampler.StartPixel(px, py, frameIndex);
+			int nrOfNeighbors{};
+			for (int idx{}; idx < m_NrOfNeighbors; ++idx)
+			{
+				const float radius{ m_NeighborRadius * sqrtf(sampler.Get1D(SampleDimension::GetResampling(firstStep + 1 + idx) + SampleDimension::LightU)) };
+				const float angle{ PI_2 * sampler.Get1D(SampleDimension::GetResampling(firstStep + 1 + idx) + SampleDimension::LightV) };
+				const int neighborX{ std::clamp(px + static_cast<int>(std::lround(radius * cosf(angle))), 0, m_Width - 1) };
+				const int neighborY{ std::clamp(py + static_cast<int>(std::lround(radius * sinf(angle))), 0, m_Height - 1) };
+				const int neighborIndex{ neighborX + neighborY * m_Width };
+				if (neighborIndex == pixelIndex || !IsSimilar(surface.hit.normal, surface.hit.t, surfaces[neighborIndex]))
+					continue;
+
+				neighbors[nrOfNeighbors] = &m_TemporalReservoirs[neighborIndex];
+				neighborSurfaces[nrOfNeighbors] = &surfaces[neighborIndex];
+				++nrOfNeighbors;
+			}
+
+			reservoirs[pixelIndex] = Merge(lights, materials, surface, m_TemporalReservoirs[pixelIndex], neighbors, neighborSurfaces, nrOfNeighbors, sampler, firstStep);
+		}
+	}
+}
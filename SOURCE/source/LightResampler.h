@@ -0,0 +1,147 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "Math.h"
+#include "DataTypes.h"
+#include "Sampler.h"
+#include "Utils.h"
+
+namespace dae
+{
+	class LightTree;
+	class ThreadPool;
+	struct Material;
+
+	/**
+	 * \brief Reservoir-based spatiotemporal importance resampling of the direct light at the camera rays' hits (Bitterli et al. 2020, "ReSTIR")
+	 * Every pixel streams a few candidate light samples through a weighted reservoir that keeps one of them, picked by how much unshadowed
+	 * light it brings (light * cosine * BRDF). The reservoir then takes in last frame's one of the same spot and those of a few neighbors on
+	 * the same surface, so the kept sample was picked out of hundreds and only it gets a shadow ray.
+	 * A shadowed sample stays in the history like any other, dropping it would only keep the lit ones and brighten the image
+	 */
+	class LightResampler final
+	{
+	public:
+		//a point on a light: the light, and for area lights the numbers its sampling maps to the point
+		struct LightPoint
+		{
+			int lightIndex{ -1 };
+			float u{};
+			float v{};
+		};
+
+		//one light sample out of all the candidates the reservoir saw
+		struct Reservoir
+		{
+			LightPoint sample{};
+			float targetPdf{}; //luminance of the sample's unshadowed light at the pixel, what it got picked by
+			float weightSum{};
+			float nrOfCandidates{};
+			float weight{}; //the sample's light times this estimates the pixel's direct light (the sum of weights over its target pdf), 0 = none
+
+			//offers a sample standing for nrOfNewCandidates candidates, random in [0, 1) decides whether it's kept; true when it is
+			bool Add(const LightPoint& point, float pointTargetPdf, float resamplingWeight, float nrOfNewCandidates, float random)
+			{
+				weightSum += resamplingWeight;
+				nrOfCandidates += nrOfNewCandidates;
+				if (resamplingWeight <= 0.f || random * weightSum >= resamplingWeight)
+					return false;
+
+				sample = point;
+				targetPdf = pointTargetPdf;
+				return true;
+			}
+		};
+
+		//what a pixel's camera ray hit
+		struct Surface
+		{
+			HitRecord hit{}; //didHit false where it missed
+			Vector3 view{}; //towards the camera
+		};
+
+		//where a camera is and how it maps directions to pixels, last frame's pixel of a point gets found with it
+		struct View
+		{
+			Vector3 origin{};
+			Vector3 right{};
+			Vector3 up{};
+			Vector3 forward{};
+			float fovScale{}; //tan(fov / 2)
+			float aspectRatio{};
+		};
+
+		//drops the history when the size changed
+		void Resize(int width, int height, int tileSize);
+
+		void SetSurface(int pixelIndex, const HitRecord& hit, const Vector3& view) { m_Surfaces[m_Current][pixelIndex] = Surface{ hit, view }; }
+		const Surface& GetSurface(int pixelIndex) const { return m_Surfaces[m_Current][pixelIndex]; }
+
+		/**
+		 * \brief Candidates and temporal reuse, then spatial reuse, for every pixel the surfaces of this frame hit; on the pool or the calling thread without one
+		 * \param pLightTree the candidates get picked from it (the caller shades the directional lights, they're not in it), nullptr = uniformly out of all lights
+		 * \param view this frame's camera, the history gets reprojected from last frame's
+		 * \param resetHistory the lights changed, last frame's samples may point at the wrong ones
+		 */
+		void Resample(ThreadPool* pThreadPool, const std::vector<Light>& lights, const std::vector<Material>& materials, const LightTree* pLightTree,
+			const View& view, SamplerType samplerType, uint32_t seed, uint32_t frameIndex, bool resetHistory);
+
+		//what the pixel shades this frame
+		const Reservoir& GetReservoir(int pixelIndex) const { return m_Reservoirs[m_Current][pixelIndex]; }
+
+		//this frame's surfaces and reservoirs become the history, call it once the reservoirs are shaded
+		void EndFrame();
+
+		//the unshadowed light of a point seen from a hit; false when it can't reach the hit's front
+		static bool SampleLight(const Light& light, const HitRecord& hit, const LightPoint& point, LightUtils::LightSample& sample);
+
+	private:
+		void SampleCandidatesTile(uint32_t tileIndex, const std::vector<Light>& lights, const std::vector<Material>& materials, const LightTree* pLightTree,
+			SamplerType samplerType, uint32_t seed, uint32_t frameIndex, bool useHistory);
+		void ReuseNeighborsTile(uint32_t tileIndex, const std::vector<Light>& lights, const std::vector<Material>& materials,
+			SamplerType samplerType, uint32_t seed, uint32_t frameIndex);
+
+		//luminance of the unshadowed light a point sends to a surface's viewer, 0 when it can't reach it
+		static float GetTargetPdf(const std::vector<Light>& lights, const std::vector<Material>& materials, const Surface& surface, const LightPoint& point);
+		//close enough in normal and depth that their light can be traded, depth of the point as seen from where other's camera was
+		static bool IsSimilar(const Vector3& normal, float depth, const Surface& other);
+		//last frame's pixel the point was in and its distance to last frame's camera, false when it was off screen
+		bool Reproject(const Vector3& point, int& pixelIndex, float& depth) const;
+		/**
+		 * \brief Merges reservoirs into the pixel's own one, every one weighed by its sample's target pdf at the pixel
+		 * The samples get multiple importance weights over the surfaces they came from (Bitterli's generalized balance heuristic), which keeps the
+		 * merge unbiased where the surfaces see different lights, at the cost of every sample's target pdf at every surface
+		 */
+		template<size_t maxInputs>
+		static Reservoir Merge(const std::vector<Light>& lights, const std::vector<Material>& materials, const Surface& surface, const Reservoir& own,
+			const std::array<const Reservoir*, maxInputs>& inputs, const std::array<const Surface*, maxInputs>& inputSurfaces, int nrOfInputs, Sampler& sampler, int firstStep);
+
+		//passes over every tile, parallel when there is a pool
+		template<typename Task>
+		void ForEachTile(ThreadPool* pThreadPool, const Task& task) const;
+
+		int m_Width{};
+		int m_Height{};
+		int m_TileSize{};
+		int m_NrOfTilesX{};
+		uint32_t m_NrOfTiles{};
+
+		static constexpr int m_NrOfCandidates{ 8 }; //light samples every pixel draws itself each frame
+		static constexpr float m_MaxHistoryCandidates{ 20.f * m_NrOfCandidates }; //last frame's reservoir counts for at most this many, so the history fades
+		static constexpr int m_NrOfNeighbors{ 4 };
+		static constexpr float m_NeighborRadius{ 3.f }; //pixels, lights close to the surfaces change too much over wider disks for their samples to be worth much
+		static constexpr float m_MinNormalCos{ .9f }; //about 25 degrees
+		static constexpr float m_MaxRelativeDepth{ .1f };
+
+		//this frame's and last frame's, m_Current picks
+		std::array<std::vector<Surface>, 2> m_Surfaces{};
+		std::array<std::vector<Reservoir>, 2> m_Reservoirs{};
+		std::vector<Reservoir> m_TemporalReservoirs{}; //candidates merged with the history, what the neighbors get reused from
+		int m_Current{};
+		View m_View{};
+		View m_PreviousView{};
+		bool m_HasHistory{};
+	};
+}
@@ -0,0 +1,473 @@
+#include "LightTree.h"
+
+//Standard includes
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+
+//Project includes
+#include "DataTypes.h"
+
+using namespace dae;
+
+namespace
+{
+	//buckets per axis the builder tries to split between
+	constexpr int NrOfBuckets{ 12 };
+	//largest float under 1, so a remapped random number never reaches 1
+	constexpr float OneMinusEpsilon{ 0x1.fffffep-1f };
+
+	float SafeSqrt(float value) { return sqrtf(std::max(value, 0.f)); }
+	float SafeAcos(float value) { return acosf(std::clamp(value, -1.f, 1.f)); }
+
+	//cos(max(0, a - b)) and sin(max(0, a - b)) of two angles in [0, PI] given by their sin and cos
+	float CosSubClamped(float sinA, float cosA, float sinB, float cosB)
+	{
+		if (cosA > cosB)
+			return 1.f;
+		return cosA * cosB + sinA * sinB;
+	}
+	float SinSubClamped(float sinA, float cosA, float sinB, float cosB)
+	{
+		if (cosA > cosB)
+			return 0.f;
+		return sinA * cosB - cosA * sinB;
+	}
+
+#if defined(MATH_AVX2)
+	__m256 SafeSqrt(__m256 value) { return _mm256_sqrt_ps(_mm256_max_ps(value, _mm256_setzero_ps())); }
+
+	__m256 CosSubClamped(__m256 sinA, __m256 cosA, __m256 sinB, __m256 cosB)
+	{
+		const __m256 cosSub{ _mm256_fmadd_ps(cosA, cosB, _mm256_mul_ps(sinA, sinB)) };
+		return _mm256_blendv_ps(cosSub, _mm256_set1_ps(1.f), _mm256_cmp_ps(cosA, cosB, _CMP_GT_OQ));
+	}
+	__m256 SinSubClamped(__m256 sinA, __m256 cosA, __m256 sinB, __m256 cosB)
+	{
+		const __m256 sinSub{ _mm256_fmsub_ps(sinA, cosB, _mm256_mul_ps(cosA, sinB)) };
+		return _mm256_blendv_ps(sinSub, _mm256_setzero_ps(), _mm256_cmp_ps(cosA, cosB, _CMP_GT_OQ));
+	}
+#endif
+}
+
+void LightTree::Build(const std::vector<Light>& lights)
+{
+	m_Nodes.clear();
+
+	std::vector<std::pair<uint32_t, Bounds>> treeLights{};
+	treeLights.reserve(lights.size());
+	for (uint32_t idx{}; idx < lights.size(); ++idx)
+	{
+		if (lights[idx].type != LightType::Directional)
+			treeLights.emplace_back(idx, GetBounds(lights[idx]));
+	}
+
+	m_NrOfLights = static_cast<uint32_t>(treeLights.size());
+	if (treeLights.empty())
+		return;
+
+	//a binary tree with a light per leaf, collapsed so every node has up to m_Width children
+	std::vector<BinaryNode> binaryNodes{};
+	binaryNodes.reserve(2 * treeLights.size() - 1);
+	BuildBinaryNode(binaryNodes, treeLights, 0, treeLights.size());
+	CollapseNode(binaryNodes, 0);
+}
+
+void LightTree::Sample(const Vector3& origin, const Vector3& normal, float u, int nrOfPicks, Pick* pPicks) const
+{
+	assert(nrOfPicks <= m_MaxPicks && "LightTree::Sample: too many picks");
+
+	std::array<float, m_MaxPicks> us{};
+	for (int pick{}; pick < nrOfPicks; ++pick)
+	{
+		pPicks[pick] = Pick{};
+		us[pick] = (pick + u) / nrOfPicks;
+	}
+	if (!m_Nodes.empty())
+	{
+		SampleNode(0, 1.f, origin, normal, us.data(), nrOfPicks, pPicks);
+	}
+}
+
+void LightTree::SampleNode(uint32_t nodeIndex, float nodeProbability, const Vector3& origin, const Vector3& normal, float* pU, int nrOfPicks, Pick* pPicks) const
+{
+	const Node& node{ m_Nodes[nodeIndex] };
+	Node::Lanes importances{};
+	GetImportances(node, origin, normal, importances);
+
+	float total{};
+	int lastLane{ -1 };
+	for (int lane{}; lane < m_Width; ++lane)
+	{
+		total += importances[lane];
+		if (importances[lane] > 0.f)
+			lastLane = lane;
+	}
+	if (lastLane < 0)
+		return;
+
+	//the numbers are sorted, so the picks that take a child are next to each other
+	//they get stretched back to [0, 1) for the next level, which keeps them sorted
+	float below{};
+	int pick{};
+	for (int lane{}; lane <= lastLane && pick < nrOfPicks; ++lane)
+	{
+		const float importance{ importances[lane] };
+		if (importance <= 0.f)
+			continue;
+
+		//the last child takes whatever rounding left over
+		const float above{ below + importance };
+		int end{ pick };
+		for (; end < nrOfPicks && (pU[end] * total < above || lane == lastLane); ++end)
+		{
+			pU[end] = std::clamp((pU[end] * total - below) / importance, 0.f, OneMinusEpsilon);
+		}
+		below = above;
+		if (end == pick)
+			continue;
+
+		const float probability{ nodeProbability * importance / total };
+		if (node.leafMask & (1u << lane))
+		{
+			std::fill(pPicks + pick, pPicks + end, Pick{ static_cast<int>(node.child[lane]), probability });
+		}
+		else
+		{
+			SampleNode(node.child[lane], probability, origin, normal, pU + pick, end - pick, pPicks + pick);
+		}
+		pick = end;
+	}
+}
+
+LightTree::Bounds LightTree::GetBounds(const Light& light)
+{
+	const float luminance{ .2126f * light.color.r + .7152f * light.color.g + .0722f * light.color.b };
+
+	Bounds bounds{};
+	switch (light.type)
+	{
+	case LightType::Rect:
+	{
+		//one-sided and lambertian: shines into the hemisphere around its normal, a PI / 4 of what a point light does
+		for (const float width : { -1.f, 1.f })
+		{
+			for (const float height : { -1.f, 1.f })
+			{
+				const Vector3 corner{ light.origin + light.halfWidth * width + light.halfHeight * height };
+				bounds.min = Vector3::Min(bounds.min, corner);
+				bounds.max = Vector3::Max(bounds.max, corner);
+			}
+		}
+		bounds.axis = light.direction;
+		bounds.cosOffset = 1.f;
+		bounds.cosEmission = 0.f;
+		bounds.power = PI * light.intensity * luminance;
+		break;
+	}
+	default:
+	{
+		//points and spheres shine every way
+		const Vector3 extent{ light.radius, light.radius, light.radius };
+		bounds.min = light.origin - extent;
+		bounds.max = light.origin + extent;
+		bounds.cosOffset = -1.f;
+		bounds.cosEmission = 0.f;
+		bounds.power = PI_4 * light.intensity * luminance;
+		break;
+	}
+	}
+	return bounds;
+}
+
+LightTree::Bounds LightTree::Union(const Bounds& a, const Bounds& b)
+{
+	if (a.power <= 0.f && a.min.x > a.max.x)
+		return b;
+	if (b.power <= 0.f && b.min.x > b.max.x)
+		return a;
+
+	Bounds bounds{};
+	bounds.min = Vector3::Min(a.min, b.min);
+	bounds.max = Vector3::Max(a.max, b.max);
+	bounds.power = a.power + b.power;
+	bounds.cosEmission = std::min(a.cosEmission, b.cosEmission);
+
+	//smallest cone around both cones
+	bounds.cosOffset = -1.f;
+	if (a.cosOffset <= -1.f || b.cosOffset <= -1.f)
+		return bounds;
+
+	const float angleA{ SafeAcos(a.cosOffset) };
+	const float angleB{ SafeAcos(b.cosOffset) };
+	const float angleBetween{ SafeAcos(Vector3::Dot(a.axis, b.axis)) };
+	if (std::min(angleBetween + angleB, PI) <= angleA)
+	{
+		bounds.axis = a.axis;
+		bounds.cosOffset = a.cosOffset;
+		return bounds;
+	}
+	if (std::min(angleBetween + angleA, PI) <= angleB)
+	{
+		bounds.axis = b.axis;
+		bounds.cosOffset = b.cosOffset;
+		return bounds;
+	}
+
+	const float angle{ (angleA + angleBetween + angleB) * .5f };
+	Vector3 rotationAxis{ Vector3::Cross(a.axis, b.axis) };
+	if (angle >= PI || rotationAxis.SqrMagnitude() < 1e-12f)
+		return bounds;
+
+	//a's axis turned towards b's, around an axis perpendicular to it
+	rotationAxis.Normalize();
+	const float rotation{ angle - angleA };
+	bounds.axis = (a.axis * cosf(rotation) + Vector3::Cross(rotationAxis, a.axis) * sinf(rotation)).Normalized();
+	bounds.cosOffset = cosf(angle);
+	return bounds;
+}
+
+float LightTree::GetImportance(const Node& node, int lane, const Vector3& origin, const Vector3& normal)
+{
+	//inside the bounds light could come from every direction, the distance can't get smaller than the bounds are big
+	const Vector3 toOrigin{ origin.x - node.centerX[lane], origin.y - node.centerY[lane], origin.z - node.centerZ[lane] };
+	const float sqrLength{ toOrigin.SqrMagnitude() };
+	if (sqrLength <= node.sqrRadius[lane])
+		return node.power[lane] / std::max(node.sqrRadius[lane], FLT_EPSILON);
+
+	//cone of directions the bounds cover seen from the origin, the square roots don't wait on each other
+	const float invLength{ 1.f / sqrtf(sqrLength) };
+	const float sinBounds{ node.radius[lane] * invLength };
+	const float cosBounds{ sqrtf(sqrLength - node.sqrRadius[lane]) * invLength };
+
+	//smallest angle between a normal of the cone and a direction to the origin, lights that shine every way always reach it
+	float cosEmitted{ 1.f };
+	if (node.cosOffset[lane] > -1.f)
+	{
+		const Vector3 axis{ node.axisX[lane], node.axisY[lane], node.axisZ[lane] };
+		const float cosAxis{ Vector3::Dot(axis, toOrigin) * invLength };
+		const float sinAxis{ SafeSqrt(1.f - cosAxis * cosAxis) };
+		const float cosToCone{ CosSubClamped(sinAxis, cosAxis, node.sinOffset[lane], node.cosOffset[lane]) };
+		const float sinToCone{ SinSubClamped(sinAxis, cosAxis, node.sinOffset[lane], node.cosOffset[lane]) };
+		cosEmitted = CosSubClamped(sinToCone, cosToCone, sinBounds, cosBounds);
+		if (cosEmitted <= node.cosEmission[lane])
+			return 0.f;
+	}
+
+	//smallest angle between the hit's normal and a direction to the bounds, both sides since it's only a bound
+	const float normalDistance{ std::abs(Vector3::Dot(toOrigin, normal)) };
+	const float cosIncident{ normalDistance * invLength };
+	const float sinIncident{ SafeSqrt(sqrLength - normalDistance * normalDistance) * invLength };
+	const float cosReceived{ CosSubClamped(sinIncident, cosIncident, sinBounds, cosBounds) };
+
+	return std::max(node.power[lane] * cosEmitted * cosReceived * invLength * invLength, 0.f);
+}
+
+void LightTree::GetImportances(const Node& node, const Vector3& origin, const Vector3& normal, Node::Lanes& importances)
+{
+#if defined(MATH_AVX2)
+	//GetImportance for all lanes, the branches become blends
+	const __m256 zero{ _mm256_setzero_ps() };
+	const __m256 one{ _mm256_set1_ps(1.f) };
+	const __m256 toOriginX{ _mm256_sub_ps(_mm256_set1_ps(origin.x), _mm256_loadu_ps(node.centerX.data())) };
+	const __m256 toOriginY{ _mm256_sub_ps(_mm256_set1_ps(origin.y), _mm256_loadu_ps(node.centerY.data())) };
+	const __m256 toOriginZ{ _mm256_sub_ps(_mm256_set1_ps(origin.z), _mm256_loadu_ps(node.centerZ.data())) };
+	const __m256 sqrLength{ _mm256_fmadd_ps(toOriginX, toOriginX, _mm256_fmadd_ps(toOriginY, toOriginY, _mm256_mul_ps(toOriginZ, toOriginZ))) };
+	const __m256 radius{ _mm256_loadu_ps(node.radius.data()) };
+	const __m256 sqrRadius{ _mm256_loadu_ps(node.sqrRadius.data()) };
+	const __m256 power{ _mm256_loadu_ps(node.power.data()) };
+	const __m256 isInside{ _mm256_cmp_ps(sqrLength, sqrRadius, _CMP_LE_OQ) };
+
+	const __m256 invLength{ _mm256_div_ps(one, _mm256_sqrt_ps(sqrLength)) };
+	const __m256 sinBounds{ _mm256_mul_ps(radius, invLength) };
+	const __m256 cosBounds{ _mm256_mul_ps(SafeSqrt(_mm256_sub_ps(sqrLength, sqrRadius)), invLength) };
+
+	__m256 cosEmitted{ one };
+	const __m256 cosOffset{ _mm256_loadu_ps(node.cosOffset.data()) };
+	const __m256 isCone{ _mm256_cmp_ps(cosOffset, _mm256_set1_ps(-1.f), _CMP_GT_OQ) };
+	__m256 isEmitting{ _mm256_castsi256_ps(_mm256_set1_epi32(-1)) };
+	if (!_mm256_testz_ps(isCone, isCone))
+	{
+		const __m256 sinOffset{ _mm256_loadu_ps(node.sinOffset.data()) };
+		const __m256 dotAxis{ _mm256_fmadd_ps(_mm256_loadu_ps(node.axisX.data()), toOriginX,
+			_mm256_fmadd_ps(_mm256_loadu_ps(node.axisY.data()), toOriginY, _mm256_mul_ps(_mm256_loadu_ps(node.axisZ.data()), toOriginZ))) };
+		const __m256 cosAxis{ _mm256_mul_ps(dotAxis, invLength) };
+		const __m256 sinAxis{ SafeSqrt(_mm256_fnmadd_ps(cosAxis, cosAxis, one)) };
+		const __m256 cosToCone{ CosSubClamped(sinAxis, cosAxis, sinOffset, cosOffset) };
+		const __m256 sinToCone{ SinSubClamped(sinAxis, cosAxis, sinOffset, cosOffset) };
+		cosEmitted = _mm256_blendv_ps(one, CosSubClamped(sinToCone, cosToCone, sinBounds, cosBounds), isCone);
+		isEmitting = _mm256_cmp_ps(cosEmitted, _mm256_loadu_ps(node.cosEmission.data()), _CMP_GT_OQ);
+	}
+
+	const __m256 dotNormal{ _mm256_fmadd_ps(toOriginX, _mm256_set1_ps(normal.x),
+		_mm256_fmadd_ps(toOriginY, _mm256_set1_ps(normal.y), _mm256_mul_ps(toOriginZ, _mm256_set1_ps(normal.z)))) };
+	const __m256 normalDistance{ _mm256_andnot_ps(_mm256_set1_ps(-0.f), dotNormal) };
+	const __m256 cosIncident{ _mm256_mul_ps(normalDistance, invLength) };
+	const __m256 sinIncident{ _mm256_mul_ps(SafeSqrt(_mm256_fnmadd_ps(normalDistance, normalDistance, sqrLength)), invLength) };
+	const __m256 cosReceived{ CosSubClamped(sinIncident, cosIncident, sinBounds, cosBounds) };
+
+	const __m256 outside{ _mm256_max_ps(_mm256_mul_ps(_mm256_mul_ps(power, _mm256_mul_ps(cosEmitted, cosReceived)), _mm256_mul_ps(invLength, invLength)), zero) };
+	const __m256 inside{ _mm256_div_ps(power, _mm256_max_ps(sqrRadius, _mm256_set1_ps(FLT_EPSILON))) };
+	const __m256 importance{ _mm256_blendv_ps(_mm256_and_ps(outside, isEmitting), inside, isInside) };
+	_mm256_storeu_ps(importances.data(), importance);
+#else
+	for (int lane{}; lane < m_Width; ++lane)
+	{
+		importances[lane] = GetImportance(node, lane, origin, normal);
+	}
+#endif
+}
+
+float LightTree::GetCost(const Bounds& bounds, const Vector3& extent)
+{
+	//solid angle the cone of normals and its emission cover (the orientation measure of the paper)
+	const float angleOffset{ SafeAcos(bounds.cosOffset) };
+	const float angleEmission{ SafeAcos(bounds.cosEmission) };
+	const float angleWeighted{ std::min(angleOffset + angleEmission, PI) };
+	const float sinOffset{ SafeSqrt(1.f - bounds.cosOffset * bounds.cosOffset) };
+	const float orientation{ PI_2 * (1.f - bounds.cosOffset) + PI_DIV_2 * (2.f * angleWeighted * sinOffset - cosf(angleOffset - 2.f * angleWeighted)
+		- 2.f * angleOffset * sinOffset + bounds.cosOffset) };
+
+	const Vector3 size{ Vector3::Max(bounds.max - bounds.min, Vector3{}) };
+	const float surfaceArea{ 2.f * (size.x * size.y + size.y * size.z + size.z * size.x) };
+	return bounds.power * orientation * surfaceArea * std::max({ extent.x, extent.y, extent.z });
+}
+
+uint32_t LightTree::BuildBinaryNode(std::vector<BinaryNode>& nodes, std::vector<std::pair<uint32_t, Bounds>>& lights, size_t begin, size_t end)
+{
+	const uint32_t nodeIndex{ static_cast<uint32_t>(nodes.size()) };
+	nodes.emplace_back();
+
+	if (end - begin == 1)
+	{
+		nodes[nodeIndex] = BinaryNode{ lights[begin].second, lights[begin].first, 1, true };
+		return nodeIndex;
+	}
+
+	Bounds bounds{};
+	Vector3 centerMin{ FLT_MAX, FLT_MAX, FLT_MAX }, centerMax{ -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	for (size_t idx{ begin }; idx < end; ++idx)
+	{
+		bounds = Union(bounds, lights[idx].second);
+		centerMin = Vector3::Min(centerMin, lights[idx].second.GetCenter());
+		centerMax = Vector3::Max(centerMax, lights[idx].second.GetCenter());
+	}
+
+	//cheapest split between buckets over all three axes, a long axis costs less to split along
+	const Vector3 extent{ bounds.max - bounds.min };
+	float bestCost{ FLT_MAX };
+	int bestAxis{ -1 }, bestBucket{};
+	const auto getBucket = [&](const Bounds& lightBounds, int axis)
+	{
+		const float offset{ (lightBounds.GetCenter()[axis] - centerMin[axis]) / (centerMax[axis] - centerMin[axis]) };
+		return std::min(static_cast<int>(offset * NrOfBuckets), NrOfBuckets - 1);
+	};
+
+	for (int axis{}; axis < 3; ++axis)
+	{
+		if (centerMax[axis] <= centerMin[axis])
+			continue;
+
+		std::array<Bounds, NrOfBuckets> buckets{};
+		for (size_t idx{ begin }; idx < end; ++idx)
+		{
+			Bounds& bucket{ buckets[getBucket(lights[idx].second, axis)] };
+			bucket = Union(bucket, lights[idx].second);
+		}
+
+		const float axisExtent{ std::max(extent[axis], 1e-6f) };
+		const Vector3 relativeExtent{ extent * (1.f / axisExtent) };
+		for (int split{}; split < NrOfBuckets - 1; ++split)
+		{
+			Bounds below{}, above{};
+			for (int bucket{}; bucket <= split; ++bucket)
+				below = Union(below, buckets[bucket]);
+			for (int bucket{ split + 1 }; bucket < NrOfBuckets; ++bucket)
+				above = Union(above, buckets[bucket]);
+
+			const float cost{ GetCost(below, relativeExtent) + GetCost(above, relativeExtent) };
+			if (cost < bestCost && below.min.x <= below.max.x && above.min.x <= above.max.x)
+			{
+				bestCost = cost;
+				bestAxis = axis;
+				bestBucket = split;
+			}
+		}
+	}
+
+	//all lights in the same spot (or no split helped), halves by count
+	size_t middle{ begin + (end - begin) / 2 };
+	if (bestAxis >= 0)
+	{
+		const auto first{ lights.begin() + begin };
+		middle = std::partition(first, lights.begin() + end, [&](const std::pair<uint32_t, Bounds>& light)
+		{
+			return getBucket(light.second, bestAxis) <= bestBucket;
+		}) - lights.begin();
+		if (middle == begin || middle == end)
+			middle = begin + (end - begin) / 2;
+	}
+
+	BuildBinaryNode(nodes, lights, begin, middle);
+	const uint32_t secondChild{ BuildBinaryNode(nodes, lights, middle, end) };
+	nodes[nodeIndex] = BinaryNode{ bounds, secondChild, static_cast<uint32_t>(end - begin), false };
+	return nodeIndex;
+}
+
+uint32_t LightTree::CollapseNode(const std::vector<BinaryNode>& binaryNodes, uint32_t binaryIndex)
+{
+	//opens the child with the most lights until there are m_Width of them, that keeps the nodes full, a single light stays one
+	std::vector<uint32_t> children{ binaryIndex };
+	while (children.size() < m_Width)
+	{
+		int toOpen{ -1 };
+		for (int idx{}; idx < static_cast<int>(children.size()); ++idx)
+		{
+			const BinaryNode& child{ binaryNodes[children[idx]] };
+			if (!child.isLeaf && (toOpen < 0 || child.nrOfLights > binaryNodes[children[toOpen]].nrOfLights))
+				toOpen = idx;
+		}
+		if (toOpen < 0)
+			break;
+
+		const uint32_t opened{ children[toOpen] };
+		children[toOpen] = opened + 1;
+		children.push_back(binaryNodes[opened].index);
+	}
+
+	const uint32_t nodeIndex{ static_cast<uint32_t>(m_Nodes.size()) };
+	m_Nodes.emplace_back();
+	Node node{};
+	node.cosOffset.fill(-1.f);
+	for (int lane{}; lane < static_cast<int>(children.size()); ++lane)
+	{
+		const BinaryNode& child{ binaryNodes[children[lane]] };
+		const Bounds& bounds{ child.bounds };
+		const Vector3 center{ bounds.GetCenter() };
+		node.centerX[lane] = center.x;
+		node.centerY[lane] = center.y;
+		node.centerZ[lane] = center.z;
+		node.sqrRadius[lane] = (bounds.max - bounds.min).SqrMagnitude() * .25f;
+		node.radius[lane] = sqrtf(node.sqrRadius[lane]);
+		node.axisX[lane] = bounds.axis.x;
+		node.axisY[lane] = bounds.axis.y;
+		node.axisZ[lane] = bounds.axis.z;
+		node.cosOffset[lane] = bounds.cosOffset;
+		node.sinOffset[lane] = SafeSqrt(1.f - bounds.cosOffset * bounds.cosOffset);
+		node.cosEmission[lane] = bounds.cosEmission;
+		node.power[lane] = bounds.power;
+		if (child.isLeaf)
+		{
+			node.child[lane] = child.index;
+			node.leafMask |= 1u << lane;
+		}
+		else
+		{
+			//the vector grows while the child gets collapsed, the node gets stored when it's done
+			node.child[lane] = CollapseNode(binaryNodes, children[lane]);
+		}
+	}
+	m_Nodes[nodeIndex] = node;
+	return nodeIndex;
+}
@@ -0,0 +1,104 @@
+#pragma once
+#include <array>
+#include <cfloat>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "Math.h"
+
+namespace dae
+{
+	struct Light;
+
+	/**
+	 * \brief Bounding volume hierarchy over the point and area lights of a scene (Estevez & Kulla 2018, "Importance Sampling of Many Lights")
+	 * Every node bounds where its lights are, the directions they shine in (a cone) and their power. A hit picks a light by walking down
+	 * the tree, taking every child with the probability of how much light it could send to the hit, so the cost grows with the depth only
+	 * The nodes have 8 children so a hit weighs all of them at once and 10k lights are 5 levels deep
+	 * Directional lights reach every hit the same way, they stay out of the tree
+	 */
+	class LightTree final
+	{
+	public:
+		//rebuilds the whole tree, only worth it when the lights changed
+		void Build(const std::vector<Light>& lights);
+
+		//point and area lights in the tree
+		uint32_t GetNrOfLights() const { return m_NrOfLights; }
+
+		struct Pick
+		{
+			int lightIndex{ -1 }; //into the lights the tree was built from, -1 when nothing in the tree can light the hit
+			float probability{}; //of the pick, the light's contribution gets divided by it so the average stays the same
+		};
+		static constexpr int m_MaxPicks{ 16 };
+
+		/**
+		 * \brief Picks lights for a hit, lights that could light it more get picked more often
+		 * \param u random number in [0, 1), pick i walks down with (i + u) / nrOfPicks so the picks are stratified
+		 * \param nrOfPicks at most m_MaxPicks, the picks walk down together and only split where they take different children
+		 */
+		void Sample(const Vector3& origin, const Vector3& normal, float u, int nrOfPicks, Pick* pPicks) const;
+
+	private:
+		//children per node, one AVX2 register wide
+		static constexpr int m_Width{ 8 };
+
+		struct Bounds
+		{
+			Vector3 min{ FLT_MAX, FLT_MAX, FLT_MAX };
+			Vector3 max{ -FLT_MAX, -FLT_MAX, -FLT_MAX };
+			Vector3 axis{ 0.f, 0.f, 1.f }; //of the cone around the normals of the lights
+			float cosOffset{ 1.f }; //cos of the cone's half angle, -1 = lights shining every way
+			float cosEmission{ -1.f }; //cos of how far past its normal a light still shines, 0 = a hemisphere
+			float power{};
+
+			Vector3 GetCenter() const { return (min + max) * .5f; }
+		};
+
+		//the builder splits in two, its tree gets collapsed into the wide one afterwards
+		struct BinaryNode
+		{
+			Bounds bounds{};
+			uint32_t index{}; //leaf: of the light, otherwise of the second child, the first one comes right after the node
+			uint32_t nrOfLights{};
+			bool isLeaf{};
+		};
+
+		//the bounds of up to m_Width children, a lane each, as the traversal needs them: a sphere instead of the box and the cone's sin precomputed
+		//lanes without a child have no power, they never get picked
+		struct Node
+		{
+			using Lanes = std::array<float, m_Width>;
+			Lanes centerX{}, centerY{}, centerZ{};
+			Lanes radius{}, sqrRadius{};
+			Lanes axisX{}, axisY{}, axisZ{};
+			Lanes cosOffset{}, sinOffset{}, cosEmission{};
+			Lanes power{};
+			std::array<uint32_t, m_Width> child{}; //of the light when the lane's bit in leafMask is set, otherwise of the node
+			uint32_t leafMask{};
+		};
+
+		static Bounds GetBounds(const Light& light);
+		static Bounds Union(const Bounds& a, const Bounds& b);
+		//how much light a lane's bounds could send to a point with this normal, 0 = none at all
+		static float GetImportance(const Node& node, int lane, const Vector3& origin, const Vector3& normal);
+		//of all the lanes at once
+		static void GetImportances(const Node& node, const Vector3& origin, const Vector3& normal, Node::Lanes& importances);
+		//surface area orientation heuristic of a child, what the builder minimizes
+		//extent is the parent's size relative to the split axis, splits across a long box cost less
+		static float GetCost(const Bounds& bounds, const Vector3& extent);
+
+		//walks the picks down from a node, their random numbers sorted and stretched to [0, 1) for that node
+		void SampleNode(uint32_t nodeIndex, float nodeProbability, const Vector3& origin, const Vector3& normal, float* pU, int nrOfPicks, Pick* pPicks) const;
+
+		//builds the lights [begin, end) of the list, returns the node's index
+		static uint32_t BuildBinaryNode(std::vector<BinaryNode>& nodes, std::vector<std::pair<uint32_t, Bounds>>& lights, size_t begin, size_t end);
+		//the binary node's subtree as a wide node, its children are the binary nodes at most a few levels down
+		uint32_t CollapseNode(const std::vector<BinaryNode>& binaryNodes, uint32_t binaryIndex);
+
+		std::vector<Node> m_Nodes{};
+		uint32_t m_NrOfLights{};
+	};
+}
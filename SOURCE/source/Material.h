@@ -1,141 +1,382 @@
 #pragma once
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
 #include "Math.h"
 #include "DataTypes.h"
 #include "BRDFs.h"
 
 namespace dae
 {
-#pragma region Material BASE
-	class Material
+#pragma region Material TABLE
+	enum class MaterialType : uint8_t
 	{
-	public:
-		Material() = default;
-		virtual ~Material() = default;
-
-		Material(const Material&) = delete;
-		Material(Material&&) noexcept = delete;
-		Material& operator=(const Material&) = delete;
-		Material& operator=(Material&&) noexcept = delete;
-
-		/**
-		 * \brief Function used to calculate the correct color for the specific material and its parameters
-		 * \param hitRecord current hitrecord
-		 * \param l light direction
-		 * \param v view direction
-		 * \return color
-		 */
-		virtual ColorRGB Shade(const HitRecord& hitRecord = {}, const Vector3& l = {}, const Vector3& v = {}) = 0;
+		SolidColor,
+		Lambert,
+		LambertPhong,
+		CookTorrence
 	};
-#pragma endregion
+	constexpr size_t NrOfMaterialTypes{ 4 };
 
-#pragma region Material SOLID COLOR
-	//SOLID COLOR
-	//===========
-	class Material_SolidColor final : public Material
+	/**
+	 * \brief Plain parameter block, the scene keeps these contiguously and the type tag picks the shading kernel.
+	 * Everything that only depends on the material (diffuse term, f0, squared roughness) is computed once at creation.
+	 */
+	struct Material
 	{
-	public:
-		Material_SolidColor(const ColorRGB& color): m_Color(color)
+		MaterialType type{ MaterialType::SolidColor };
+
+		ColorRGB color{ colors::White }; //solid color, diffuse color or albedo
+		ColorRGB diffuse{}; //precomputed Lambert term (kd * cd / PI), cook torrence scales it by 1 - fresnel
+		ColorRGB f0{}; //base reflectivity
+		float specularReflectance{}; //ks
+		float phongExponent{ 1.f };
+		float roughnessSquared{};
+		float ggxAlpha{}; //squared roughnessSquared, as NormalDistribution_GGX squares its input
+		float smithK{}; //squared(roughnessSquared + 1) / 8, as GeometryFunction_SchlickGGX uses it
+		float mirror{}; //how much of the fresnel reflection is a sharp mirror image, fades out with roughness
+
+		//SOLID COLOR
+		static Material CreateSolidColor(const ColorRGB& color)
 		{
+			Material material{};
+			material.type = MaterialType::SolidColor;
+			material.color = color;
+			return material;
 		}
 
-		ColorRGB Shade(const HitRecord& hitRecord, const Vector3& l, const Vector3& v) override
+		//LAMBERT
+		static Material CreateLambert(const ColorRGB& diffuseColor, float diffuseReflectance)
 		{
-			return m_Color;
+			Material material{};
+			material.type = MaterialType::Lambert;
+			material.color = diffuseColor;
+			material.diffuse = BRDF::Lambert(diffuseReflectance, diffuseColor);
+			return material;
 		}
 
-	private:
-		ColorRGB m_Color{colors::White};
+		//LAMBERT-PHONG
+		static Material CreateLambertPhong(const ColorRGB& diffuseColor, float kd, float ks, float phongExponent)
+		{
+			Material material{};
+			material.type = MaterialType::LambertPhong;
+			material.color = diffuseColor;
+			material.diffuse = BRDF::Lambert(kd, diffuseColor);
+			material.specularReflectance = ks;
+			material.phongExponent = phongExponent;
+			return material;
+		}
+
+		//COOK TORRENCE
+		// roughness [1.0 > 0.0] >> [ROUGH > SMOOTH]
+		static Material CreateCookTorrence(const ColorRGB& albedo, float metalness, float roughness)
+		{
+			Material material{};
+			material.type = MaterialType::CookTorrence;
+			material.color = albedo;
+			material.roughnessSquared = roughness * roughness;
+			material.ggxAlpha = Square(material.roughnessSquared);
+			material.smithK = Square(material.roughnessSquared + 1.f) / 8.f;
+			material.mirror = Square(1.f - roughness);
+
+			//base reflectivity of the surface, only dielectrics have a diffuse part
+			if (metalness == 0.f)
+			{
+				material.f0 = ColorRGB{ 0.04f, 0.04f, 0.04f };
+				material.diffuse = BRDF::Lambert(1.f, albedo);
+			}
+			else { material.f0 = albedo; }
+
+			return material;
+		}
 	};
 #pragma endregion
 
-#pragma region Material LAMBERT
-	//LAMBERT
-	//=======
-	class Material_Lambert final : public Material
+#pragma region Material SHADING
+	/**
+	 * \brief Light samples of one material type waiting to be shaded, stored SoA so 8 of them load into one register per component
+	 */
+	struct ShadingStream
 	{
-	public:
-		Material_Lambert(const ColorRGB& diffuseColor, float diffuseReflectance) :
-			m_DiffuseColor(diffuseColor), m_DiffuseReflectance(diffuseReflectance){}
+		std::vector<float> normalX{}, normalY{}, normalZ{};
+		std::vector<float> lightX{}, lightY{}, lightZ{};
+		std::vector<float> viewX{}, viewY{}, viewZ{};
+		std::vector<float> weightR{}, weightG{}, weightB{}; //what the BRDF gets multiplied with before it's added to the pixel
+		std::vector<uint32_t> pixelIndices{};
+		std::vector<int> materialIndices{};
+		size_t size{};
 
-		ColorRGB Shade(const HitRecord& hitRecord = {}, const Vector3& l = {}, const Vector3& v = {}) override
+		//empties the stream and makes room for capacity samples, so Push never has to grow the storage
+		void Clear(size_t capacity)
 		{
-			return BRDF::Lambert(m_DiffuseReflectance, m_DiffuseColor);
+			size = 0;
+			if (pixelIndices.size() >= capacity)
+			{
+				return;
+			}
+
+			for (auto* pComponent : { &normalX, &normalY, &normalZ, &lightX, &lightY, &lightZ, &viewX, &viewY, &viewZ, &weightR, &weightG, &weightB })
+			{
+				pComponent->resize(capacity);
+			}
+			pixelIndices.resize(capacity);
+			materialIndices.resize(capacity);
 		}
 
-	private:
-		ColorRGB m_DiffuseColor{colors::White};
-		float m_DiffuseReflectance{1.f}; //kd
+		void Push(const Vector3& n, const Vector3& l, const Vector3& v, const ColorRGB& weight, uint32_t pixelIndex, unsigned char materialIndex)
+		{
+			assert(size < pixelIndices.size());
+
+			normalX[size] = n.x; normalY[size] = n.y; normalZ[size] = n.z;
+			lightX[size] = l.x; lightY[size] = l.y; lightZ[size] = l.z;
+			viewX[size] = v.x; viewY[size] = v.y; viewZ[size] = v.z;
+			weightR[size] = weight.r; weightG[size] = weight.g; weightB[size] = weight.b;
+			pixelIndices[size] = pixelIndex;
+			materialIndices[size] = materialIndex;
+			++size;
+		}
 	};
-#pragma endregion
 
-#pragma region Material LAMBERT PHONG
-	//LAMBERT-PHONG
-	//=============
-	class Material_LambertPhong final : public Material
+	namespace MaterialShading
 	{
-	public:
-		Material_LambertPhong(const ColorRGB& diffuseColor, float kd, float ks, float phongExponent):
-			m_DiffuseColor(diffuseColor), m_DiffuseReflectance(kd), m_SpecularReflectance(ks),
-			m_PhongExponent(phongExponent)
+		/**
+		 * \brief Non-virtual shading kernel, one instantiation per material type
+		 * \param material parameters of the hit material
+		 * \param n surface normal
+		 * \param l light direction
+		 * \param v view direction
+		 * \return color
+		 */
+		template<MaterialType type>
+		inline ColorRGB Shade(const Material& material, const Vector3& n, const Vector3& l, const Vector3& v)
 		{
+			if constexpr (type == MaterialType::SolidColor)
+			{
+				return material.color;
+			}
+			else if constexpr (type == MaterialType::Lambert)
+			{
+				return material.diffuse;
+			}
+			else if constexpr (type == MaterialType::LambertPhong)
+			{
+				const ColorRGB spReflection{ BRDF::Phong(material.specularReflectance, material.phongExponent, l, -v, n) };
+				return material.diffuse + spReflection;
+			}
+			else
+			{
+				//variables
+				const Vector3 halfVector{ (v + l).Normalized() };
+
+				//specular variables
+				const ColorRGB f{ BRDF::FresnelFunction_Schlick(halfVector, v, material.f0) };
+				const float d{ BRDF::NormalDistribution_GGX(n, halfVector, material.roughnessSquared) };
+				const float g{ BRDF::GeometryFunction_Smith(n, v, l, material.roughnessSquared) };
+
+				//calculate specular
+				ColorRGB DFG{ d * f * g };
+				float denominator{ 4 * (Vector3::Dot(v, n) * Vector3::Dot(l, n)) };
+				ColorRGB specular{ DFG / denominator };
+
+				//the energy fresnel leaves over goes to the Lambert part (black for metals)
+				specular += (ColorRGB(1.f, 1.f, 1.f) - f) * material.diffuse;
+
+				return specular;
+			}
 		}
 
-		ColorRGB Shade(const HitRecord& hitRecord = {}, const Vector3& l = {}, const Vector3& v = {}) override
+		//single sample, dispatches on the type tag
+		inline ColorRGB Shade(const Material& material, const Vector3& n, const Vector3& l, const Vector3& v)
 		{
-			const ColorRGB spReflection{ BRDF::Phong(m_SpecularReflectance, m_PhongExponent, l, -v, hitRecord.normal) };
-			return BRDF::Lambert(m_DiffuseReflectance, m_DiffuseColor) + spReflection;
+			switch (material.type)
+			{
+			case MaterialType::SolidColor:
+				return Shade<MaterialType::SolidColor>(material, n, l, v);
+			case MaterialType::Lambert:
+				return Shade<MaterialType::Lambert>(material, n, l, v);
+			case MaterialType::LambertPhong:
+				return Shade<MaterialType::LambertPhong>(material, n, l, v);
+			default:
+				return Shade<MaterialType::CookTorrence>(material, n, l, v);
+			}
 		}
 
-	private:
-		ColorRGB m_DiffuseColor{colors::White};
-		float m_DiffuseReflectance{0.5f}; //kd
-		float m_SpecularReflectance{0.5f}; //ks
-		float m_PhongExponent{1.f}; //Phong Exponent
-	};
-#pragma endregion
+#if defined(MATH_AVX2)
+		/**
+		 * \brief Shades samples [idx, idx + 8) of a stream in one AVX2 instruction stream
+		 * Material parameters are gathered per lane, the results get added to the pixels one by one
+		 * since several samples can belong to the same pixel
+		 */
+		template<MaterialType type>
+		inline void ShadeLanes(const std::vector<Material>& materials, const ShadingStream& stream, size_t idx, ColorRGB* pColors)
+		{
+			static_assert(type == MaterialType::LambertPhong || type == MaterialType::CookTorrence);
+			static_assert(sizeof(Material) % sizeof(float) == 0);
+
+			const __m256i materialOffsets{ _mm256_mullo_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(&stream.materialIndices[idx])),
+				_mm256_set1_epi32(sizeof(Material) / sizeof(float))) };
+			const auto gatherMaterial{ [&](size_t offset)
+			{
+				return _mm256_i32gather_ps(reinterpret_cast<const float*>(reinterpret_cast<const char*>(materials.data()) + offset), materialOffsets, sizeof(float));
+			} };
+
+			const __m256 n_x{ _mm256_loadu_ps(&stream.normalX[idx]) }, n_y{ _mm256_loadu_ps(&stream.normalY[idx]) }, n_z{ _mm256_loadu_ps(&stream.normalZ[idx]) };
+			const __m256 l_x{ _mm256_loadu_ps(&stream.lightX[idx]) }, l_y{ _mm256_loadu_ps(&stream.lightY[idx]) }, l_z{ _mm256_loadu_ps(&stream.lightZ[idx]) };
+			const __m256 v_x{ _mm256_loadu_ps(&stream.viewX[idx]) }, v_y{ _mm256_loadu_ps(&stream.viewY[idx]) }, v_z{ _mm256_loadu_ps(&stream.viewZ[idx]) };
+
+			__m256 r{}, g{}, b{};
+			if constexpr (type == MaterialType::LambertPhong)
+			{
+				//the scalar kernel mirrors the view direction for phong
+				const __m256 signMask{ _mm256_set1_ps(-0.f) };
+				const __m256 specular{ BRDF8::Phong(gatherMaterial(offsetof(Material, specularReflectance)), gatherMaterial(offsetof(Material, phongExponent)),
+					l_x, l_y, l_z, _mm256_xor_ps(v_x, signMask), _mm256_xor_ps(v_y, signMask), _mm256_xor_ps(v_z, signMask), n_x, n_y, n_z) };
+
+				r = _mm256_add_ps(gatherMaterial(offsetof(Material, diffuse.r)), specular);
+				g = _mm256_add_ps(gatherMaterial(offsetof(Material, diffuse.g)), specular);
+				b = _mm256_add_ps(gatherMaterial(offsetof(Material, diffuse.b)), specular);
+			}
+			else
+			{
+				const __m256 one{ _mm256_set1_ps(1.f) };
+
+				//normalized half vector
+				__m256 h_x{ _mm256_add_ps(v_x, l_x) }, h_y{ _mm256_add_ps(v_y, l_y) }, h_z{ _mm256_add_ps(v_z, l_z) };
+				const __m256 length{ _mm256_sqrt_ps(BRDF8::Dot(h_x, h_y, h_z, h_x, h_y, h_z)) };
+				h_x = _mm256_div_ps(h_x, length);
+				h_y = _mm256_div_ps(h_y, length);
+				h_z = _mm256_div_ps(h_z, length);
+
+				//specular variables
+				const __m256 schlick{ _mm256_sub_ps(one, BRDF8::Dot(h_x, h_y, h_z, v_x, v_y, v_z)) };
+				const __m256 schlick2{ _mm256_mul_ps(schlick, schlick) };
+				const __m256 schlick5{ _mm256_mul_ps(_mm256_mul_ps(schlick2, schlick2), schlick) };
+				const __m256 fR{ BRDF8::FresnelFunction_Schlick(schlick5, gatherMaterial(offsetof(Material, f0.r))) };
+				const __m256 fG{ BRDF8::FresnelFunction_Schlick(schlick5, gatherMaterial(offsetof(Material, f0.g))) };
+				const __m256 fB{ BRDF8::FresnelFunction_Schlick(schlick5, gatherMaterial(offsetof(Material, f0.b))) };
+
+				const __m256 dotNV{ BRDF8::Dot(n_x, n_y, n_z, v_x, v_y, v_z) };
+				const __m256 dotNL{ BRDF8::Dot(n_x, n_y, n_z, l_x, l_y, l_z) };
+				const __m256 d{ BRDF8::NormalDistribution_GGX(BRDF8::Dot(n_x, n_y, n_z, h_x, h_y, h_z), gatherMaterial(offsetof(Material, ggxAlpha))) };
+				const __m256 geometry{ BRDF8::GeometryFunction_Smith(dotNV, dotNL, gatherMaterial(offsetof(Material, smithK))) };
 
-#pragma region Material COOK TORRENCE
-	//COOK TORRENCE
-	class Material_CookTorrence final : public Material
+				//specular = DFG / 4(v.n)(l.n), the Lambert part gets the energy fresnel leaves over
+				const __m256 dg{ _mm256_div_ps(_mm256_mul_ps(d, geometry), _mm256_mul_ps(_mm256_set1_ps(4.f), _mm256_mul_ps(dotNV, dotNL))) };
+				r = _mm256_fmadd_ps(fR, dg, _mm256_mul_ps(_mm256_sub_ps(one, fR), gatherMaterial(offsetof(Material, diffuse.r))));
+				g = _mm256_fmadd_ps(fG, dg, _mm256_mul_ps(_mm256_sub_ps(one, fG), gatherMaterial(offsetof(Material, diffuse.g))));
+				b = _mm256_fmadd_ps(fB, dg, _mm256_mul_ps(_mm256_sub_ps(one, fB), gatherMaterial(offsetof(Material, diffuse.b))));
+			}
+
+			//weighted results > pixels
+			alignas(32) float resultR[8], resultG[8], resultB[8];
+			_mm256_store_ps(resultR, _mm256_mul_ps(r, _mm256_loadu_ps(&stream.weightR[idx])));
+			_mm256_store_ps(resultG, _mm256_mul_ps(g, _mm256_loadu_ps(&stream.weightG[idx])));
+			_mm256_store_ps(resultB, _mm256_mul_ps(b, _mm256_loadu_ps(&stream.weightB[idx])));
+			for (int lane{}; lane < 8; ++lane)
+			{
+				pColors[stream.pixelIndices[idx + lane]] += ColorRGB{ resultR[lane], resultG[lane], resultB[lane] };
+			}
+		}
+#endif
+
+		/**
+		 * \brief Shades every sample of a stream through the kernel of its material type
+		 * \param materials material table of the scene
+		 * \param stream samples that all use a material of this type
+		 * \param pColors colors indexed by the pixel indices of the stream, the results are added to these
+		 */
+		template<MaterialType type>
+		inline void ShadeStream(const std::vector<Material>& materials, const ShadingStream& stream, ColorRGB* pColors)
+		{
+			size_t idx{};
+			const size_t size{ stream.size };
+
+#if defined(MATH_AVX2)
+			//solid color and lambert are a constant per material, only the specular models are worth going wide for
+			if constexpr (type == MaterialType::LambertPhong || type == MaterialType::CookTorrence)
+			{
+				for (; idx + 8 <= size; idx += 8)
+				{
+					ShadeLanes<type>(materials, stream, idx, pColors);
+				}
+			}
+#endif
+			//remainder (or everything without AVX2)
+			for (; idx < size; ++idx)
+			{
+				const Vector3 n{ stream.normalX[idx], stream.normalY[idx], stream.normalZ[idx] };
+				const Vector3 l{ stream.lightX[idx], stream.lightY[idx], stream.lightZ[idx] };
+				const Vector3 v{ stream.viewX[idx], stream.viewY[idx], stream.viewZ[idx] };
+				const ColorRGB weight{ stream.weightR[idx], stream.weightG[idx], stream.weightB[idx] };
+
+				pColors[stream.pixelIndices[idx]] += weight * Shade<type>(materials[stream.materialIndices[idx]], n, l, v);
+			}
+		}
+	}
+
+	/**
+	 * \brief Collects light samples per material type, so every type gets shaded in one batch through its own kernel
+	 */
+	class ShadingQueue final
 	{
 	public:
-		Material_CookTorrence(const ColorRGB& albedo, float metalness, float roughness):
-			m_Albedo(albedo), m_Metalness(metalness), m_Roughness(roughness)
+		//capacity is the most samples a stream holds before Push shades them, so any number of lights fits in a bounded queue
+		void Clear(size_t capacity)
+		{
+			for (ShadingStream& stream : m_Streams)
+			{
+				stream.Clear(capacity);
+			}
+		}
+
+		//a full stream gets shaded into pColors first, the samples only add up so when they get shaded doesn't matter
+		void Push(const std::vector<Material>& materials, unsigned char materialIndex, const Vector3& n, const Vector3& l, const Vector3& v, const ColorRGB& weight, uint32_t pixelIndex,
+			ColorRGB* pColors)
 		{
+			const MaterialType type{ materials[materialIndex].type };
+			ShadingStream& stream{ m_Streams[static_cast<size_t>(type)] };
+			if (stream.size == stream.pixelIndices.size())
+			{
+				ShadeStream(materials, type, pColors);
+				stream.size = 0;
+			}
+			stream.Push(n, l, v, weight, pixelIndex, materialIndex);
 		}
 
-		ColorRGB Shade(const HitRecord& hitRecord = {}, const Vector3& l = {}, const Vector3& v = {}) override
+		//adds the shaded samples to pColors, indexed by the pixel index they were pushed with
+		void Shade(const std::vector<Material>& materials, ColorRGB* pColors) const
 		{
-			//variables
-			const float roughnessSquared{ m_Roughness * m_Roughness };
-			const Vector3 halfVector{ (v + l).Normalized() };
-			ColorRGB f0{};
-			
-			//base reflectivity of the surface
-			if (m_Metalness == 0.f) { f0 = ColorRGB{ 0.04f, 0.04f, 0.04f }; }
-			else { f0 = m_Albedo; }
-			
-			//specular variables
-			const ColorRGB f{ BRDF::FresnelFunction_Schlick(halfVector, v, f0) };
-			const float d{ BRDF::NormalDistribution_GGX(hitRecord.normal, halfVector, roughnessSquared) };
-			const float g{ BRDF::GeometryFunction_Smith(hitRecord.normal, v, l, roughnessSquared) };
-			
-			//calculate specular
-			ColorRGB DFG{ d * f * g };
-			float denominator{ 4 * (Vector3::Dot(v, hitRecord.normal) * Vector3::Dot(l, hitRecord.normal)) };
-			ColorRGB specular{ DFG / denominator };
-
-			if (m_Metalness <= 0.f)
-				specular += BRDF::Lambert(ColorRGB(1.f, 1.f, 1.f) - f, m_Albedo);
-
-			//return
-			return specular;
+			ShadeStream(materials, MaterialType::SolidColor, pColors);
+			ShadeStream(materials, MaterialType::Lambert, pColors);
+			ShadeStream(materials, MaterialType::LambertPhong, pColors);
+			ShadeStream(materials, MaterialType::CookTorrence, pColors);
 		}
 
 	private:
-		ColorRGB m_Albedo{0.955f, 0.637f, 0.538f}; //Copper
-		float m_Metalness{1.0f};
-		float m_Roughness{0.1f}; // [1.0 > 0.0] >> [ROUGH > SMOOTH]
+		std::array<ShadingStream, NrOfMaterialTypes> m_Streams{};
+
+		void ShadeStream(const std::vector<Material>& materials, MaterialType type, ColorRGB* pColors) const
+		{
+			const ShadingStream& stream{ m_Streams[static_cast<size_t>(type)] };
+			switch (type)
+			{
+			case MaterialType::SolidColor:
+				MaterialShading::ShadeStream<MaterialType::SolidColor>(materials, stream, pColors);
+				break;
+			case MaterialType::Lambert:
+				MaterialShading::ShadeStream<MaterialType::Lambert>(materials, stream, pColors);
+				break;
+			case MaterialType::LambertPhong:
+				MaterialShading::ShadeStream<MaterialType::LambertPhong>(materials, stream, pColors);
+				break;
+			case MaterialType::CookTorrence:
+				MaterialShading::ShadeStream<MaterialType::CookTorrence>(materials, stream, pColors);
+				break;
+			}
+		}
 	};
 #pragma endregion
 }
@@ -1,53 +1,313 @@
 #pragma once
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+
 #include "Vector3.h"
 #include "Vector4.h"
 
+//The batch transforms use AVX2 + FMA when the build enables them (/arch:AVX2 or -mavx2 -mfma)
+#if !defined(MATH_SCALAR) && defined(__AVX2__) && (defined(_MSC_VER) || defined(__FMA__))
+#define MATH_AVX2
+#include <immintrin.h>
+#endif
+
 namespace dae {
 	struct Matrix
 	{
-		Matrix() = default;
-		Matrix(
+		constexpr Matrix() = default;
+		constexpr Matrix(
 			const Vector3& xAxis,
 			const Vector3& yAxis,
 			const Vector3& zAxis,
-			const Vector3& t);
+			const Vector3& t) :
+			Matrix({ xAxis, 0 }, { yAxis, 0 }, { zAxis, 0 }, { t, 1 })
+		{
+		}
 
-		Matrix(
+		constexpr Matrix(
 			const Vector4& xAxis,
 			const Vector4& yAxis,
 			const Vector4& zAxis,
-			const Vector4& t);
-
-		Matrix(const Matrix& m);
-
-		Vector3 TransformVector(const Vector3& v) const;
-		Vector3 TransformVector(float x, float y, float z) const;
-		Vector3 TransformPoint(const Vector3& p) const;
-		Vector3 TransformPoint(float x, float y, float z) const;
-		const Matrix& Transpose();
-
-		Vector3 GetAxisX() const;
-		Vector3 GetAxisY() const;
-		Vector3 GetAxisZ() const;
-		Vector3 GetTranslation() const;
-
-		static Matrix CreateTranslation(float x, float y, float z);
-		static Matrix CreateTranslation(const Vector3& t);
-		static Matrix CreateRotationX(float pitch);
-		static Matrix CreateRotationY(float yaw);
-		static Matrix CreateRotationZ(float roll);
-		static Matrix CreateRotation(float pitch, float yaw, float roll);
-		static Matrix CreateRotation(const Vector3& r);
-		static Matrix CreateScale(float sx, float sy, float sz);
-		static Matrix CreateScale(const Vector3& s);
-		static Matrix Transpose(const Matrix& m);
-
-		Vector4& operator[](int index);
-		Vector4 operator[](int index) const;
-		Matrix operator*(const Matrix& m) const;
-		const Matrix& operator*=(const Matrix& m);
+			const Vector4& t) :
+			data{ xAxis, yAxis, zAxis, t }
+		{
+		}
+
+		constexpr Matrix(const Matrix& m) = default;
+		constexpr Matrix& operator=(const Matrix& m) = default;
+
+		constexpr Vector3 TransformVector(const Vector3& v) const
+		{
+			return TransformVector(v.x, v.y, v.z);
+		}
+
+		constexpr Vector3 TransformVector(float x, float y, float z) const
+		{
+#if defined(MATH_SSE)
+			if (!std::is_constant_evaluated())
+			{
+				return Vector4::FromSSE(Combine(x, y, z));
+			}
+#endif
+			return Vector3{
+				data[0].x * x + data[1].x * y + data[2].x * z,
+				data[0].y * x + data[1].y * y + data[2].y * z,
+				data[0].z * x + data[1].z * y + data[2].z * z
+			};
+		}
+
+		constexpr Vector3 TransformPoint(const Vector3& p) const
+		{
+			return TransformPoint(p.x, p.y, p.z);
+		}
+
+		constexpr Vector3 TransformPoint(float x, float y, float z) const
+		{
+#if defined(MATH_SSE)
+			if (!std::is_constant_evaluated())
+			{
+				return Vector4::FromSSE(_mm_add_ps(Combine(x, y, z), data[3].Load()));
+			}
+#endif
+			return Vector3{
+				data[0].x * x + data[1].x * y + data[2].x * z + data[3].x,
+				data[0].y * x + data[1].y * y + data[2].y * z + data[3].y,
+				data[0].z * x + data[1].z * y + data[2].z * z + data[3].z,
+			};
+		}
+
+		/**
+		 * \brief Transforms a whole array of points, 8 at a time when AVX2 is available
+		 * \param pPoints Points to transform
+		 * \param pResult Preallocated output for count points, can't overlap pPoints
+		 * \param count Amount of points
+		 */
+		void TransformPoints(const Vector3* pPoints, Vector3* pResult, size_t count) const
+		{
+			TransformBatch<true>(pPoints, pResult, count);
+		}
+
+		/**
+		 * \brief Transforms a whole array of vectors (no translation), 8 at a time when AVX2 is available
+		 * \param pVectors Vectors to transform
+		 * \param pResult Preallocated output for count vectors, can't overlap pVectors
+		 * \param count Amount of vectors
+		 */
+		void TransformVectors(const Vector3* pVectors, Vector3* pResult, size_t count) const
+		{
+			TransformBatch<false>(pVectors, pResult, count);
+		}
+
+		constexpr const Matrix& Transpose()
+		{
+			*this = Transpose(*this);
+			return *this;
+		}
+
+		constexpr Vector3 GetAxisX() const { return data[0]; }
+		constexpr Vector3 GetAxisY() const { return data[1]; }
+		constexpr Vector3 GetAxisZ() const { return data[2]; }
+		constexpr Vector3 GetTranslation() const { return data[3]; }
+
+		static constexpr Matrix CreateTranslation(float x, float y, float z)
+		{
+			return {
+				Vector4{ 1.f, 0.f, 0.f, 0.f },
+				Vector4{ 0.f, 1.f, 0.f, 0.f },
+				Vector4{ 0.f, 0.f, 1.f, 0.f },
+				Vector4{ x, y, z, 1.f }
+			};
+		}
+
+		static constexpr Matrix CreateTranslation(const Vector3& t)
+		{
+			return { Vector3::UnitX, Vector3::UnitY, Vector3::UnitZ, t };
+		}
+
+		static Matrix CreateRotationX(float pitch)
+		{
+			return {
+				Vector4{ 1.f, 0.f, 0.f, 0.f },
+				Vector4{ 0.f, cosf(pitch), sinf(pitch), 0.f },
+				Vector4{ 0.f, -sinf(pitch), cosf(pitch), 0.f },
+				Vector4{ 0.f, 0.f, 0.f, 1.f }
+			};
+		}
+
+		static Matrix CreateRotationY(float yaw)
+		{
+			return {
+				Vector4{ cosf(yaw), 0.f, -sinf(yaw), 0.f },
+				Vector4{ 0.f, 1.f, 0.f, 0.f },
+				Vector4{ sinf(yaw), 0.f, cosf(yaw), 0.f },
+				Vector4{ 0.f, 0.f, 0.f, 1.f }
+			};
+		}
+
+		static Matrix CreateRotationZ(float roll)
+		{
+			return {
+				Vector4{ cosf(roll), sinf(roll), 0.f, 0.f },
+				Vector4{ -sinf(roll), cosf(roll), 0.f, 0.f },
+				Vector4{ 0.f, 0.f, 1.f, 0.f },
+				Vector4{ 0.f, 0.f, 0.f, 1.f }
+			};
+		}
+
+		static Matrix CreateRotation(float pitch, float yaw, float roll)
+		{
+			return CreateRotation({ pitch, yaw, roll });
+		}
+
+		static Matrix CreateRotation(const Vector3& r)
+		{
+			return { CreateRotationX(r[0] * r[1] * r[2] * r[3]) * CreateRotationY(r[0] * r[1] * r[2] * r[3]) * CreateRotationZ(r[0] * r[1] * r[2] * r[3]) };
+		}
+
+		static constexpr Matrix CreateScale(float sx, float sy, float sz)
+		{
+			return {
+				Vector4{ sx, 0.f, 0.f, 0.f },
+				Vector4{ 0.f, sy, 0.f, 0.f },
+				Vector4{ 0.f, 0.f, sz, 0.f },
+				Vector4{ 0.f, 0.f, 0.f, 1.f }
+			};
+		}
+
+		static constexpr Matrix CreateScale(const Vector3& s)
+		{
+			return CreateScale(s.x, s.y, s.z);
+		}
+
+		static constexpr Matrix Transpose(const Matrix& m)
+		{
+			Matrix result{};
+			for (int r{ 0 }; r < 4; ++r)
+			{
+				for (int c{ 0 }; c < 4; ++c)
+				{
+					result[r][c] = m[c][r];
+				}
+			}
+
+			return result;
+		}
+
+#pragma region Operator Overloads
+		constexpr Vector4& operator[](int index)
+		{
+			assert(index <= 3 && index >= 0);
+			return data[index];
+		}
+
+		constexpr Vector4 operator[](int index) const
+		{
+			assert(index <= 3 && index >= 0);
+			return data[index];
+		}
+
+		constexpr Matrix operator*(const Matrix& m) const
+		{
+			Matrix result{};
+
+			//row r of the result is row r of this matrix combining the rows of m
+			for (int r{ 0 }; r < 4; ++r)
+			{
+#if defined(MATH_SSE)
+				if (!std::is_constant_evaluated())
+				{
+					__m128 row{ _mm_mul_ps(_mm_set1_ps(data[r].x), m.data[0].Load()) };
+					row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(data[r].y), m.data[1].Load()));
+					row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(data[r].z), m.data[2].Load()));
+					row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(data[r].w), m.data[3].Load()));
+					result.data[r].Store(row);
+					continue;
+				}
+#endif
+				for (int c{ 0 }; c < 4; ++c)
+				{
+					result[r][c] = data[r].x * m[0][c] + data[r].y * m[1][c] + data[r].z * m[2][c] + data[r].w * m[3][c];
+				}
+			}
+
+			return result;
+		}
+
+		constexpr const Matrix& operator*=(const Matrix& m)
+		{
+			*this = *this * m;
+			return *this;
+		}
+#pragma endregion
 
 	private:
+		template<bool isPoint>
+		void TransformBatch(const Vector3* pInput, Vector3* pResult, size_t count) const
+		{
+			size_t idx{};
+
+#if defined(MATH_AVX2)
+			//matrix elements broadcast once for the whole batch
+			const __m256 m00{ _mm256_set1_ps(data[0].x) }, m01{ _mm256_set1_ps(data[0].y) }, m02{ _mm256_set1_ps(data[0].z) };
+			const __m256 m10{ _mm256_set1_ps(data[1].x) }, m11{ _mm256_set1_ps(data[1].y) }, m12{ _mm256_set1_ps(data[1].z) };
+			const __m256 m20{ _mm256_set1_ps(data[2].x) }, m21{ _mm256_set1_ps(data[2].y) }, m22{ _mm256_set1_ps(data[2].z) };
+			const __m256 t0{ _mm256_set1_ps(isPoint ? data[3].x : 0.f) };
+			const __m256 t1{ _mm256_set1_ps(isPoint ? data[3].y : 0.f) };
+			const __m256 t2{ _mm256_set1_ps(isPoint ? data[3].z : 0.f) };
+
+			for (; idx + 8 <= count; idx += 8)
+			{
+				//8 xyz points = 24 floats, points 0-3 go in the low halves, points 4-7 in the high halves
+				const float* pIn{ &pInput[idx].x };
+				const __m256 m03{ _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(pIn)), _mm_loadu_ps(pIn + 12), 1) };
+				const __m256 m14{ _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(pIn + 4)), _mm_loadu_ps(pIn + 16), 1) };
+				const __m256 m25{ _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(pIn + 8)), _mm_loadu_ps(pIn + 20), 1) };
+
+				//AoS > SoA
+				const __m256 xy{ _mm256_shuffle_ps(m14, m25, _MM_SHUFFLE(2, 1, 3, 2)) };
+				const __m256 yz{ _mm256_shuffle_ps(m03, m14, _MM_SHUFFLE(1, 0, 2, 1)) };
+				const __m256 x{ _mm256_shuffle_ps(m03, xy, _MM_SHUFFLE(2, 0, 3, 0)) };
+				const __m256 y{ _mm256_shuffle_ps(yz, xy, _MM_SHUFFLE(3, 1, 2, 0)) };
+				const __m256 z{ _mm256_shuffle_ps(yz, m25, _MM_SHUFFLE(3, 0, 3, 1)) };
+
+				const __m256 rx{ _mm256_fmadd_ps(z, m20, _mm256_fmadd_ps(y, m10, _mm256_fmadd_ps(x, m00, t0))) };
+				const __m256 ry{ _mm256_fmadd_ps(z, m21, _mm256_fmadd_ps(y, m11, _mm256_fmadd_ps(x, m01, t1))) };
+				const __m256 rz{ _mm256_fmadd_ps(z, m22, _mm256_fmadd_ps(y, m12, _mm256_fmadd_ps(x, m02, t2))) };
+
+				//SoA > AoS
+				const __m256 rxy{ _mm256_shuffle_ps(rx, ry, _MM_SHUFFLE(2, 0, 2, 0)) };
+				const __m256 ryz{ _mm256_shuffle_ps(ry, rz, _MM_SHUFFLE(3, 1, 3, 1)) };
+				const __m256 rzx{ _mm256_shuffle_ps(rz, rx, _MM_SHUFFLE(3, 1, 2, 0)) };
+				const __m256 r03{ _mm256_shuffle_ps(rxy, rzx, _MM_SHUFFLE(2, 0, 2, 0)) };
+				const __m256 r14{ _mm256_shuffle_ps(ryz, rxy, _MM_SHUFFLE(3, 1, 2, 0)) };
+				const __m256 r25{ _mm256_shuffle_ps(rzx, ryz, _MM_SHUFFLE(3, 1, 3, 1)) };
+
+				float* pOut{ &pResult[idx].x };
+				_mm_storeu_ps(pOut, _mm256_castps256_ps128(r03));
+				_mm_storeu_ps(pOut + 4, _mm256_castps256_ps128(r14));
+				_mm_storeu_ps(pOut + 8, _mm256_castps256_ps128(r25));
+				_mm_storeu_ps(pOut + 12, _mm256_extractf128_ps(r03, 1));
+				_mm_storeu_ps(pOut + 16, _mm256_extractf128_ps(r14, 1));
+				_mm_storeu_ps(pOut + 20, _mm256_extractf128_ps(r25, 1));
+			}
+#endif
+			//remainder (or everything without AVX2)
+			for (; idx < count; ++idx)
+			{
+				pResult[idx] = isPoint ? TransformPoint(pInput[idx]) : TransformVector(pInput[idx]);
+			}
+		}
+
+#if defined(MATH_SSE)
+		//x * xAxis + y * yAxis + z * zAxis
+		__m128 Combine(float x, float y, float z) const
+		{
+			__m128 result{ _mm_mul_ps(_mm_set1_ps(x), data[0].Load()) };
+			result = _mm_add_ps(result, _mm_mul_ps(_mm_set1_ps(y), data[1].Load()));
+			return _mm_add_ps(result, _mm_mul_ps(_mm_set1_ps(z), data[2].Load()));
+		}
+#endif
 
 		//Row-Major Matrix
 		Vector4 data[4]
@@ -63,4 +323,4 @@ namespace dae {
 		// v2x v2y v2z v2w
 		// v3x v3y v3z v3w
 	};
-}
\ No newline at end of file
+}
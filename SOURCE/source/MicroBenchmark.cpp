@@ -0,0 +1,288 @@
+#include "MicroBenchmark.h"
+
+//Standard includes
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <vector>
+
+//Project includes
+#include "Math.h"
+#include "DataTypes.h"
+#include "Utils.h"
+
+namespace dae
+{
+	namespace MicroBenchmark
+	{
+		enum class RaySet
+		{
+			HitHeavy, //aimed at the middle of the primitive
+			MissHeavy, //aimed next to it (or away from it, for planes)
+			Grazing //silhouette of closed shapes, almost parallel for flat ones
+		};
+		constexpr RaySet RaySets[]{ RaySet::HitHeavy, RaySet::MissHeavy, RaySet::Grazing };
+
+		static const char* GetName(RaySet set)
+		{
+			switch (set)
+			{
+			case RaySet::HitHeavy: return "hit-heavy";
+			case RaySet::MissHeavy: return "miss-heavy";
+			default: return "grazing";
+			}
+		}
+
+		//what the rays get aimed at
+		struct RayTarget
+		{
+			Vector3 center{};
+			float radius{}; //bounding radius
+			Vector3 normal{}; //only for flat primitives
+			bool isFlat{};
+			bool isUnbounded{};
+		};
+
+		static const char* GetInstructionSet()
+		{
+#if defined(MATH_AVX2)
+			return "AVX2";
+#elif defined(MATH_SSE)
+			return "SSE";
+#else
+			return "scalar";
+#endif
+		}
+
+#pragma region Ray Generation
+		static Vector3 GetPerpendicular(const Vector3& v)
+		{
+			const Vector3 helper{ std::abs(v.x) < .9f ? Vector3::UnitX : Vector3::UnitY };
+			return Vector3::Cross(v, helper).Normalized();
+		}
+
+		//same seed every run, so the numbers of two builds can be compared
+		static std::vector<Ray> GenerateRays(RaySet set, const RayTarget& target, int numRays, uint32_t seed)
+		{
+			std::mt19937 generator{ seed };
+			std::uniform_real_distribution<float> unit{ 0.f, 1.f };
+			std::normal_distribution<float> gaussian{};
+
+			const auto randomDirection{ [&]
+			{
+				return Vector3{ gaussian(generator), gaussian(generator), gaussian(generator) }.Normalized();
+			} };
+
+			std::vector<Ray> rays{};
+			rays.reserve(numRays);
+
+			const float distance{ 10.f };
+			for (int idx{}; idx < numRays; ++idx)
+			{
+				Vector3 origin{}, direction{};
+
+				if (set == RaySet::Grazing && target.isFlat)
+				{
+					//skim across the surface, a tiny bit above or below it
+					const Vector3 tangent{ GetPerpendicular(target.normal) };
+					const Vector3 bitangent{ Vector3::Cross(target.normal, tangent) };
+					const float angle{ unit(generator) * PI_2 };
+					const Vector3 across{ tangent * cosf(angle) + bitangent * sinf(angle) };
+
+					origin = target.center - across * distance + target.normal * ((unit(generator) - .5f) * .01f * target.radius);
+					const Vector3 aim{ target.center + across * ((unit(generator) - .5f) * target.radius) };
+					direction = (aim - origin).Normalized();
+				}
+				else if (set == RaySet::MissHeavy && target.isUnbounded)
+				{
+					//start above the plane, point away from it
+					origin = target.center + target.normal * (1.f + unit(generator) * distance) + GetPerpendicular(target.normal) * ((unit(generator) - .5f) * distance);
+					direction = randomDirection();
+					if (Vector3::Dot(direction, target.normal) < 0.f)
+						direction = -direction;
+				}
+				else
+				{
+					//start on a sphere around the target, aim at a point in the plane facing the origin
+					origin = target.center + randomDirection() * distance;
+					if (target.isUnbounded && Vector3::Dot(origin - target.center, target.normal) < 0.f)
+						origin = origin - target.normal * (2.f * Vector3::Dot(origin - target.center, target.normal));
+
+					const Vector3 toTarget{ (target.center - origin).Normalized() };
+					const Vector3 side{ GetPerpendicular(toTarget) };
+					const Vector3 up{ Vector3::Cross(toTarget, side) };
+					const float angle{ unit(generator) * PI_2 };
+
+					float offset{};
+					switch (set)
+					{
+					case RaySet::HitHeavy: offset = unit(generator) * .5f; break;
+					case RaySet::MissHeavy: offset = 1.5f + unit(generator) * 1.5f; break;
+					default: offset = .97f + unit(generator) * .06f; break;
+					}
+
+					const Vector3 aim{ target.center + (side * cosf(angle) + up * sinf(angle)) * (offset * target.radius) };
+					direction = (aim - origin).Normalized();
+				}
+
+				rays.push_back(Ray{ origin, direction });
+			}
+			return rays;
+		}
+#pragma endregion
+
+#pragma region Timing
+		struct KernelResult
+		{
+			double nanosecondsPerTest{};
+			int hits{};
+			uint32_t checksum{};
+			std::vector<float> hitDistances{}; //FLT_MAX for a miss
+		};
+
+		template<typename HitTest>
+		static KernelResult TimeHitTest(const std::vector<Ray>& rays, HitTest hitTest)
+		{
+			KernelResult result{};
+
+			//untimed pass for the cross-checks, t is rounded so the checksum survives tiny ISA differences
+			result.hitDistances.reserve(rays.size());
+			result.checksum = 2166136261u; //FNV-1a
+			for (const Ray& ray : rays)
+			{
+				HitRecord hitRecord{};
+				const bool didHit{ hitTest(ray, hitRecord) };
+				result.hits += didHit ? 1 : 0;
+				result.hitDistances.push_back(didHit ? hitRecord.t : FLT_MAX);
+
+				const uint32_t value{ didHit ? static_cast<uint32_t>(std::lround(hitRecord.t * 256.f)) : 0xFFFFFFFFu };
+				result.checksum = (result.checksum ^ value) * 16777619u;
+			}
+
+			//best of a few runs, to filter out scheduling noise
+			const int numRepeats{ 5 };
+			double bestNanoseconds{ DBL_MAX };
+			//the timed hits of every run get checked, so none of the loops can be optimized away
+			int timedHits{};
+			for (int repeat{}; repeat < numRepeats; ++repeat)
+			{
+				int hits{};
+				const auto start{ std::chrono::high_resolution_clock::now() };
+				for (const Ray& ray : rays)
+				{
+					HitRecord hitRecord{};
+					hits += hitTest(ray, hitRecord) ? 1 : 0;
+				}
+				const auto end{ std::chrono::high_resolution_clock::now() };
+				timedHits += hits;
+
+				bestNanoseconds = std::min(bestNanoseconds, std::chrono::duration<double, std::nano>(end - start).count());
+			}
+
+			if (timedHits != result.hits * numRepeats)
+				std::cout << "  timed runs hit " << timedHits << " times, the checked pass " << result.hits * numRepeats << "\n";
+
+			result.nanosecondsPerTest = bestNanoseconds / rays.size();
+			return result;
+		}
+
+		static void Print(const char* kernelName, RaySet set, const KernelResult& result, size_t numRays)
+		{
+			std::printf("  %-34s %-10s %8.2f ns/test %9.1f Mtests/s  hits %5.1f%%  checksum %08x\n",
+				kernelName, GetName(set), result.nanosecondsPerTest, 1000.0 / result.nanosecondsPerTest,
+				100.0 * result.hits / numRays, result.checksum);
+		}
+
+		//two kernels that should agree, within a relative tolerance on t
+		static void CrossCheck(const char* nameA, const KernelResult& a, const char* nameB, const KernelResult& b, RaySet set)
+		{
+			int mismatches{};
+			for (size_t idx{}; idx < a.hitDistances.size(); ++idx)
+			{
+				const float tA{ a.hitDistances[idx] }, tB{ b.hitDistances[idx] };
+				if ((tA == FLT_MAX) != (tB == FLT_MAX) || (tA != FLT_MAX && std::abs(tA - tB) > 1e-3f * std::max(1.f, tA)))
+					++mismatches;
+			}
+
+			std::printf("  cross-check %s vs %s (%s): %d of %zu rays disagree%s\n", nameA, nameB, GetName(set), mismatches, a.hitDistances.size(),
+				mismatches * 1000 > static_cast<int>(a.hitDistances.size()) ? "  MISMATCH" : "");
+		}
+#pragma endregion
+
+		void RunIntersectionBenchmarks(int numRays)
+		{
+			//primitives taken from the reference scene
+			const Sphere sphere{ Vector3{ 0.f, 3.f, 0.f }, .75f };
+			const Plane plane{ Vector3{ 0.f, 0.f, 10.f }, Vector3{ 0.f, 0.f, -1.f } };
+
+			Triangle triangle{ Vector3(-.75f, 4.5f, 0.f), Vector3(.75f, 3.f, 0.f), Vector3(-.75f, 3.f, 0.f) };
+			triangle.cullMode = TriangleCullMode::NoCulling;
+
+			//closed cube of 12 triangles, so the slab test and the triangle loop both have work
+			TriangleMesh mesh{};
+			mesh.cullMode = TriangleCullMode::NoCulling;
+			const Vector3 corners[8]{ { -1, -1, -1 }, { 1, -1, -1 }, { 1, 1, -1 }, { -1, 1, -1 }, { -1, -1, 1 }, { 1, -1, 1 }, { 1, 1, 1 }, { -1, 1, 1 } };
+			const int faces[6][4]{ { 0, 1, 2, 3 }, { 5, 4, 7, 6 }, { 4, 0, 3, 7 }, { 1, 5, 6, 2 }, { 3, 2, 6, 7 }, { 4, 5, 1, 0 } };
+			for (const auto& face : faces)
+			{
+				mesh.AppendTriangle(Triangle{ corners[face[0]], corners[face[1]], corners[face[2]] }, true);
+				mesh.AppendTriangle(Triangle{ corners[face[0]], corners[face[2]], corners[face[3]] }, true);
+			}
+			mesh.Translate({ 0.f, 3.f, 0.f });
+			mesh.UpdateAABB();
+			mesh.UpdateTransforms();
+
+			const Vector3 triangleCenter{ (triangle.v0 + triangle.v1 + triangle.v2) / 3.f };
+			const RayTarget sphereTarget{ sphere.origin, sphere.radius };
+			const RayTarget planeTarget{ plane.origin, 5.f, plane.normal, true, true };
+			const RayTarget triangleTarget{ triangleCenter, (triangle.v0 - triangleCenter).Magnitude(), triangle.normal, true };
+			const RayTarget meshTarget{ Vector3{ 0.f, 3.f, 0.f }, 1.f }; //half extent, so grazing rays skim the faces
+
+			std::cout << "**MICROBENCHMARK** " << numRays << " rays per set, " << GetInstructionSet() << " build\n";
+			std::cout << "(compare checksums between builds to cross-check ISA variants)\n";
+
+			for (const RaySet set : RaySets)
+			{
+				const std::vector<Ray> sphereRays{ GenerateRays(set, sphereTarget, numRays, 1337) };
+				const std::vector<Ray> planeRays{ GenerateRays(set, planeTarget, numRays, 1338) };
+				const std::vector<Ray> triangleRays{ GenerateRays(set, triangleTarget, numRays, 1339) };
+				const std::vector<Ray> meshRays{ GenerateRays(set, meshTarget, numRays, 1340) };
+
+				std::cout << GetName(set) << "\n";
+
+				const KernelResult sphereResult{ TimeHitTest(sphereRays, [&](const Ray& ray, HitRecord& hitRecord) { return GeometryUtils::HitTest_Sphere(sphere, ray, hitRecord); }) };
+				Print("HitTest_Sphere", set, sphereResult, sphereRays.size());
+
+				const KernelResult planeResult{ TimeHitTest(planeRays, [&](const Ray& ray, HitRecord& hitRecord) { return GeometryUtils::HitTest_Plane(plane, ray, hitRecord); }) };
+				Print("HitTest_Plane", set, planeResult, planeRays.size());
+
+				const KernelResult triangleResult{ TimeHitTest(triangleRays, [&](const Ray& ray, HitRecord& hitRecord) { return GeometryUtils::HitTest_Triangle(triangle, ray, hitRecord); }) };
+				Print("HitTest_Triangle", set, triangleResult, triangleRays.size());
+
+				const KernelResult mullerResult{ TimeHitTest(triangleRays, [&](const Ray& ray, HitRecord& hitRecord) { return GeometryUtils::HitTest_Triangle_MullerTrombore(triangle, ray, hitRecord); }) };
+				Print("HitTest_Triangle_MullerTrombore", set, mullerResult, triangleRays.size());
+
+				//the slab test doesn't give a distance, record its entry as a hit at t = 0
+				const KernelResult slabResult{ TimeHitTest(meshRays, [&](const Ray& ray, HitRecord& hitRecord) { hitRecord.t = 0.f; return GeometryUtils::SlabTest_TriangleMesh(mesh, ray); }) };
+				Print("SlabTest_TriangleMesh", set, slabResult, meshRays.size());
+
+				const KernelResult meshResult{ TimeHitTest(meshRays, [&](const Ray& ray, HitRecord& hitRecord) { return GeometryUtils::HitTest_TriangleMesh(mesh, ray, hitRecord); }) };
+				Print("HitTest_TriangleMesh", set, meshResult, meshRays.size());
+
+				CrossCheck("HitTest_Triangle", triangleResult, "HitTest_Triangle_MullerTrombore", mullerResult, set);
+
+				//every mesh hit has to get through the slab test first
+				int slabMisses{};
+				for (size_t idx{}; idx < meshRays.size(); ++idx)
+				{
+					if (meshResult.hitDistances[idx] != FLT_MAX && slabResult.hitDistances[idx] == FLT_MAX)
+						++slabMisses;
+				}
+				std::printf("  cross-check SlabTest_TriangleMesh vs HitTest_TriangleMesh (%s): %d mesh hits rejected by the slab test%s\n",
+					GetName(set), slabMisses, slabMisses > 0 ? "  MISMATCH" : "");
+			}
+		}
+	}
+}
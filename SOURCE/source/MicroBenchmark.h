@@ -0,0 +1,13 @@
+#pragma once
+
+namespace dae
+{
+	namespace MicroBenchmark
+	{
+		/**
+		 * \brief Times the GeometryUtils hit-tests over a fixed set of random rays, no window needed
+		 * \param numRays Amount of rays fired at every primitive
+		 */
+		void RunIntersectionBenchmarks(int numRays = 1'000'000);
+	}
+}
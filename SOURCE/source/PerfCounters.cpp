@@ -0,0 +1,262 @@
+#include "PerfCounters.h"
+
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#if defined(__linux__)
+#include <cerrno>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace dae
+{
+	namespace PerfCounters
+	{
+		std::atomic<bool> g_IsEnabled{ false };
+
+		//own cache line per thread, only the owner writes it
+		struct alignas(64) ThreadCounters
+		{
+			std::array<int, 4> fileDescriptors{ -1, -1, -1, -1 }; //cycles is the group leader
+			bool isOpen{};
+			PhaseValues phases{};
+		};
+
+		static std::mutex g_RegistryMutex{};
+		static std::vector<std::unique_ptr<ThreadCounters>> g_Registry{}; //threads that are still running
+		static PhaseValues g_ExitedPhases{}; //what the threads that ended counted since the last Collect
+		static std::atomic<bool> g_HasOpened{ false }; //a group opened once, so a later failure means a thread's counts go missing
+
+#if defined(__linux__)
+		static int OpenCounter(uint64_t config, int groupFileDescriptor)
+		{
+			perf_event_attr attributes{};
+			attributes.type = PERF_TYPE_HARDWARE;
+			attributes.size = sizeof(perf_event_attr);
+			attributes.config = config;
+			attributes.read_format = PERF_FORMAT_GROUP;
+			//user space only, also keeps it working with perf_event_paranoid = 2
+			attributes.exclude_kernel = 1;
+			attributes.exclude_hv = 1;
+
+			//pid 0 + cpu -1 = the calling thread on whatever core it runs
+			return static_cast<int>(syscall(SYS_perf_event_open, &attributes, 0, -1, groupFileDescriptor, 0));
+		}
+
+		static void Close(ThreadCounters& counters)
+		{
+			for (int& fileDescriptor : counters.fileDescriptors)
+			{
+				if (fileDescriptor >= 0)
+					close(fileDescriptor);
+				fileDescriptor = -1;
+			}
+			counters.isOpen = false;
+		}
+
+		//opens the group for the calling thread, returns the errno of the first counter that failed
+		static int Open(ThreadCounters& counters)
+		{
+			constexpr std::array<uint64_t, 4> configs{ PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES };
+
+			for (size_t idx{}; idx < configs.size(); ++idx)
+			{
+				counters.fileDescriptors[idx] = OpenCounter(configs[idx], idx == 0 ? -1 : counters.fileDescriptors[0]);
+				if (counters.fileDescriptors[idx] < 0)
+				{
+					const int error{ errno };
+					Close(counters);
+					return error;
+				}
+			}
+
+			counters.isOpen = true;
+			g_HasOpened.store(true, std::memory_order_relaxed);
+			return 0;
+		}
+
+		static Values Read(const ThreadCounters& counters)
+		{
+			//PERF_FORMAT_GROUP: number of counters followed by their values, in the order they were opened
+			struct
+			{
+				uint64_t nrOfValues;
+				uint64_t values[4];
+			} data{};
+
+			if (read(counters.fileDescriptors[0], &data, sizeof(data)) != sizeof(data))
+				return Values{};
+
+			return Values{ data.values[0], data.values[1], data.values[2], data.values[3] };
+		}
+#else
+		static int Open(ThreadCounters&)
+		{
+			return -1;
+		}
+
+		static void Close(ThreadCounters&)
+		{
+		}
+
+		static Values Read(const ThreadCounters&)
+		{
+			return Values{};
+		}
+#endif
+
+		//owned by its thread, opens the counters on the thread's first count and closes them when the thread ends
+		//what they counted stays for the next Collect, so pools that come and go neither leak descriptors nor lose counts
+		class ThreadRegistration final
+		{
+		public:
+			ThreadRegistration()
+			{
+				auto pCounters{ std::make_unique<ThreadCounters>() };
+				const bool hadOpened{ g_HasOpened.load(std::memory_order_relaxed) };
+				const int error{ Open(*pCounters) };
+				if (error != 0 && hadOpened)
+				{
+					std::lock_guard lock{ g_RegistryMutex };
+					std::cout << "Hardware counters of a thread failed to open (" << std::strerror(error) << "), its counts are missing from the totals\n";
+				}
+
+				m_pCounters = pCounters.get();
+				std::lock_guard lock{ g_RegistryMutex };
+				g_Registry.push_back(std::move(pCounters));
+			}
+
+			~ThreadRegistration()
+			{
+				Close(*m_pCounters);
+
+				std::lock_guard lock{ g_RegistryMutex };
+				for (int phase{}; phase < NrOfPhases; ++phase)
+					g_ExitedPhases[phase] += m_pCounters->phases[phase];
+
+				std::erase_if(g_Registry, [this](const std::unique_ptr<ThreadCounters>& pCounters) { return pCounters.get() == m_pCounters; });
+			}
+
+			ThreadRegistration(const ThreadRegistration&) = delete;
+			ThreadRegistration(ThreadRegistration&&) noexcept = delete;
+			ThreadRegistration& operator=(const ThreadRegistration&) = delete;
+			ThreadRegistration& operator=(ThreadRegistration&&) noexcept = delete;
+
+			ThreadCounters& GetCounters() const { return *m_pCounters; }
+
+		private:
+			ThreadCounters* m_pCounters{};
+		};
+
+		static ThreadCounters& GetThreadCounters()
+		{
+			thread_local ThreadRegistration registration{};
+			return registration.GetCounters();
+		}
+
+		bool Enable()
+		{
+#if defined(__linux__)
+			ThreadCounters probe{};
+			const int error{ Open(probe) };
+			if (error != 0)
+			{
+				std::cout << "Hardware counters unavailable: " << std::strerror(error);
+				if (error == EACCES || error == EPERM)
+					std::cout << " (see /proc/sys/kernel/perf_event_paranoid)";
+				std::cout << "\n";
+				return false;
+			}
+
+			Close(probe);
+
+			g_IsEnabled.store(true, std::memory_order_release);
+			return true;
+#else
+			std::cout << "Hardware counters unavailable: perf_event_open is Linux only\n";
+			return false;
+#endif
+		}
+
+		void Disable()
+		{
+			g_IsEnabled.store(false, std::memory_order_release);
+		}
+
+		PhaseValues Collect()
+		{
+			std::lock_guard lock{ g_RegistryMutex };
+
+			PhaseValues totals{ g_ExitedPhases };
+			g_ExitedPhases = PhaseValues{};
+			for (const auto& pCounters : g_Registry)
+			{
+				for (int phase{}; phase < NrOfPhases; ++phase)
+					totals[phase] += pCounters->phases[phase];
+				pCounters->phases = PhaseValues{};
+			}
+			return totals;
+		}
+
+		void Print(std::ostream& stream, const PhaseValues& values)
+		{
+			constexpr const char* phaseNames[NrOfPhases]{ "intersection", "shading", "pack" };
+
+			for (int phase{}; phase < NrOfPhases; ++phase)
+			{
+				const Values& phaseValues{ values[phase] };
+				const double kiloInstructions{ phaseValues.instructions / 1000.0 };
+
+				stream << ">> " << phaseNames[phase] << ": " << phaseValues.cycles << " cycles, " << phaseValues.instructions << " instructions";
+				if (phaseValues.cycles > 0 && kiloInstructions > 0)
+				{
+					stream << " (IPC " << static_cast<double>(phaseValues.instructions) / phaseValues.cycles
+						<< "), LLC misses " << phaseValues.llcMisses << " (" << phaseValues.llcMisses / kiloInstructions
+						<< "/kinstr), branch misses " << phaseValues.branchMisses << " (" << phaseValues.branchMisses / kiloInstructions << "/kinstr)";
+				}
+				stream << "\n";
+			}
+		}
+
+		PhaseScope::PhaseScope(Phase phase) :
+			m_Phase{ phase }
+		{
+			if (!IsEnabled())
+				return;
+
+			ThreadCounters& counters{ GetThreadCounters() };
+			if (!counters.isOpen)
+				return;
+
+			m_pCounters = &counters;
+			m_Start = Read(counters);
+		}
+
+		PhaseScope::~PhaseScope()
+		{
+			if (m_pCounters)
+				Switch(m_Phase);
+		}
+
+		void PhaseScope::Switch(Phase phase)
+		{
+			if (!m_pCounters)
+				return;
+
+			const Values now{ Read(*m_pCounters) };
+			Values& total{ m_pCounters->phases[static_cast<int>(m_Phase)] };
+			total.cycles += now.cycles - m_Start.cycles;
+			total.instructions += now.instructions - m_Start.instructions;
+			total.llcMisses += now.llcMisses - m_Start.llcMisses;
+			total.branchMisses += now.branchMisses - m_Start.branchMisses;
+
+			m_Phase = phase;
+			m_Start = now;
+		}
+	}
+}
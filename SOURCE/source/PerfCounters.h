@@ -0,0 +1,74 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+
+namespace dae
+{
+	/**
+	 * \brief Optional hardware counters (cycles, instructions, LLC misses, branch misses) per thread, attributed to render phases
+	 * Uses perf_event_open, so it only counts on Linux and only when the kernel lets us, otherwise Enable reports why and nothing is counted
+	 */
+	namespace PerfCounters
+	{
+		enum class Phase
+		{
+			Intersection, //traversal and hit tests of primary and shadow rays
+			Shading, //the batched BRDF pass of a tile
+			Pack //resolving the HDR planes into the surface
+		};
+		inline constexpr int NrOfPhases{ 3 };
+
+		struct Values
+		{
+			uint64_t cycles{};
+			uint64_t instructions{};
+			uint64_t llcMisses{};
+			uint64_t branchMisses{};
+
+			Values& operator+=(const Values& values)
+			{
+				cycles += values.cycles;
+				instructions += values.instructions;
+				llcMisses += values.llcMisses;
+				branchMisses += values.branchMisses;
+				return *this;
+			}
+		};
+		using PhaseValues = std::array<Values, NrOfPhases>;
+
+		extern std::atomic<bool> g_IsEnabled;
+		inline bool IsEnabled() { return g_IsEnabled.load(std::memory_order_relaxed); }
+
+		//opens the counters of the calling thread to check they work, the other threads open theirs when they first count and close them when they end
+		//prints why and returns false when they don't, a thread whose counters fail to open later gets a warning
+		bool Enable();
+		void Disable();
+
+		//sums and clears the counts of every thread, the ones that ended included; only call it while nothing is rendering (between frames)
+		PhaseValues Collect();
+
+		void Print(std::ostream& stream, const PhaseValues& values);
+
+		//counts everything until Switch or the end of the scope towards one phase
+		class PhaseScope final
+		{
+		public:
+			explicit PhaseScope(Phase phase);
+			~PhaseScope();
+
+			PhaseScope(const PhaseScope&) = delete;
+			PhaseScope(PhaseScope&&) noexcept = delete;
+			PhaseScope& operator=(const PhaseScope&) = delete;
+			PhaseScope& operator=(PhaseScope&&) noexcept = delete;
+
+			void Switch(Phase phase);
+
+		private:
+			struct ThreadCounters* m_pCounters{};
+			Phase m_Phase;
+			Values m_Start{};
+		};
+	}
+}
@@ -0,0 +1,56 @@
+#include "RayStats.h"
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace dae
+{
+	namespace RayStats
+	{
+#if defined(RAY_STATS)
+		//own cache line, so threads counting next to each other don't share one
+		struct alignas(64) ThreadCounters
+		{
+			RayCounters counters{};
+		};
+
+		//blocks outlive their threads, the pool can be rebuilt with another thread count
+		static std::mutex g_RegistryMutex{};
+		static std::vector<std::unique_ptr<ThreadCounters>> g_Registry{};
+
+		RayCounters& RegisterThread()
+		{
+			std::lock_guard lock{ g_RegistryMutex };
+			g_Registry.push_back(std::make_unique<ThreadCounters>());
+			return g_Registry.back()->counters;
+		}
+
+		RayCounters CollectFrame()
+		{
+			std::lock_guard lock{ g_RegistryMutex };
+
+			RayCounters frameCounters{};
+			for (const auto& pThreadCounters : g_Registry)
+			{
+				frameCounters += pThreadCounters->counters;
+				pThreadCounters->counters = RayCounters{};
+			}
+			return frameCounters;
+		}
+#endif
+
+		void Print(std::ostream& stream, const RayCounters& counters, int nrOfPixels)
+		{
+			const double pixels{ static_cast<double>(nrOfPixels) };
+			stream << "primary rays " << counters.primaryRays << ", shadow rays " << counters.shadowRays
+				<< " (" << counters.shadowRays / pixels << "/pixel), reflection rays " << counters.reflectionRays
+				<< " (" << counters.reflectionRays / pixels << "/pixel)\n"
+				<< "box tests " << counters.boxTests << " (" << counters.boxTests / pixels << "/pixel), triangle tests " << counters.triangleTests
+				<< " (" << counters.triangleTests / pixels << "/pixel)\n"
+				<< "sphere tests " << counters.sphereTests << " (" << counters.sphereTests / pixels << "/pixel), plane tests " << counters.planeTests
+				<< " (" << counters.planeTests / pixels << "/pixel)\n"
+				<< "hits " << counters.hits << ", early-outs " << counters.earlyOuts << "\n";
+		}
+	}
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include <cstdint>
+#include <ostream>
+
+//the counters only exist when RAY_STATS is defined (the Debug and Profile configurations or -DRAY_STATS),
+//Release compiles every one of them away
+
+namespace dae
+{
+	struct RayCounters
+	{
+		uint64_t primaryRays{};
+		uint64_t shadowRays{};
+		uint64_t reflectionRays{};
+		uint64_t boxTests{};
+		uint64_t triangleTests{};
+		uint64_t sphereTests{};
+		uint64_t planeTests{};
+		uint64_t hits{}; //primitive tests that found an intersection
+		uint64_t earlyOuts{}; //meshes skipped by their box + shadow rays stopped by the first occluder
+
+		uint64_t GetNrOfRays() const { return primaryRays + shadowRays + reflectionRays; }
+
+		RayCounters& operator+=(const RayCounters& counters)
+		{
+			primaryRays += counters.primaryRays;
+			shadowRays += counters.shadowRays;
+			reflectionRays += counters.reflectionRays;
+			boxTests += counters.boxTests;
+			triangleTests += counters.triangleTests;
+			sphereTests += counters.sphereTests;
+			planeTests += counters.planeTests;
+			hits += counters.hits;
+			earlyOuts += counters.earlyOuts;
+			return *this;
+		}
+	};
+
+	namespace RayStats
+	{
+#if defined(RAY_STATS)
+		//hands out a cache line per thread, only takes a lock the first time a thread asks
+		RayCounters& RegisterThread();
+
+		//counters of the calling thread, only that thread ever writes them
+		inline RayCounters& GetThreadCounters()
+		{
+			thread_local RayCounters& counters{ RegisterThread() };
+			return counters;
+		}
+
+		//sums and clears the counters of every thread, only call it while nothing is tracing (between frames)
+		RayCounters CollectFrame();
+#endif
+
+		//breakdown of one frame, per pixel where that's the more telling number
+		void Print(std::ostream& stream, const RayCounters& counters, int nrOfPixels);
+	}
+}
+
+#if defined(RAY_STATS)
+#define RAY_STATS_ADD(counter, amount) (::dae::RayStats::GetThreadCounters().counter += (amount))
+#else
+#define RAY_STATS_ADD(counter, amount) ((void)0)
+#endif
@@ -4,7 +4,15 @@
 #include "SDL.h"
 #include "SDL_surface.h"
 #include "Renderer.h"
-#include <execution>
+#include "PerfCounters.h"
+#include "Trace.h"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <numeric>
+#include <utility>
 
 using namespace dae;
 
@@ -14,137 +22,1625 @@ Renderer::Renderer(SDL_Window * pWindow) :
 {
 	//Initialize
 	SDL_GetWindowSize(pWindow, &m_Width, &m_Height);
+	Initialize();
+}
+
+Renderer::Renderer(int width, int height) :
+	m_pBuffer(SDL_CreateRGBSurfaceWithFormat(0, width, height, 32, SDL_PIXELFORMAT_ARGB8888)),
+	m_OwnsBuffer(true),
+	m_Width(width),
+	m_Height(height)
+{
+	//plain memory surface, doesn't need the video subsystem
+	assert(m_pBuffer && "Renderer: could not create the offscreen buffer");
+	Initialize();
+}
+
+Renderer::~Renderer()
+{
+	if (m_OwnsBuffer)
+	{
+		SDL_FreeSurface(m_pBuffer);
+	}
+}
+
+void Renderer::Initialize()
+{
 	m_pBufferPixels = static_cast<uint32_t*>(m_pBuffer->pixels);
+
+	//the resolve pass packs the channels itself, it only knows 32 bit surfaces with 8 bit channels
+	assert(m_pBuffer->format->BytesPerPixel == 4);
+
+	for (int idx{}; idx < m_SrgbLutSize; ++idx)
+	{
+		const float linear{ idx / float(m_SrgbLutSize - 1) };
+		const float srgb{ linear <= 0.0031308f ? linear * 12.92f : 1.055f * powf(linear, 1.f / 2.4f) - 0.055f };
+		m_SrgbLut[idx] = static_cast<uint32_t>(srgb * 255 + 0.5f);
+	}
 }
 
-void Renderer::Render(Scene* pScene) const
+void Renderer::Render(Scene* pScene)
 {
+	TRACE_SCOPE("Render");
+
 	Camera& camera = pScene->GetCamera();
 	const Matrix cameraToWorld{ camera.CalculateCameraToWorld() };
 
-	//precompute constants
-	const float ascpectRatio{ m_Width / static_cast<float>(m_Height) };
-	const float fov{ tanf( (camera.fovAngle * TO_RADIANS) * 0.5f ) };
-	const float minLengthLight{ 0.0001f };
-	
-	const uint32_t amountOfPixels{ uint32_t(m_Width * m_Height) };
+	//only does work when the fov, resolution or camera rotation changed
+	UpdateRayDirections(camera, cameraToWorld);
+
+	for (auto& bounceRayCount : m_BounceRayCounts)
+	{
+		bounceRayCount.store(0, std::memory_order_relaxed);
+	}
+
+	m_NrOfFrameSamples = 0;
+
+	//anything that changes the image makes the samples so far useless
+	const bool isAccumulating{ m_ProgressiveEnabled && !IsHeatmap(m_CurrentLightingMode) };
+	const bool isDenoising{ m_DenoiserEnabled && !IsHeatmap(m_CurrentLightingMode) && !(isAccumulating && m_ShowSampleHeatmap) };
+	const uint64_t imageKey{ isAccumulating || isDenoising ? GetImageKey(pScene) : 0 };
+	if (isAccumulating && imageKey != m_AccumulationKey)
+	{
+		m_AccumulationKey = imageKey;
+		ResetAccumulation();
+	}
+
+	UpdateLightTree(pScene);
+	UpdateLightRadii(pScene);
+	const bool isResampling{ IsResamplingLights() };
+
+	//pick the kernel once per frame
+	const TileKernel renderTile{ GetTileKernel(m_CurrentLightingMode, m_ShadowsEnabled, pScene->GetPrimitives()) };
+
+	//while accumulating only the tiles that haven't converged yet get another sample
+	const uint32_t nrOfTilesToRender{ isAccumulating ? (m_AccumulationFinished ? 0 : static_cast<uint32_t>(m_ActiveTiles.size())) : m_NrOfTiles };
+	const bool renderedAllTiles{ nrOfTilesToRender == m_NrOfTiles };
+	const auto getTileIndex = [&](uint32_t idx) { return isAccumulating ? m_ActiveTiles[idx] : idx; };
 
 #if defined(PARALLEL_EXECUTION)
 	//parallel logic
-	std::vector<uint32_t> pixelIndicies{};
-	pixelIndicies.reserve(amountOfPixels);
+	if (isResampling)
+	{
+		ResampleLights(m_pThreadPool.get(), pScene, camera.origin);
+	}
+
+	m_pThreadPool->ParallelFor(nrOfTilesToRender, [&](uint32_t idx, int)
+	{
+		const uint32_t tileIndex{ getTileIndex(idx) };
+		TRACE_SCOPE("RenderTile", tileIndex);
+		(this->*renderTile)(pScene, tileIndex, camera.origin);
+	} );
 
-	for (uint32_t idx{}; idx < amountOfPixels; ++idx)
+	if (isResampling)
 	{
-		pixelIndicies.emplace_back(idx);
+		m_LightResampler.EndFrame();
 	}
 
-	std::for_each(std::execution::par, pixelIndicies.begin(), pixelIndicies.end(), [&](int idx) 
+	if (IsHeatmap(m_CurrentLightingMode))
 	{
-		RenderPixel(pScene, idx, fov, ascpectRatio, cameraToWorld, camera.origin);
+		TRACE_SCOPE("ColorHeatmap");
+		ColorHeatmap();
+	}
+	else if (isAccumulating && m_ShowSampleHeatmap)
+	{
+		TRACE_SCOPE("ColorSampleHeatmap");
+		ColorSampleHeatmap();
+	}
+	else if (isDenoising)
+	{
+		Denoise(m_pThreadPool.get(), isAccumulating, imageKey);
+	}
+
+	m_pThreadPool->ParallelFor(m_NrOfTiles, [&](uint32_t idx, int)
+	{
+		TRACE_SCOPE("ResolveTile", idx);
+		ResolveTile(idx);
 	} );
 
 #else
 	//sychronous logic (no threading)
-	const uint32_t amountOfPixels{ uint32_t(m_Width * m_Height) };
+	if (isResampling)
+	{
+		ResampleLights(nullptr, pScene, camera.origin);
+	}
+
+	for (uint32_t idx{}; idx < nrOfTilesToRender; ++idx)
+	{
+		const uint32_t tileIndex{ getTileIndex(idx) };
+		TRACE_SCOPE("RenderTile", tileIndex);
+		(this->*renderTile)(pScene, tileIndex, camera.origin);
+	}
+
+	if (isResampling)
+	{
+		m_LightResampler.EndFrame();
+	}
+
+	if (IsHeatmap(m_CurrentLightingMode))
+	{
+		ColorHeatmap();
+	}
+	else if (isAccumulating && m_ShowSampleHeatmap)
+	{
+		ColorSampleHeatmap();
+	}
+	else if (isDenoising)
+	{
+		Denoise(nullptr, isAccumulating, imageKey);
+	}
 
-	for (uint32_t pixelIndex{}; pixelIndex < amountOfPixels; ++pixelIndex)
+	for (uint32_t tileIndex{}; tileIndex < m_NrOfTiles; ++tileIndex)
 	{
-		RenderPixel(pScene, pixelIndex, fov, ascpectRatio, cameraToWorld, camera.origin);
+		TRACE_SCOPE("ResolveTile", tileIndex);
+		ResolveTile(tileIndex);
 	}
 
 #endif
+	//the passes above have joined, so no thread is counting anymore
+#if defined(RAY_STATS)
+	m_FrameCounters = RayStats::CollectFrame();
+#endif
+
+	//the bounce counts of a partial frame would look cheap, and a new depth would start the accumulation over
+	if (m_CurrentLightingMode == LightingMode::Combined && m_ReflectionsEnabled && renderedAllTiles)
+	{
+		UpdateBounceDepth();
+	}
+	if (isAccumulating && nrOfTilesToRender > 0)
+	{
+		++m_NrOfAccumulatedFrames;
+		UpdateActiveTiles();
+	}
+	++m_FrameIndex;
+
 	//@END
+}
+
+void Renderer::Present() const
+{
 	//Update SDL Surface
-	SDL_UpdateWindowSurface(m_pWindow);
+	if (m_pWindow)
+	{
+		TRACE_SCOPE("SDL_UpdateWindowSurface");
+		SDL_UpdateWindowSurface(m_pWindow);
+	}
+}
+
+void Renderer::UpdateRayDirections(const Camera& camera, const Matrix& cameraToWorld)
+{
+	const bool resolutionChanged{ m_Width != m_CachedWidth || m_Height != m_CachedHeight };
+	const bool fovChanged{ camera.fovAngle != m_CachedFovAngle };
+
+	if (resolutionChanged)
+	{
+		const uint32_t amountOfPixels{ uint32_t(m_Width * m_Height) };
+
+		//tiles on the right and bottom edge can be partial
+		m_NrOfTilesX = (m_Width + m_TileSize - 1) / m_TileSize;
+		const int nrOfTilesY{ (m_Height + m_TileSize - 1) / m_TileSize };
+
+		m_NrOfTiles = static_cast<uint32_t>(m_NrOfTilesX * nrOfTilesY);
+
+		m_CameraRayDirections.resize(amountOfPixels);
+		m_WorldRayDirections.resize(amountOfPixels);
+
+		m_HdrRed.resize(amountOfPixels);
+		m_HdrGreen.resize(amountOfPixels);
+		m_HdrBlue.resize(amountOfPixels);
+		m_HeatValues.resize(amountOfPixels);
+
+		m_AccumRed.resize(amountOfPixels);
+		m_AccumGreen.resize(amountOfPixels);
+		m_AccumBlue.resize(amountOfPixels);
+		m_AccumLuminance.resize(amountOfPixels);
+		m_AccumLuminanceM2.resize(amountOfPixels);
+		m_AccumVariance.resize(amountOfPixels);
+
+		m_TileSampleCounts.resize(m_NrOfTiles);
+		m_TileVarianceSums.resize(m_NrOfTiles);
+		m_TileLuminanceSums.resize(m_NrOfTiles);
+
+		m_Denoiser.Resize(m_Width, m_Height, m_TileSize);
+		m_LightResampler.Resize(m_Width, m_Height, m_TileSize);
+	}
+
+	if (resolutionChanged || fovChanged)
+	{
+		//precompute constants
+		const float aspectRatio{ m_Width / static_cast<float>(m_Height) };
+		const float fov{ tanf((camera.fovAngle * TO_RADIANS) * 0.5f) };
+
+		//normalized up front, rotating keeps the length so the per frame pass is rotate-only
+		for (int py{}; py < m_Height; ++py)
+		{
+			const float cy{ (1 - (2 * ((py + 0.5f) / float(m_Height)))) * fov };
+			for (int px{}; px < m_Width; ++px)
+			{
+				const float cx{ (2 * ((px + 0.5f) / float(m_Width)) - 1) * aspectRatio * fov };
+				m_CameraRayDirections[px + (py * m_Width)] = Vector3{ cx, cy, 1.f }.Normalized();
+			}
+		}
+
+		m_CachedWidth = m_Width;
+		m_CachedHeight = m_Height;
+		m_CachedFovAngle = camera.fovAngle;
+		m_CachedFovScale = fov;
+		m_CachedAspectRatio = aspectRatio;
+	}
+
+	//translation doesn't affect directions, only redo the table when the camera rotated
+	const Vector3 right{ cameraToWorld.GetAxisX() }, up{ cameraToWorld.GetAxisY() }, forward{ cameraToWorld.GetAxisZ() };
+	if (resolutionChanged || fovChanged || right != m_CachedRight || up != m_CachedUp || forward != m_CachedForward)
+	{
+		cameraToWorld.TransformVectors(m_CameraRayDirections.data(), m_WorldRayDirections.data(), m_CameraRayDirections.size());
+
+		m_CachedRight = right;
+		m_CachedUp = up;
+		m_CachedForward = forward;
+	}
+}
+
+Renderer::TileKernel Renderer::GetTileKernel(LightingMode lightingMode, bool shadowsEnabled, uint8_t primitives)
+{
+	//table index = lightingMode * 16 + shadowsEnabled * 8 + primitives
+	//building it instantiates every kernel, so all of them get compiled in every configuration
+	constexpr size_t nrOfPrimitiveSets{ Primitives::All + 1 };
+	constexpr auto kernels{ []<size_t... indices>(std::index_sequence<indices...>)
+	{
+		return std::array<TileKernel, sizeof...(indices)>{
+			&Renderer::RenderTile<
+				static_cast<LightingMode>(indices / (2 * nrOfPrimitiveSets)),
+				((indices / nrOfPrimitiveSets) % 2) == 1,
+				static_cast<uint8_t>(indices % nrOfPrimitiveSets)>...
+		};
+	}(std::make_index_sequence<m_NrOfLightingModes * 2 * nrOfPrimitiveSets>{}) };
+
+	const size_t index{ static_cast<size_t>(lightingMode) * 2 * nrOfPrimitiveSets + (shadowsEnabled ? nrOfPrimitiveSets : 0) + primitives };
+	assert(index < kernels.size());
+	return kernels[index];
+}
+
+Renderer::SurfaceKernel Renderer::GetSurfaceKernel(uint8_t primitives)
+{
+	constexpr auto kernels{ []<size_t... indices>(std::index_sequence<indices...>)
+	{
+		return std::array<SurfaceKernel, sizeof...(indices)>{ &Renderer::TraceSurfacesTile<static_cast<uint8_t>(indices)>... };
+	}(std::make_index_sequence<Primitives::All + 1>{}) };
+
+	assert(primitives < kernels.size());
+	return kernels[primitives];
+}
+
+template<uint8_t primitives>
+void Renderer::TraceSurfacesTile(Scene* pScene, uint32_t tileIndex, const Vector3& cameraOrigin)
+{
+	const int tileX{ static_cast<int>(tileIndex % m_NrOfTilesX) * m_TileSize };
+	const int tileY{ static_cast<int>(tileIndex / m_NrOfTilesX) * m_TileSize };
+	const int tileWidth{ std::min(m_TileSize, m_Width - tileX) };
+	const int tileHeight{ std::min(m_TileSize, m_Height - tileY) };
+
+	PerfCounters::PhaseScope perfScope{ PerfCounters::Phase::Intersection };
+
+	for (int y{}; y < tileHeight; ++y)
+	{
+		for (int x{}; x < tileWidth; ++x)
+		{
+			const int pixelIndex{ (tileX + x) + ((tileY + y) * m_Width) };
+			const Vector3& rayDirection{ m_WorldRayDirections[pixelIndex] };
+
+			HitRecord closestHit{};
+			pScene->GetClosestHit<primitives>(Ray{ cameraOrigin, rayDirection }, closestHit);
+			m_LightResampler.SetSurface(pixelIndex, closestHit, -rayDirection);
+		}
+	}
+}
+
+void Renderer::ResampleLights(ThreadPool* pThreadPool, Scene* pScene, const Vector3& cameraOrigin)
+{
+	const SurfaceKernel traceSurfaces{ GetSurfaceKernel(pScene->GetPrimitives()) };
+	{
+		TRACE_SCOPE("TraceSurfaces");
+		if (pThreadPool)
+		{
+			pThreadPool->ParallelFor(m_NrOfTiles, [&](uint32_t tileIndex, int) { (this->*traceSurfaces)(pScene, tileIndex, cameraOrigin); });
+		}
+		else
+		{
+			for (uint32_t tileIndex{}; tileIndex < m_NrOfTiles; ++tileIndex)
+			{
+				(this->*traceSurfaces)(pScene, tileIndex, cameraOrigin);
+			}
+		}
+	}
+
+	TRACE_SCOPE("Resample");
+
+	//the history only holds for the frame right after it, with the same lights drawn from the same place (the tree leaves the directional ones out)
+	const bool useLightTree{ IsUsingLightTree() };
+	const uint64_t resamplingKey{ pScene->GetLightHash() ^ uint64_t(useLightTree) };
+	const bool resetHistory{ resamplingKey != m_ResamplingKey || m_FrameIndex != m_ResampledFrameIndex + 1 };
+	m_ResamplingKey = resamplingKey;
+	m_ResampledFrameIndex = m_FrameIndex;
+
+	const LightResampler::View view{ cameraOrigin, m_CachedRight, m_CachedUp, m_CachedForward, m_CachedFovScale, m_CachedAspectRatio };
+	m_LightResampler.Resample(pThreadPool, pScene->GetLights(), pScene->GetMaterials(), useLightTree ? &m_LightTree : nullptr, view,
+		m_SamplerType, m_SamplerSeed, m_FrameIndex, resetHistory);
+}
+
+template<bool shadowsEnabled, uint8_t primitives>
+int Renderer::SampleAreaLight(const Scene* pScene, const Light& light, uint32_t lightIndex, const HitRecord& hit, Sampler& sampler, uint32_t dimension,
+	LightSamples& samples, int& nrOfVisible, uint64_t& nrOfShadowRays) const
+{
+	const float minLengthLight{ 0.0001f };
+	const int gridSize{ GetShadowSampleGridSize(light, hit.origin) };
+	const int nrOfSamples{ gridSize * gridSize };
+
+	//every light shifts the pixel's numbers by its own R2 step, or all lights would leave the same pattern in the penumbras
+	const float jitterU{ fmodf(sampler.Get1D(dimension + SampleDimension::LightU) + lightIndex * .7548776662f, 1.f) };
+	const float jitterV{ fmodf(sampler.Get1D(dimension + SampleDimension::LightV) + lightIndex * .5698402910f, 1.f) };
+
+	std::array<bool, m_MaxShadowSampleLimit> isLit{};
+	for (int idx{}; idx < nrOfSamples; ++idx)
+	{
+		const float u{ (idx % gridSize + jitterU) / gridSize };
+		const float v{ (idx / gridSize + jitterV) / gridSize };
+		isLit[idx] = LightUtils::SampleAreaLight(light, hit.origin, u, v, samples[idx]) && Vector3::Dot(hit.normal, samples[idx].direction) > 0.f;
+	}
+
+	if constexpr (shadowsEnabled)
+	{
+		const auto isBlocked = [&](int idx)
+		{
+			++nrOfShadowRays;
+			return pScene->DoesHit<primitives>(Ray{ hit.origin, samples[idx].direction, minLengthLight, samples[idx].distance - minLengthLight });
+		};
+
+		//the rays of a hit are traced back to back, the 4 corners first: when they agree the hit is fully lit or fully in the umbra
+		//and the rest isn't traced, that misses occluders thinner than a stratum but most hits aren't in a penumbra at all
+		const std::array<int, 4> corners{ 0, gridSize - 1, nrOfSamples - gridSize, nrOfSamples - 1 };
+		bool cornersTested{};
+		if (gridSize >= 3 && std::all_of(corners.begin(), corners.end(), [&](int idx) { return isLit[idx]; }))
+		{
+			cornersTested = true;
+			int nrOfBlockedCorners{};
+			for (const int idx : corners)
+			{
+				if (isBlocked(idx))
+				{
+					isLit[idx] = false;
+					++nrOfBlockedCorners;
+				}
+			}
+
+			if (nrOfBlockedCorners == static_cast<int>(corners.size()))
+			{
+				nrOfVisible = 0;
+				return nrOfSamples;
+			}
+		}
+
+		const bool isFullyLit{ cornersTested && std::all_of(corners.begin(), corners.end(), [&](int idx) { return isLit[idx]; }) };
+		for (int idx{}; idx < nrOfSamples && !isFullyLit; ++idx)
+		{
+			const bool isCorner{ cornersTested && std::find(corners.begin(), corners.end(), idx) != corners.end() };
+			if (isLit[idx] && !isCorner && isBlocked(idx))
+			{
+				isLit[idx] = false;
+			}
+		}
+	}
+
+	//the lit samples to the front
+	nrOfVisible = 0;
+	for (int idx{}; idx < nrOfSamples; ++idx)
+	{
+		if (isLit[idx])
+		{
+			samples[nrOfVisible++] = samples[idx];
+		}
+	}
+	return nrOfSamples;
 }
 
-void Renderer::RenderPixel(Scene* pScene, uint32_t pixelIndex, float fov, float aspectRatio, const Matrix cameraToWorld, const Vector3 cameraOrigin) const
+template<Renderer::LightingMode lightingMode, bool shadowsEnabled, uint8_t primitives>
+void Renderer::RenderTile(Scene* pScene, uint32_t tileIndex, const Vector3& cameraOrigin)
 {
+	if constexpr (IsHeatmap(lightingMode))
+	{
+		RenderHeatmapTile<lightingMode, shadowsEnabled, primitives>(pScene, tileIndex, cameraOrigin);
+		return;
+	}
+
 	//variables
 	const auto& materials{ pScene->GetMaterials() };
 	const auto& lights{ pScene->GetLights() };
 	const float minLengthLight{ 0.0001f };
 
-	const uint32_t px{ pixelIndex % m_Width }, py{ pixelIndex / m_Width };
-	const float cx{ (2 * ((px + 0.5f) / float(m_Width)) - 1) * aspectRatio * fov };
-	const float cy{ (1 - (2 * ((py + 0.5f) / float(m_Height)))) * fov };
+	const int tileX{ static_cast<int>(tileIndex % m_NrOfTilesX) * m_TileSize };
+	const int tileY{ static_cast<int>(tileIndex / m_NrOfTilesX) * m_TileSize };
+	const int tileWidth{ std::min(m_TileSize, m_Width - tileX) };
+	const int tileHeight{ std::min(m_TileSize, m_Height - tileY) };
+
+	//colors to write to color buffer (default = black)
+	std::array<ColorRGB, m_TileSize * m_TileSize> tileColors{};
 
-	//code
-	Vector3 rayDirection{ cx, cy, 1.f };
-	rayDirection = cameraToWorld.TransformVector(rayDirection);
-	rayDirection.Normalize();
+	//only full shading follows reflections, the debug modes show the directly visible surfaces
+	constexpr bool canReflect{ lightingMode == LightingMode::Combined };
+	const int bounceDepth{ canReflect && m_ReflectionsEnabled ? m_BounceDepth : 0 };
 
-	//color to write to color buffer (default = black)
-	ColorRGB finalColor{};
+	//the camera rays only leave the pixel centers when the frames get averaged
+	const bool isProgressive{ m_ProgressiveEnabled };
 
-	//ray we are casting from camera towards each pixel
-	Ray viewRay{ cameraOrigin, rayDirection };
-	
-	//HitRecord containing more info about potential hit
-	HitRecord closestHit{};
-	pScene->GetClosestHit(viewRay, closestHit);
+	//past a handful of lights every hit only shades a few picked from the light tree
+	const bool useLightTree{ IsUsingLightTree() };
+	//the camera rays' hits were traced before the tiles and shade their reservoir's sample, the reflections still shade as usual
+	const bool isResampling{ canReflect && IsResamplingLights() };
+	//lights skip the hits they don't reach, and without the tree the camera rays' hits only loop over the ones reaching the tile
+	const bool cullLights{ IsCullingLights() };
+	thread_local std::vector<uint32_t> tileLights{};
+	bool useTileLights{ false };
 
-	if (closestHit.didHit)
+	//light samples waiting for their BRDF, reused by every tile this thread renders
+	//every bounce can add a sample per point light and a grid of them per area light to a pixel
+	const int maxGridSize{ isProgressive ? 1 : static_cast<int>(sqrtf(static_cast<float>(m_MaxShadowSamples))) };
+	size_t nrOfLightSamples{ useLightTree ? m_DirectionalLights.size() + m_LightPicksPerHit * maxGridSize * maxGridSize : 0 };
+	for (const Light& light : lights)
 	{
-		const Vector3 movedHitOrigin{ closestHit.origin + closestHit.normal * minLengthLight };
+		if (!useLightTree)
+			nrOfLightSamples += LightUtils::IsAreaLight(light) ? maxGridSize * maxGridSize : 1;
+	}
+	thread_local ShadingQueue shadingQueue{};
+	shadingQueue.Clear(std::min(tileWidth * tileHeight * nrOfLightSamples * (1 + bounceDepth), m_MaxQueuedSamples));
+
+	//reflection rays still to trace, a stack instead of recursion so the depth doesn't grow the call stack
+	thread_local std::vector<BounceRay> rayStack{};
+	rayStack.clear();
+	const bool writeGuides{ m_DenoiserEnabled };
+	//the guides get accumulated along with the colors
+	const float guideWeight{ isProgressive ? 1.f / (m_TileSampleCounts[tileIndex] + 1) : 1.f };
+
+	//every pixel of a tile is at the same sample: its count while accumulating, otherwise the frame
+	const uint32_t sampleIndex{ isProgressive ? m_TileSampleCounts[tileIndex] : m_FrameIndex };
+	Sampler sampler{ m_SamplerType, m_SamplerSeed };
+
+	//counted locally and handed to the thread's counters once per tile
+	[[maybe_unused]] uint64_t nrOfShadowRays{};
+	std::array<uint32_t, m_MaxBounceLimit + 1> nrOfBounceRays{};
+
+	//direct light of one light at a hit, throughput is what's left of the light after the bounces to get here
+	//depth picks the sampler dimensions, 0 = the hit of the camera ray; lightWeight scales the light of a picked one
+	LightSamples areaLightSamples{};
+	const auto shadeLight = [&](const HitRecord& hit, const Vector3& rayDirection, const ColorRGB& throughput, uint32_t localIndex, int depth,
+		uint32_t lightIndex, float lightWeight)
+	{
+		const Light& light{ lights[lightIndex] };
+		if (cullLights && !IsInRange(light, lightIndex, hit.origin))
+		{
+			return;
+		}
 
-		for (const auto& light : lights)
+		if (LightUtils::IsAreaLight(light))
 		{
-			//variables
-			Vector3 directionLight{ LightUtils::GetDirectionToLight(light, closestHit.origin) };
-			const float distance{ directionLight.Normalize() - minLengthLight };
-			const ColorRGB brdfRGB{ materials[closestHit.materialIndex]->Shade(closestHit, directionLight, -rayDirection) };
+			sampler.StartPixel(tileX + localIndex % m_TileSize, tileY + localIndex / m_TileSize, sampleIndex);
+			int nrOfVisible{};
+			const int nrOfSamples{ SampleAreaLight<shadowsEnabled, primitives>(pScene, light, lightIndex, hit, sampler, SampleDimension::GetBounce(depth),
+				areaLightSamples, nrOfVisible, nrOfShadowRays) };
+			const float sampleWeight{ lightWeight / nrOfSamples };
 
-			const float observedArea{ Vector3::Dot(closestHit.normal, directionLight) };
-			if (observedArea <= 0)
+			for (int idx{}; idx < nrOfVisible; ++idx)
 			{
-				continue;
+				const LightUtils::LightSample& sample{ areaLightSamples[idx] };
+				const float observedArea{ Vector3::Dot(hit.normal, sample.direction) };
+				if constexpr (lightingMode == LightingMode::ObservedArea)
+				{
+					tileColors[localIndex] += ColorRGB{ 1.f, 1.f, 1.f } * (observedArea * sampleWeight);
+				}
+				else if constexpr (lightingMode == LightingMode::Radiance)
+				{
+					tileColors[localIndex] += sample.radiance * sampleWeight;
+				}
+				else
+				{
+					ColorRGB weight{ sampleWeight, sampleWeight, sampleWeight };
+					if constexpr (lightingMode == LightingMode::Combined)
+					{
+						weight = sample.radiance * (observedArea * sampleWeight) * throughput;
+					}
+
+					shadingQueue.Push(materials, hit.materialIndex, hit.normal, sample.direction, -rayDirection, weight, localIndex, tileColors.data());
+				}
 			}
+			return;
+		}
+
+		//variables
+		Vector3 directionLight{ LightUtils::GetDirectionToLight(light, hit.origin) };
+		const float distance{ directionLight.Normalize() - minLengthLight };
 
-			const Ray lightRay{ closestHit.origin, directionLight, minLengthLight, distance};
-			if (m_ShadowsEnabled && pScene->DoesHit(lightRay))
+		const float observedArea{ Vector3::Dot(hit.normal, directionLight) };
+		if (observedArea <= 0)
+		{
+			return;
+		}
+
+		if constexpr (shadowsEnabled)
+		{
+			const Ray lightRay{ hit.origin, directionLight, minLengthLight, distance };
+			++nrOfShadowRays;
+			if (pScene->DoesHit<primitives>(lightRay))
 			{
-				continue;
+				return;
 			}
+		}
 
-			switch (m_CurrentLightingMode)
+		if constexpr (lightingMode == LightingMode::ObservedArea)
+		{
+			tileColors[localIndex] += ColorRGB{ 1.f, 1.f, 1.f } * (observedArea * lightWeight);
+		}
+		else if constexpr (lightingMode == LightingMode::Radiance)
+		{
+			tileColors[localIndex] += LightUtils::GetRadiance(light, hit.origin) * lightWeight;
+		}
+		else
+		{
+			//BRDF mode shows the BRDF alone, Combined weighs it with the incoming light
+			ColorRGB weight{ lightWeight, lightWeight, lightWeight };
+			if constexpr (lightingMode == LightingMode::Combined)
 			{
-			case dae::Renderer::LightingMode::ObservedArea:
-				finalColor += ColorRGB{ 1.f, 1.f, 1.f } * observedArea;
-				break;
-			case dae::Renderer::LightingMode::Radiance:
-				finalColor += LightUtils::GetRadiance(light, closestHit.origin);
-				break;
-			case dae::Renderer::LightingMode::BRDF:
-				finalColor += brdfRGB;
-				break;
-			case dae::Renderer::LightingMode::Combined:
-				finalColor += LightUtils::GetRadiance(light, closestHit.origin) * brdfRGB * observedArea;
-				break;
+				weight = LightUtils::GetRadiance(light, hit.origin) * (observedArea * lightWeight) * throughput;
 			}
+
+			shadingQueue.Push(materials, hit.materialIndex, hit.normal, directionLight, -rayDirection, weight, localIndex, tileColors.data());
 		}
-	}
-	viewRay.direction = Vector3::Reflect(viewRay.direction, closestHit.normal);
-	viewRay.origin = closestHit.origin;
+	};
+
+	//direct light at a hit, of every light or of the ones picked from the tree
+	const auto shadeHit = [&](const HitRecord& hit, const Vector3& rayDirection, const ColorRGB& throughput, uint32_t localIndex, int depth)
+	{
+		if (!useLightTree)
+		{
+			if (useTileLights && depth == 0)
+			{
+				for (const uint32_t lightIndex : tileLights)
+				{
+					shadeLight(hit, rayDirection, throughput, localIndex, depth, lightIndex, 1.f);
+				}
+				return;
+			}
 
-	finalColor.MaxToOne();
+			for (uint32_t lightIndex{}; lightIndex < lights.size(); ++lightIndex)
+			{
+				shadeLight(hit, rayDirection, throughput, localIndex, depth, lightIndex, 1.f);
+			}
+			return;
+		}
 
-	m_pBufferPixels[px + (py * m_Width)] = SDL_MapRGB(m_pBuffer->format,
-		static_cast<uint8_t>(finalColor.r * 255),
-		static_cast<uint8_t>(finalColor.g * 255),
-		static_cast<uint8_t>(finalColor.b * 255));
+		for (const uint32_t lightIndex : m_DirectionalLights)
+		{
+			shadeLight(hit, rayDirection, throughput, localIndex, depth, lightIndex, 1.f);
+		}
 
-	const uint8_t* pKeyboardState = SDL_GetKeyboardState(nullptr);
-}
+		//stratified picks, each one's light divided by how likely it was to get picked
+		sampler.StartPixel(tileX + localIndex % m_TileSize, tileY + localIndex / m_TileSize, sampleIndex);
+		std::array<LightTree::Pick, m_LightPicksPerHit> picks{};
+		m_LightTree.Sample(hit.origin, hit.normal, sampler.Get1D(SampleDimension::GetBounce(depth) + SampleDimension::LightPick), m_LightPicksPerHit, picks.data());
+		for (const LightTree::Pick& pick : picks)
+		{
+			if (pick.lightIndex >= 0)
+			{
+				shadeLight(hit, rayDirection, throughput, localIndex, depth, static_cast<uint32_t>(pick.lightIndex), 1.f / (m_LightPicksPerHit * pick.probability));
+			}
+		}
+	};
 
-bool Renderer::SaveBufferToImage() const
-{
-	return SDL_SaveBMP(m_pBuffer, "RayTracing_Buffer.bmp");
-}
+	//direct light of a camera ray's hit from its reservoir, one shadow ray for the point and area lights (plus the directional ones next to the tree)
+	const auto shadeReservoir = [&](const HitRecord& hit, const Vector3& rayDirection, uint32_t localIndex, int pixelIndex)
+	{
+		if (useLightTree)
+		{
+			for (const uint32_t lightIndex : m_DirectionalLights)
+			{
+				shadeLight(hit, rayDirection, ColorRGB{ 1.f, 1.f, 1.f }, localIndex, 0, lightIndex, 1.f);
+			}
+		}
 
-void dae::Renderer::CycleLightingMode()
-{
-	int temp{ static_cast<int>(m_CurrentLightingMode) };
-	m_CurrentLightingMode = static_cast<LightingMode>((++temp) % 4);
+		const LightResampler::Reservoir& reservoir{ m_LightResampler.GetReservoir(pixelIndex) };
+		LightUtils::LightSample sample{};
+		if (reservoir.weight <= 0.f || !LightResampler::SampleLight(lights[reservoir.sample.lightIndex], hit, reservoir.sample, sample))
+		{
+			return;
+		}
+
+		if constexpr (shadowsEnabled)
+		{
+			const Ray lightRay{ hit.origin, sample.direction, minLengthLight, sample.distance - minLengthLight };
+			++nrOfShadowRays;
+			if (pScene->DoesHit<primitives>(lightRay))
+			{
+				return;
+			}
+		}
+
+		const ColorRGB weight{ sample.radiance * (Vector3::Dot(hit.normal, sample.direction) * reservoir.weight) };
+		shadingQueue.Push(materials, hit.materialIndex, hit.normal, sample.direction, -rayDirection, weight, localIndex, tileColors.data());
+	};
+
+	//mirror reflection of a hit, dropped once it would carry too little light to see
+	const auto pushReflection = [&](const HitRecord& hit, const Vector3& rayDirection, const ColorRGB& throughput, uint32_t localIndex, int depth)
+	{
+		const Material& material{ materials[hit.materialIndex] };
+		if (depth > bounceDepth || material.mirror <= 0.f)
+		{
+			return;
+		}
+
+		ColorRGB reflectedThroughput{ throughput * BRDF::FresnelFunction_Schlick(hit.normal, -rayDirection, material.f0) * material.mirror };
+		const float maxThroughput{ std::max({ reflectedThroughput.r, reflectedThroughput.g, reflectedThroughput.b }) };
+		if (maxThroughput < m_MinThroughput)
+		{
+			return;
+		}
+
+		//russian roulette, the rays that survive carry the light of the ones that didn't so the average stays the same
+		if (depth >= m_RouletteDepth && maxThroughput < 1.f)
+		{
+			sampler.StartPixel(tileX + localIndex % m_TileSize, tileY + localIndex / m_TileSize, sampleIndex);
+			if (sampler.Get1D(SampleDimension::GetBounce(depth - 1) + SampleDimension::Roulette) >= maxThroughput)
+			{
+				return;
+			}
+			reflectedThroughput *= 1.f / maxThroughput;
+		}
+
+		const Ray reflectedRay{ hit.origin, Vector3::Reflect(rayDirection, hit.normal), minLengthLight };
+		rayStack.push_back(BounceRay{ reflectedRay, reflectedThroughput, localIndex, depth });
+	};
+
+	PerfCounters::PhaseScope perfScope{ PerfCounters::Phase::Intersection };
+
+	//the camera rays of the whole tile get traced before any shading, the depths of their hits bound the lights the tile needs
+	std::array<HitRecord, m_TileSize * m_TileSize> primaryHits{};
+	std::array<Vector3, m_TileSize * m_TileSize> primaryDirections{};
+	float minDepth{ FLT_MAX };
+	float maxDepth{ -FLT_MAX };
+
+	for (int y{}; y < tileHeight; ++y)
+	{
+		for (int x{}; x < tileWidth; ++x)
+		{
+			const uint32_t localIndex{ static_cast<uint32_t>(x + y * m_TileSize) };
+			const int pixelIndex{ (tileX + x) + ((tileY + y) * m_Width) };
+			Vector3 rayDirection{ m_WorldRayDirections[pixelIndex] };
+			if (isProgressive)
+			{
+				sampler.StartPixel(tileX + x, tileY + y, sampleIndex);
+				rayDirection = GetCameraDirection(tileX + x + sampler.Get1D(SampleDimension::PixelX), tileY + y + sampler.Get1D(SampleDimension::PixelY));
+			}
+
+			//ray we are casting from camera towards each pixel
+			const Ray viewRay{ cameraOrigin, rayDirection };
+
+			//HitRecord containing more info about potential hit
+			HitRecord closestHit{};
+			if (isResampling)
+			{
+				closestHit = m_LightResampler.GetSurface(pixelIndex).hit;
+			}
+			else
+			{
+				pScene->GetClosestHit<primitives>(viewRay, closestHit);
+			}
+
+			if (writeGuides)
+			{
+				if (closestHit.didHit)
+					m_Denoiser.SetGuide(pixelIndex, closestHit.normal, closestHit.t, materials[closestHit.materialIndex].color, guideWeight);
+				else
+					m_Denoiser.ClearGuide(pixelIndex, guideWeight);
+			}
+
+			primaryHits[localIndex] = closestHit;
+			primaryDirections[localIndex] = rayDirection;
+			if (closestHit.didHit)
+			{
+				const float depth{ closestHit.t * Vector3::Dot(rayDirection, m_CachedForward) };
+				minDepth = std::min(minDepth, depth);
+				maxDepth = std::max(maxDepth, depth);
+			}
+		}
+	}
+
+	//the tree picks its own lights, the list only helps the loop over all of them
+	useTileLights = cullLights && !useLightTree && minDepth <= maxDepth;
+	if (useTileLights)
+	{
+		CullTileLights(tileIndex, minDepth, maxDepth, cameraOrigin, lights, tileLights);
+	}
+
+	for (int y{}; y < tileHeight; ++y)
+	{
+		for (int x{}; x < tileWidth; ++x)
+		{
+			const uint32_t localIndex{ static_cast<uint32_t>(x + y * m_TileSize) };
+			const HitRecord& closestHit{ primaryHits[localIndex] };
+			if (!closestHit.didHit)
+			{
+				continue;
+			}
+
+			const Vector3& rayDirection{ primaryDirections[localIndex] };
+			if (isResampling)
+			{
+				const int pixelIndex{ (tileX + x) + ((tileY + y) * m_Width) };
+				shadeReservoir(closestHit, rayDirection, localIndex, pixelIndex);
+			}
+			else
+			{
+				shadeHit(closestHit, rayDirection, ColorRGB{ 1.f, 1.f, 1.f }, localIndex, 0);
+			}
+
+			if constexpr (canReflect)
+			{
+				pushReflection(closestHit, rayDirection, ColorRGB{ 1.f, 1.f, 1.f }, localIndex, 1);
+			}
+		}
+	}
+
+	//the reflections of the whole tile, after the primary rays so those stay coherent
+	if constexpr (canReflect)
+	{
+		while (!rayStack.empty())
+		{
+			const BounceRay bounce{ rayStack.back() };
+			rayStack.pop_back();
+			++nrOfBounceRays[bounce.depth];
+
+			HitRecord closestHit{};
+			pScene->GetClosestHit<primitives>(bounce.ray, closestHit);
+			if (!closestHit.didHit)
+			{
+				continue;
+			}
+
+			shadeHit(closestHit, bounce.ray.direction, bounce.throughput, bounce.localIndex, bounce.depth);
+			pushReflection(closestHit, bounce.ray.direction, bounce.throughput, bounce.localIndex, bounce.depth + 1);
+		}
+
+		for (int depth{ 1 }; depth <= bounceDepth; ++depth)
+		{
+			if (nrOfBounceRays[depth] > 0)
+			{
+				m_BounceRayCounts[depth].fetch_add(nrOfBounceRays[depth], std::memory_order_relaxed);
+				RAY_STATS_ADD(reflectionRays, nrOfBounceRays[depth]);
+			}
+		}
+	}
+
+	//shade all light samples of the tile, grouped per material type
+	if constexpr (lightingMode == LightingMode::BRDF || lightingMode == LightingMode::Combined)
+	{
+		perfScope.Switch(PerfCounters::Phase::Shading);
+		shadingQueue.Shade(materials, tileColors.data());
+	}
+
+	RAY_STATS_ADD(primaryRays, tileWidth * tileHeight);
+	RAY_STATS_ADD(shadowRays, nrOfShadowRays);
+
+	if (isProgressive)
+	{
+		AccumulateTile(tileIndex, tileColors);
+		return;
+	}
+
+	for (int y{}; y < tileHeight; ++y)
+	{
+		for (int x{}; x < tileWidth; ++x)
+		{
+			const ColorRGB& finalColor{ tileColors[x + y * m_TileSize] };
+			const int pixelIndex{ (tileX + x) + ((tileY + y) * m_Width) };
+
+			m_HdrRed[pixelIndex] = finalColor.r;
+			m_HdrGreen[pixelIndex] = finalColor.g;
+			m_HdrBlue[pixelIndex] = finalColor.b;
+		}
+	}
+}
+
+template<Renderer::LightingMode lightingMode, bool shadowsEnabled, uint8_t primitives>
+void Renderer::RenderHeatmapTile(Scene* pScene, uint32_t tileIndex, const Vector3& cameraOrigin)
+{
+	const auto& lights{ pScene->GetLights() };
+	const float minLengthLight{ 0.0001f };
+
+	const int tileX{ static_cast<int>(tileIndex % m_NrOfTilesX) * m_TileSize };
+	const int tileY{ static_cast<int>(tileIndex / m_NrOfTilesX) * m_TileSize };
+	const int tileWidth{ std::min(m_TileSize, m_Width - tileX) };
+	const int tileHeight{ std::min(m_TileSize, m_Height - tileY) };
+
+#if defined(RAY_STATS)
+	const RayCounters& counters{ RayStats::GetThreadCounters() };
+#endif
+
+	[[maybe_unused]] uint64_t nrOfShadowRays{};
+	//the area lights and the light tree cast the rays a frame of the shading would
+	Sampler sampler{ m_SamplerType, m_SamplerSeed };
+	LightSamples areaLightSamples{};
+	const bool useLightTree{ IsUsingLightTree() };
+	const bool cullLights{ IsCullingLights() };
+
+	const auto castShadowRays = [&](const HitRecord& hit, uint32_t lightIndex)
+	{
+		const Light& light{ lights[lightIndex] };
+		if (cullLights && !IsInRange(light, lightIndex, hit.origin))
+		{
+			return;
+		}
+
+		if (LightUtils::IsAreaLight(light))
+		{
+			int nrOfVisible{};
+			SampleAreaLight<shadowsEnabled, primitives>(pScene, light, lightIndex, hit, sampler, SampleDimension::GetBounce(0),
+				areaLightSamples, nrOfVisible, nrOfShadowRays);
+			return;
+		}
+
+		Vector3 directionLight{ LightUtils::GetDirectionToLight(light, hit.origin) };
+		const float distance{ directionLight.Normalize() - minLengthLight };
+		if (Vector3::Dot(hit.normal, directionLight) <= 0)
+		{
+			return;
+		}
+
+		const Ray lightRay{ hit.origin, directionLight, minLengthLight, distance };
+		++nrOfShadowRays;
+		pScene->DoesHit<primitives>(lightRay);
+	};
+
+	for (int y{}; y < tileHeight; ++y)
+	{
+		for (int x{}; x < tileWidth; ++x)
+		{
+			const int pixelIndex{ (tileX + x) + ((tileY + y) * m_Width) };
+
+#if defined(RAY_STATS)
+			const RayCounters before{ counters };
+#endif
+			const uint64_t shadowRaysBefore{ nrOfShadowRays };
+			const auto start{ std::chrono::steady_clock::now() };
+
+			const Ray viewRay{ cameraOrigin, m_WorldRayDirections[pixelIndex] };
+			HitRecord closestHit{};
+			pScene->GetClosestHit<primitives>(viewRay, closestHit);
+
+			if (closestHit.didHit && shadowsEnabled)
+			{
+				sampler.StartPixel(tileX + x, tileY + y, m_FrameIndex);
+				if (!useLightTree)
+				{
+					for (uint32_t lightIndex{}; lightIndex < lights.size(); ++lightIndex)
+					{
+						castShadowRays(closestHit, lightIndex);
+					}
+				}
+				else
+				{
+					for (const uint32_t lightIndex : m_DirectionalLights)
+					{
+						castShadowRays(closestHit, lightIndex);
+					}
+
+					std::array<LightTree::Pick, m_LightPicksPerHit> picks{};
+					m_LightTree.Sample(closestHit.origin, closestHit.normal, sampler.Get1D(SampleDimension::GetBounce(0) + SampleDimension::LightPick), m_LightPicksPerHit, picks.data());
+					for (const LightTree::Pick& pick : picks)
+					{
+						if (pick.lightIndex >= 0)
+						{
+							castShadowRays(closestHit, static_cast<uint32_t>(pick.lightIndex));
+						}
+					}
+				}
+			}
+
+			float heat{};
+			if constexpr (lightingMode == LightingMode::TimeHeatmap)
+			{
+				heat = std::chrono::duration<float, std::nano>(std::chrono::steady_clock::now() - start).count();
+			}
+			else if constexpr (lightingMode == LightingMode::ShadowRaysHeatmap)
+			{
+				heat = static_cast<float>(nrOfShadowRays - shadowRaysBefore);
+			}
+#if defined(RAY_STATS)
+			else if constexpr (lightingMode == LightingMode::TestsHeatmap)
+			{
+				heat = static_cast<float>((counters.sphereTests - before.sphereTests) + (counters.planeTests - before.planeTests)
+					+ (counters.triangleTests - before.triangleTests));
+			}
+			else if constexpr (lightingMode == LightingMode::NodesHeatmap)
+			{
+				heat = static_cast<float>(counters.boxTests - before.boxTests);
+			}
+#endif
+			m_HeatValues[pixelIndex] = heat;
+		}
+	}
+
+	RAY_STATS_ADD(primaryRays, tileWidth * tileHeight);
+	RAY_STATS_ADD(shadowRays, nrOfShadowRays);
+}
+
+Vector3 Renderer::GetCameraDirection(float x, float y) const
+{
+	//same mapping as the cached directions, built from the cached camera axes
+	const float cx{ (2 * (x / float(m_Width)) - 1) * m_CachedAspectRatio * m_CachedFovScale };
+	const float cy{ (1 - (2 * (y / float(m_Height)))) * m_CachedFovScale };
+	return (m_CachedRight * cx + m_CachedUp * cy + m_CachedForward).Normalized();
+}
+
+void Renderer::AccumulateTile(uint32_t tileIndex, const std::array<ColorRGB, m_TileSize * m_TileSize>& tileColors)
+{
+	const int tileX{ static_cast<int>(tileIndex % m_NrOfTilesX) * m_TileSize };
+	const int tileY{ static_cast<int>(tileIndex / m_NrOfTilesX) * m_TileSize };
+	const int tileWidth{ std::min(m_TileSize, m_Width - tileX) };
+	const int tileHeight{ std::min(m_TileSize, m_Height - tileY) };
+
+	//every pixel of a tile has the same amount of samples, this one is sample number nrOfSamples
+	const uint32_t nrOfSamples{ m_TileSampleCounts[tileIndex] + 1 };
+	const float weight{ 1.f / nrOfSamples };
+
+	float varianceSum{};
+	float luminanceSum{};
+	for (int y{}; y < tileHeight; ++y)
+	{
+		for (int x{}; x < tileWidth; ++x)
+		{
+			const ColorRGB& color{ tileColors[x + y * m_TileSize] };
+			const int pixelIndex{ (tileX + x) + ((tileY + y) * m_Width) };
+			const float sampleLuminance{ std::min(0.2126f * color.r + 0.7152f * color.g + 0.0722f * color.b, 1.f) };
+
+			//the first sample overwrites whatever an earlier accumulation left, so starting over costs nothing
+			float& red{ m_AccumRed[pixelIndex] };
+			float& green{ m_AccumGreen[pixelIndex] };
+			float& blue{ m_AccumBlue[pixelIndex] };
+			float& luminance{ m_AccumLuminance[pixelIndex] };
+			float& luminanceM2{ m_AccumLuminanceM2[pixelIndex] };
+			float& variance{ m_AccumVariance[pixelIndex] };
+			if (nrOfSamples == 1)
+			{
+				red = color.r;
+				green = color.g;
+				blue = color.b;
+				luminance = sampleLuminance;
+				luminanceM2 = 0.f;
+				//one sample says nothing about its spread, the denoiser looks at the neighbors instead
+				variance = -1.f;
+			}
+			else
+			{
+				red += (color.r - red) * weight;
+				green += (color.g - green) * weight;
+				blue += (color.b - blue) * weight;
+
+				const float previousLuminance{ luminance };
+				luminance += (sampleLuminance - luminance) * weight;
+				luminanceM2 += (sampleLuminance - previousLuminance) * (sampleLuminance - luminance);
+
+				//variance of the pixel's mean = sample variance / samples
+				variance = luminanceM2 / ((nrOfSamples - 1) * float(nrOfSamples));
+				varianceSum += variance;
+			}
+			luminanceSum += luminance;
+
+			m_HdrRed[pixelIndex] = red;
+			m_HdrGreen[pixelIndex] = green;
+			m_HdrBlue[pixelIndex] = blue;
+		}
+	}
+
+	m_TileSampleCounts[tileIndex] = nrOfSamples;
+	m_TileVarianceSums[tileIndex] = varianceSum;
+	m_TileLuminanceSums[tileIndex] = luminanceSum;
+}
+
+void Renderer::ResetAccumulation()
+{
+	m_NrOfAccumulatedFrames = 0;
+	m_NrOfAccumulatedSamples = 0;
+	m_AccumulationFinished = false;
+	m_AccumulationStart = std::chrono::steady_clock::now();
+
+	std::fill(m_TileSampleCounts.begin(), m_TileSampleCounts.end(), 0);
+	std::fill(m_TileVarianceSums.begin(), m_TileVarianceSums.end(), 0.f);
+	std::fill(m_TileLuminanceSums.begin(), m_TileLuminanceSums.end(), 0.f);
+
+	m_ActiveTiles.resize(m_NrOfTiles);
+	std::iota(m_ActiveTiles.begin(), m_ActiveTiles.end(), 0);
+}
+
+void Renderer::UpdateActiveTiles()
+{
+	for (const uint32_t tileIndex : m_ActiveTiles)
+	{
+		m_NrOfFrameSamples += GetTilePixelCount(tileIndex);
+	}
+	m_NrOfAccumulatedSamples += m_NrOfFrameSamples;
+
+	if (!m_AdaptiveSamplingEnabled)
+	{
+		return;
+	}
+
+	const float noise{ EstimateNoise() };
+	const float elapsedSeconds{ std::chrono::duration<float>(std::chrono::steady_clock::now() - m_AccumulationStart).count() };
+
+	//a tile's error is measured against the brightness of the whole image, like the global one
+	//so once every tile is under the threshold the image is too, and dark tiles don't need more samples than bright ones
+	const double averageLuminance{ std::accumulate(m_TileLuminanceSums.begin(), m_TileLuminanceSums.end(), 0.0) / (m_Width * m_Height) };
+	const float maxTileVariance{ Square(m_TileErrorThreshold * static_cast<float>(averageLuminance)) };
+	std::erase_if(m_ActiveTiles, [&](uint32_t tileIndex)
+	{
+		return m_TileSampleCounts[tileIndex] >= m_MinAdaptiveSamples
+			&& m_TileVarianceSums[tileIndex] / GetTilePixelCount(tileIndex) <= maxTileVariance;
+	});
+
+	const char* reason{};
+	if (m_ActiveTiles.empty())
+		reason = "every tile converged";
+	else if (m_NrOfAccumulatedFrames >= m_MinAdaptiveSamples && noise <= m_ErrorTarget)
+		reason = "error target reached";
+	else if (m_TimeBudget > 0.f && elapsedSeconds >= m_TimeBudget)
+		reason = "time budget used up";
+
+	if (reason)
+	{
+		m_AccumulationFinished = true;
+		std::cout << "**ADAPTIVE SAMPLING DONE** " << reason << ": " << GetSamplesPerPixel() << " samples/pixel, noise " << noise * 100.f
+			<< "% after " << elapsedSeconds << " s\n";
+	}
+}
+
+uint32_t Renderer::GetTilePixelCount(uint32_t tileIndex) const
+{
+	const int tileX{ static_cast<int>(tileIndex % m_NrOfTilesX) * m_TileSize };
+	const int tileY{ static_cast<int>(tileIndex / m_NrOfTilesX) * m_TileSize };
+	return static_cast<uint32_t>(std::min(m_TileSize, m_Width - tileX) * std::min(m_TileSize, m_Height - tileY));
+}
+
+void Renderer::ToggleProgressive()
+{
+	m_ProgressiveEnabled = !m_ProgressiveEnabled;
+
+	//the next frame starts over whatever it renders
+	m_AccumulationKey = 0;
+	m_NrOfAccumulatedFrames = 0;
+	m_NrOfAccumulatedSamples = 0;
+}
+
+void Renderer::ToggleAdaptiveSampling()
+{
+	m_AdaptiveSamplingEnabled = !m_AdaptiveSamplingEnabled;
+
+	//without it every tile gets samples again, the ones so far stay
+	if (!m_AdaptiveSamplingEnabled && !m_TileSampleCounts.empty())
+	{
+		m_AccumulationFinished = false;
+		m_ActiveTiles.resize(m_NrOfTiles);
+		std::iota(m_ActiveTiles.begin(), m_ActiveTiles.end(), 0);
+	}
+}
+
+void Renderer::SetAdaptiveTargets(float tileError, float errorTarget, float timeBudget)
+{
+	m_TileErrorThreshold = tileError;
+	m_ErrorTarget = errorTarget;
+	m_TimeBudget = timeBudget;
+}
+
+float Renderer::GetSamplesPerPixel() const
+{
+	return m_Width * m_Height > 0 ? static_cast<float>(double(m_NrOfAccumulatedSamples) / (m_Width * m_Height)) : 0.f;
+}
+
+float Renderer::EstimateNoise() const
+{
+	if (m_NrOfAccumulatedFrames < 2)
+	{
+		return 0.f;
+	}
+
+	const double variance{ std::accumulate(m_TileVarianceSums.begin(), m_TileVarianceSums.end(), 0.0) };
+	const double luminance{ std::accumulate(m_TileLuminanceSums.begin(), m_TileLuminanceSums.end(), 0.0) };
+
+	//relative to the average brightness, dividing per pixel would let the black pixels decide
+	return luminance > 0.0 ? static_cast<float>(std::sqrt(variance / (m_Width * m_Height)) / (luminance / (m_Width * m_Height))) : 0.f;
+}
+
+void Renderer::ToggleSampleHeatmap()
+{
+	m_ShowSampleHeatmap = !m_ShowSampleHeatmap;
+	m_PrintHeatmapLegend = m_ShowSampleHeatmap;
+
+	//converged tiles aren't rendered again, so they need their image back
+	if (!m_ShowSampleHeatmap && m_ProgressiveEnabled)
+	{
+		RestoreAccumulatedImage();
+	}
+}
+
+bool Renderer::SaveSampleHeatmap(const char* filePath)
+{
+	if (!m_ProgressiveEnabled)
+	{
+		std::cout << "The sample heatmap needs the progressive mode\n";
+		return true;
+	}
+
+	ColorSampleHeatmap();
+	m_pThreadPool->ParallelFor(m_NrOfTiles, [&](uint32_t idx, int) { ResolveTile(idx); });
+	const bool failed{ SDL_SaveBMP(m_pBuffer, filePath) != 0 };
+
+	if (!m_ShowSampleHeatmap)
+	{
+		RestoreAccumulatedImage();
+	}
+	m_pThreadPool->ParallelFor(m_NrOfTiles, [&](uint32_t idx, int) { ResolveTile(idx); });
+	return failed;
+}
+
+void Renderer::RestoreAccumulatedImage()
+{
+	std::copy(m_AccumRed.begin(), m_AccumRed.end(), m_HdrRed.begin());
+	std::copy(m_AccumGreen.begin(), m_AccumGreen.end(), m_HdrGreen.begin());
+	std::copy(m_AccumBlue.begin(), m_AccumBlue.end(), m_HdrBlue.begin());
+}
+
+uint64_t Renderer::GetImageKey(const Scene* pScene) const
+{
+	const uint64_t settings{ static_cast<uint64_t>(m_CurrentLightingMode) | (uint64_t(m_ShadowsEnabled) << 8) | (uint64_t(m_ReflectionsEnabled) << 9)
+		| (uint64_t(m_BounceDepth) << 10) | (uint64_t(m_SamplerType) << 14) | (uint64_t(m_Width) << 16) | (uint64_t(m_Height) << 40)
+		| (uint64_t(m_LightResamplingEnabled) << 62) | (uint64_t(m_LightTreeEnabled) << 63) };
+	const uint64_t lightCutoff{ IsCullingLights() ? std::bit_cast<uint32_t>(m_LightCutoff) : 0u };
+	return pScene->GetStateHash() ^ (settings * 0x9E3779B97F4A7C15ull) ^ (lightCutoff * 0xC2B2AE3D27D4EB4Full) ^ m_SamplerSeed;
+}
+
+void Renderer::ToggleDenoiser()
+{
+	m_DenoiserEnabled = !m_DenoiserEnabled;
+	m_DenoiseKey = 0;
+	m_DenoiseMilliseconds = 0.f;
+
+	//the retired tiles of an accumulation aren't rendered again, their unfiltered means have to come back by themselves
+	if (!m_DenoiserEnabled && m_ProgressiveEnabled)
+	{
+		RestoreAccumulatedImage();
+	}
+}
+
+void Renderer::Denoise(ThreadPool* pThreadPool, bool isAccumulating, uint64_t imageKey)
+{
+	TRACE_SCOPE("Denoise");
+	const auto start{ std::chrono::steady_clock::now() };
+
+	//the accumulated means are the input when there are any, the HDR planes may hold an earlier frame's filtered tiles
+	//those already average the frames, so the temporal stage would only add lag
+	const Denoiser::ConstPlanes input{ isAccumulating
+		? Denoiser::ConstPlanes{ m_AccumRed.data(), m_AccumGreen.data(), m_AccumBlue.data() }
+		: Denoiser::ConstPlanes{ m_HdrRed.data(), m_HdrGreen.data(), m_HdrBlue.data() } };
+	const bool temporal{ m_TemporalDenoisingEnabled && !isAccumulating };
+
+	m_Denoiser.Denoise(pThreadPool, input, isAccumulating ? m_AccumVariance.data() : nullptr, Denoiser::Planes{ m_HdrRed.data(), m_HdrGreen.data(), m_HdrBlue.data() }, temporal, imageKey != m_DenoiseKey);
+	m_DenoiseKey = imageKey;
+
+	m_DenoiseMilliseconds = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void Renderer::ColorSampleHeatmap()
+{
+	const uint32_t maxSamples{ m_TileSampleCounts.empty() ? 0 : *std::max_element(m_TileSampleCounts.begin(), m_TileSampleCounts.end()) };
+	const float scale{ maxSamples > 0 ? 1.f / maxSamples : 0.f };
+
+	for (uint32_t tileIndex{}; tileIndex < m_NrOfTiles; ++tileIndex)
+	{
+		const int tileX{ static_cast<int>(tileIndex % m_NrOfTilesX) * m_TileSize };
+		const int tileY{ static_cast<int>(tileIndex / m_NrOfTilesX) * m_TileSize };
+		const int tileWidth{ std::min(m_TileSize, m_Width - tileX) };
+		const int tileHeight{ std::min(m_TileSize, m_Height - tileY) };
+
+		const ColorRGB color{ GetHeatColor(m_TileSampleCounts[tileIndex] * scale) };
+		for (int y{ tileY }; y < tileY + tileHeight; ++y)
+		{
+			for (int x{ tileX }; x < tileX + tileWidth; ++x)
+			{
+				m_HdrRed[x + y * m_Width] = color.r;
+				m_HdrGreen[x + y * m_Width] = color.g;
+				m_HdrBlue[x + y * m_Width] = color.b;
+			}
+		}
+	}
+
+	if (m_PrintHeatmapLegend)
+	{
+		m_PrintHeatmapLegend = false;
+		std::cout << "**SAMPLE HEATMAP** samples per pixel: black 0 | blue " << maxSamples * .25f << " | green " << maxSamples * .5f
+			<< " | yellow " << maxSamples * .75f << " | red " << maxSamples << "\n";
+	}
+}
+
+ColorRGB Renderer::GetHeatColor(float heat)
+{
+	//black > blue > green > yellow > red
+	constexpr std::array<ColorRGB, 5> stops{ ColorRGB{ 0, 0, 0 }, ColorRGB{ 0, 0, 1 }, ColorRGB{ 0, 1, 0 }, ColorRGB{ 1, 1, 0 }, ColorRGB{ 1, 0, 0 } };
+
+	const float position{ std::clamp(heat, 0.f, 1.f) * (stops.size() - 1) };
+	const size_t stop{ std::min(static_cast<size_t>(position), stops.size() - 2) };
+	const float t{ position - stop };
+	return stops[stop] * (1.f - t) + stops[stop + 1] * t;
+}
+
+void Renderer::ColorHeatmap()
+{
+	//scaled to the 99th percentile, a few preempted pixels would otherwise turn the time heatmap black
+	std::vector<float> sortedHeat{ m_HeatValues };
+	const auto percentile{ sortedHeat.begin() + (sortedHeat.size() * 99) / 100 };
+	std::nth_element(sortedHeat.begin(), percentile, sortedHeat.end());
+	const float maxHeat{ *percentile };
+	const float scale{ maxHeat > 0 ? 1.f / maxHeat : 0.f };
+
+	//the colors stay in [0, 1], so the default tone mapping leaves them as they are
+	for (size_t idx{}; idx < m_HeatValues.size(); ++idx)
+	{
+		const ColorRGB color{ GetHeatColor(m_HeatValues[idx] * scale) };
+		m_HdrRed[idx] = color.r;
+		m_HdrGreen[idx] = color.g;
+		m_HdrBlue[idx] = color.b;
+	}
+
+	if (!m_PrintHeatmapLegend)
+	{
+		return;
+	}
+	m_PrintHeatmapLegend = false;
+
+	const char* unit{};
+	switch (m_CurrentLightingMode)
+	{
+	case LightingMode::TestsHeatmap:
+		unit = "intersection tests";
+		break;
+	case LightingMode::NodesHeatmap:
+		unit = "bounding boxes visited";
+		break;
+	case LightingMode::ShadowRaysHeatmap:
+		unit = "shadow rays";
+		break;
+	default:
+		unit = "ns";
+		break;
+	}
+
+	std::cout << "**HEATMAP** " << unit << " per pixel: black 0 | blue " << maxHeat * .25f << " | green " << maxHeat * .5f
+		<< " | yellow " << maxHeat * .75f << " | red " << maxHeat << " or more\n";
+}
+
+void Renderer::ResolveTile(uint32_t tileIndex) const
+{
+	PerfCounters::PhaseScope perfScope{ PerfCounters::Phase::Pack };
+
+	const int tileX{ static_cast<int>(tileIndex % m_NrOfTilesX) * m_TileSize };
+	const int tileY{ static_cast<int>(tileIndex / m_NrOfTilesX) * m_TileSize };
+	const int tileWidth{ std::min(m_TileSize, m_Width - tileX) };
+	const int tileHeight{ std::min(m_TileSize, m_Height - tileY) };
+
+#if defined(MATH_AVX2)
+	const SDL_PixelFormat* pFormat{ m_pBuffer->format };
+	const __m128i redShift{ _mm_cvtsi32_si128(pFormat->Rshift) };
+	const __m128i greenShift{ _mm_cvtsi32_si128(pFormat->Gshift) };
+	const __m128i blueShift{ _mm_cvtsi32_si128(pFormat->Bshift) };
+	const __m256i alpha{ _mm256_set1_epi32(pFormat->Amask) };
+
+	const __m256 exposure{ _mm256_set1_ps(m_Exposure) };
+	const __m256 zero{ _mm256_setzero_ps() };
+	const __m256 one{ _mm256_set1_ps(1.f) };
+
+	const auto toneMap{ [&](__m256 x)
+	{
+		//ACES fit: (x(2.51x + 0.03)) / (x(2.43x + 0.59) + 0.14)
+		const __m256 numerator{ _mm256_mul_ps(x, _mm256_fmadd_ps(x, _mm256_set1_ps(2.51f), _mm256_set1_ps(0.03f))) };
+		const __m256 denominator{ _mm256_fmadd_ps(x, _mm256_fmadd_ps(x, _mm256_set1_ps(2.43f), _mm256_set1_ps(0.59f)), _mm256_set1_ps(0.14f)) };
+		return _mm256_div_ps(numerator, denominator);
+	} };
+
+	const auto toByte{ [&](__m256 x)
+	{
+		x = _mm256_min_ps(_mm256_max_ps(x, zero), one);
+		if (m_SrgbEnabled)
+		{
+			const __m256i lutIndices{ _mm256_cvtps_epi32(_mm256_mul_ps(x, _mm256_set1_ps(float(m_SrgbLutSize - 1)))) };
+			return _mm256_i32gather_epi32(reinterpret_cast<const int*>(m_SrgbLut.data()), lutIndices, sizeof(uint32_t));
+		}
+		return _mm256_cvttps_epi32(_mm256_mul_ps(x, _mm256_set1_ps(255.f)));
+	} };
+#endif
+
+	for (int y{ tileY }; y < tileY + tileHeight; ++y)
+	{
+		int x{ tileX };
+
+#if defined(MATH_AVX2)
+		for (; x + 8 <= tileX + tileWidth; x += 8)
+		{
+			const int pixelIndex{ x + (y * m_Width) };
+			__m256 r{ _mm256_mul_ps(_mm256_loadu_ps(&m_HdrRed[pixelIndex]), exposure) };
+			__m256 g{ _mm256_mul_ps(_mm256_loadu_ps(&m_HdrGreen[pixelIndex]), exposure) };
+			__m256 b{ _mm256_mul_ps(_mm256_loadu_ps(&m_HdrBlue[pixelIndex]), exposure) };
+
+			switch (m_CurrentToneMapping)
+			{
+			case ToneMapping::MaxToOne:
+			{
+				//dividing by 1 keeps colors that fit untouched
+				const __m256 maxValue{ _mm256_max_ps(one, _mm256_max_ps(r, _mm256_max_ps(g, b))) };
+				r = _mm256_div_ps(r, maxValue);
+				g = _mm256_div_ps(g, maxValue);
+				b = _mm256_div_ps(b, maxValue);
+				break;
+			}
+			case ToneMapping::ACES:
+				r = toneMap(r);
+				g = toneMap(g);
+				b = toneMap(b);
+				break;
+			default:
+				break;
+			}
+
+			const __m256i packed{ _mm256_or_si256(_mm256_or_si256(alpha, _mm256_sll_epi32(toByte(r), redShift)),
+				_mm256_or_si256(_mm256_sll_epi32(toByte(g), greenShift), _mm256_sll_epi32(toByte(b), blueShift))) };
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(&m_pBufferPixels[pixelIndex]), packed);
+		}
+#endif
+		//remainder (or everything without AVX2)
+		for (; x < tileX + tileWidth; ++x)
+		{
+			const int pixelIndex{ x + (y * m_Width) };
+			m_pBufferPixels[pixelIndex] = ResolvePixel(ColorRGB{ m_HdrRed[pixelIndex], m_HdrGreen[pixelIndex], m_HdrBlue[pixelIndex] });
+		}
+	}
+}
+
+uint32_t Renderer::ResolvePixel(ColorRGB color) const
+{
+	color *= m_Exposure;
+
+	switch (m_CurrentToneMapping)
+	{
+	case ToneMapping::MaxToOne:
+		color.MaxToOne();
+		break;
+	case ToneMapping::ACES:
+		for (float* pChannel : { &color.r, &color.g, &color.b })
+		{
+			const float x{ *pChannel };
+			*pChannel = (x * (2.51f * x + 0.03f)) / (x * (2.43f * x + 0.59f) + 0.14f);
+		}
+		break;
+	default:
+		break;
+	}
+
+	const auto toByte{ [this](float x)
+	{
+		x = std::clamp(x, 0.f, 1.f);
+		if (m_SrgbEnabled)
+		{
+			return m_SrgbLut[static_cast<int>(x * (m_SrgbLutSize - 1) + 0.5f)];
+		}
+		return static_cast<uint32_t>(x * 255);
+	} };
+
+	const SDL_PixelFormat* pFormat{ m_pBuffer->format };
+	return pFormat->Amask | (toByte(color.r) << pFormat->Rshift) | (toByte(color.g) << pFormat->Gshift) | (toByte(color.b) << pFormat->Bshift);
+}
+
+std::vector<ColorRGB> Renderer::GetHdrImage() const
+{
+	std::vector<ColorRGB> image(m_HdrRed.size());
+	for (size_t idx{}; idx < image.size(); ++idx)
+	{
+		image[idx] = ColorRGB{ m_HdrRed[idx], m_HdrGreen[idx], m_HdrBlue[idx] };
+	}
+	return image;
+}
+
+bool Renderer::SaveBufferToImage(const char* filePath) const
+{
+	return SDL_SaveBMP(m_pBuffer, filePath);
+}
+
+void dae::Renderer::CycleLightingMode()
+{
+	int temp{ static_cast<int>(m_CurrentLightingMode) };
+	m_CurrentLightingMode = static_cast<LightingMode>((++temp) % m_NrOfLightingModes);
+
+#if !defined(RAY_STATS)
+	//nothing counts the tests and boxes
+	if (m_CurrentLightingMode == LightingMode::TestsHeatmap || m_CurrentLightingMode == LightingMode::NodesHeatmap)
+	{
+		m_CurrentLightingMode = LightingMode::ShadowRaysHeatmap;
+	}
+#endif
+
+	m_PrintHeatmapLegend = IsHeatmap(m_CurrentLightingMode);
+}
+
+void Renderer::SetMaxBounces(int maxBounces)
+{
+	m_MaxBounces = std::clamp(maxBounces, 0, m_MaxBounceLimit);
+	m_BounceDepth = m_MaxBounces;
+}
+
+void Renderer::SetMaxShadowSamples(int maxSamples)
+{
+	m_MaxShadowSamples = std::clamp(maxSamples, 1, m_MaxShadowSampleLimit);
+}
+
+int Renderer::GetShadowSampleGridSize(const Light& light, const Vector3& target) const
+{
+	if (m_ProgressiveEnabled)
+	{
+		return 1;
+	}
+
+	const int maxGridSize{ static_cast<int>(sqrtf(static_cast<float>(m_MaxShadowSamples))) };
+	const float nrOfSamples{ LightUtils::GetSolidAngle(light, target) * m_ShadowSamplesPerSteradian };
+	return std::clamp(static_cast<int>(ceilf(sqrtf(nrOfSamples))), 1, maxGridSize);
+}
+
+void Renderer::UpdateLightTree(const Scene* pScene)
+{
+	const uint64_t lightHash{ pScene->GetLightHash() };
+	if (lightHash == m_LightTreeKey)
+	{
+		return;
+	}
+
+	TRACE_SCOPE("BuildLightTree");
+	m_LightTreeKey = lightHash;
+
+	const auto& lights{ pScene->GetLights() };
+	m_LightTree.Build(lights);
+	m_DirectionalLights.clear();
+	for (uint32_t lightIndex{}; lightIndex < lights.size(); ++lightIndex)
+	{
+		if (lights[lightIndex].type == LightType::Directional)
+		{
+			m_DirectionalLights.push_back(lightIndex);
+		}
+	}
+}
+
+void Renderer::UpdateLightRadii(const Scene* pScene)
+{
+	if (!IsCullingLights())
+	{
+		return;
+	}
+
+	const uint64_t lightHash{ pScene->GetLightHash() };
+	if (lightHash == m_LightRadiiKey && m_LightCutoff == m_LightRadiiCutoff)
+	{
+		return;
+	}
+	m_LightRadiiKey = lightHash;
+	m_LightRadiiCutoff = m_LightCutoff;
+
+	//a pixel can lose the light of every culled light at once, so each gets an even share of the cutoff
+	//and together they never drop more than the cutoff, however many lights the scene has
+	const auto& lights{ pScene->GetLights() };
+	const auto nrOfCullableLights{ std::count_if(lights.begin(), lights.end(), [](const Light& light) { return light.type != LightType::Directional; }) };
+	const float lightCutoff{ m_LightCutoff / std::max(static_cast<float>(nrOfCullableLights), 1.f) };
+
+	m_LightRadii.resize(lights.size());
+	for (uint32_t lightIndex{}; lightIndex < lights.size(); ++lightIndex)
+	{
+		m_LightRadii[lightIndex] = LightUtils::GetInfluenceRadius(lights[lightIndex], lightCutoff);
+	}
+}
+
+void Renderer::CullTileLights(uint32_t tileIndex, float minDepth, float maxDepth, const Vector3& cameraOrigin, const std::vector<Light>& lights,
+	std::vector<uint32_t>& tileLights) const
+{
+	tileLights.clear();
+
+	const int tileX{ static_cast<int>(tileIndex % m_NrOfTilesX) * m_TileSize };
+	const int tileY{ static_cast<int>(tileIndex / m_NrOfTilesX) * m_TileSize };
+	const int tileWidth{ std::min(m_TileSize, m_Width - tileX) };
+	const int tileHeight{ std::min(m_TileSize, m_Height - tileY) };
+
+	//the tile's side planes as slopes over the forward axis, the same mapping GetCameraDirection uses
+	const float left{ (2 * (tileX / float(m_Width)) - 1) * m_CachedAspectRatio * m_CachedFovScale };
+	const float right{ (2 * ((tileX + tileWidth) / float(m_Width)) - 1) * m_CachedAspectRatio * m_CachedFovScale };
+	const float top{ (1 - (2 * (tileY / float(m_Height)))) * m_CachedFovScale };
+	const float bottom{ (1 - (2 * ((tileY + tileHeight) / float(m_Height)))) * m_CachedFovScale };
+	//scale of the planes' distances, so they compare to the radii
+	const float leftScale{ 1.f / sqrtf(1 + left * left) };
+	const float rightScale{ 1.f / sqrtf(1 + right * right) };
+	const float topScale{ 1.f / sqrtf(1 + top * top) };
+	const float bottomScale{ 1.f / sqrtf(1 + bottom * bottom) };
+
+	for (uint32_t lightIndex{}; lightIndex < lights.size(); ++lightIndex)
+	{
+		const float radius{ m_LightRadii[lightIndex] };
+		if (radius == FLT_MAX)
+		{
+			tileLights.push_back(lightIndex);
+			continue;
+		}
+
+		//the light's sphere against the slab of the hits' depths, then the four sides; conservative near the frustum's corners
+		const Vector3 toLight{ lights[lightIndex].origin - cameraOrigin };
+		const float z{ Vector3::Dot(toLight, m_CachedForward) };
+		if (z + radius < minDepth || z - radius > maxDepth)
+		{
+			continue;
+		}
+
+		const float x{ Vector3::Dot(toLight, m_CachedRight) };
+		const float y{ Vector3::Dot(toLight, m_CachedUp) };
+		if ((x - left * z) * leftScale < -radius || (right * z - x) * rightScale < -radius
+			|| (y - bottom * z) * bottomScale < -radius || (top * z - y) * topScale < -radius)
+		{
+			continue;
+		}
+
+		tileLights.push_back(lightIndex);
+	}
+}
+
+void Renderer::UpdateBounceDepth()
+{
+	const double budget{ static_cast<double>(m_BounceBudgetPerPixel) * m_Width * m_Height };
+
+	//deepest depth whose rays, with those of every depth before it, fit the budget
+	uint64_t nrOfRays{};
+	int depth{};
+	for (int bounce{ 1 }; bounce <= m_BounceDepth; ++bounce)
+	{
+		nrOfRays += m_BounceRayCounts[bounce].load(std::memory_order_relaxed);
+		if (nrOfRays > budget)
+		{
+			break;
+		}
+		depth = bounce;
+	}
+
+	//every ray reflects once at most, so one level deeper costs at most what the deepest one costs now
+	if (depth == m_BounceDepth && depth < m_MaxBounces)
+	{
+		const uint64_t nextDepthRays{ depth > 0 ? m_BounceRayCounts[depth].load(std::memory_order_relaxed) : static_cast<uint64_t>(m_Width) * m_Height };
+		if (nrOfRays + nextDepthRays <= budget)
+		{
+			++depth;
+		}
+	}
+
+	m_BounceDepth = depth;
+}
+
+void Renderer::CycleSampler()
+{
+	int temp{ static_cast<int>(m_SamplerType) };
+	m_SamplerType = static_cast<SamplerType>((++temp) % NrOfSamplerTypes);
+}
+
+void Renderer::SetThreadCount(int nrOfThreads)
+{
+	m_pThreadPool = std::make_unique<ThreadPool>(nrOfThreads);
+}
+
+void dae::Renderer::CycleToneMapping()
+{
+	int temp{ static_cast<int>(m_CurrentToneMapping) };
+	m_CurrentToneMapping = static_cast<ToneMapping>((++temp) % m_NrOfToneMappings);
 }
@@ -1,14 +1,25 @@
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <cstdint>
 
 //Project includes
 #include "Math.h"
 #include "Matrix.h"
 #include "Material.h"
+#include "RayStats.h"
+#include "Denoiser.h"
+#include "LightResampler.h"
+#include "LightTree.h"
+#include "Sampler.h"
 #include "Scene.h"
+#include "ThreadPool.h"
 #include "Utils.h"
 #include <iostream>
+#include <memory>
+#include <vector>
 
 
 struct SDL_Window;
@@ -17,24 +28,108 @@ struct SDL_Surface;
 namespace dae
 {
 	class Scene;
+	struct Camera;
 
 	class Renderer final
 	{
 	public:
 		Renderer(SDL_Window* pWindow);
-		~Renderer() = default;
+		//headless, renders into a buffer the renderer owns
+		Renderer(int width, int height);
+		~Renderer();
 
 		Renderer(const Renderer&) = delete;
 		Renderer(Renderer&&) noexcept = delete;
 		Renderer& operator=(const Renderer&) = delete;
 		Renderer& operator=(Renderer&&) noexcept = delete;
 
-		void Render(Scene* pScene) const;
-		void RenderPixel(Scene* pScene, uint32_t pixelIndex, float fov, float aspectRatio, const Matrix cameraToWorld, const Vector3 cameraOrigin) const;
-		bool SaveBufferToImage() const;
+		void Render(Scene* pScene);
+		//shows the last rendered frame in the window, no-op for offscreen renderers
+		void Present() const;
+		bool SaveBufferToImage(const char* filePath = "RayTracing_Buffer.bmp") const;
+		//the surface the last frame was resolved into
+		const SDL_Surface* GetBuffer() const { return m_pBuffer; }
+		//the colors the last frame resolved, before exposure and tone mapping
+		std::vector<ColorRGB> GetHdrImage() const;
+
+		int GetWidth() const { return m_Width; }
+		int GetHeight() const { return m_Height; }
+
+		//0 = one thread per hardware thread
+		void SetThreadCount(int nrOfThreads);
+		int GetThreadCount() const { return m_pThreadPool->GetNrOfThreads(); }
 
 		void CycleLightingMode();
 		void ToggleShadows() { m_ShadowsEnabled = !m_ShadowsEnabled; }
+		void CycleToneMapping();
+		void ToggleSrgb() { m_SrgbEnabled = !m_SrgbEnabled; }
+		void SetExposure(float exposure) { m_Exposure = exposure; }
+
+		//mirror reflections of smooth Cook-Torrance surfaces, only in the Combined lighting mode
+		void ToggleReflections() { m_ReflectionsEnabled = !m_ReflectionsEnabled; }
+		void SetMaxBounces(int maxBounces);
+		//bounce rays per pixel a frame may cost, the depth drops below the max when last frame went over it
+		void SetBounceBudget(float raysPerPixel) { m_BounceBudgetPerPixel = raysPerPixel; }
+		int GetBounceDepth() const { return m_BounceDepth; }
+
+		//shadow rays per area light and hit, fewer for lights that cover less of the sky (clamped to m_MaxShadowSampleLimit)
+		//progressive frames take a single one, the accumulation stratifies them over the frames instead
+		void SetMaxShadowSamples(int maxSamples);
+
+		//past m_LightPicksPerHit point and area lights every hit shades that many, importance sampled from a light tree
+		//instead of all of them, so thousands of lights cost about as much as a handful (but add noise)
+		void ToggleLightTree() { m_LightTreeEnabled = !m_LightTreeEnabled; }
+		bool IsLightTreeEnabled() const { return m_LightTreeEnabled; }
+
+		//the camera rays' direct light from a single light sample per pixel, picked out of its own candidates, last frame's and its neighbors'
+		//one shadow ray per pixel however many lights there are, only in the Combined lighting mode and not while accumulating
+		void ToggleLightResampling() { m_LightResamplingEnabled = !m_LightResamplingEnabled; }
+		bool IsLightResampling() const { return m_LightResamplingEnabled; }
+
+		//lights stop where they'd bring less than the cutoff radiance, and every tile only loops over the ones that reach its hits
+		//drops a little light, at most the cutoff per pixel from all culled lights together
+		void ToggleLightCulling() { m_LightCullingEnabled = !m_LightCullingEnabled; }
+		bool IsLightCulling() const { return m_LightCullingEnabled; }
+		void SetLightCutoff(float radiance) { m_LightCutoff = radiance; }
+		float GetLightCutoff() const { return m_LightCutoff; }
+
+		//adds a jittered sample per pixel every frame and shows the mean, starts over when the scene or a setting changes
+		void ToggleProgressive();
+		bool IsProgressive() const { return m_ProgressiveEnabled; }
+		uint32_t GetNrOfAccumulatedFrames() const { return m_NrOfAccumulatedFrames; }
+		float GetSamplesPerPixel() const; //average, adaptive sampling gives every tile its own count
+		uint64_t GetNrOfFrameSamples() const { return m_NrOfFrameSamples; } //pixels the last frame added a sample to
+		//standard error of the accumulated image relative to its brightness (RMS over the pixels), 0 before the second sample
+		float EstimateNoise() const;
+
+		//progressive only: tiles under the error threshold stop getting samples
+		//the accumulation stops when every tile did, the whole image is under the target or the time budget (s, 0 = none) ran out
+		void ToggleAdaptiveSampling();
+		bool IsAdaptiveSampling() const { return m_AdaptiveSamplingEnabled; }
+		void SetAdaptiveTargets(float tileError, float errorTarget, float timeBudget);
+		bool IsAccumulationFinished() const { return m_AccumulationFinished; }
+
+		//where the random numbers of the jitter and the roulette come from, a new sampler or seed starts the accumulation over
+		void CycleSampler();
+		void SetSampler(SamplerType type) { m_SamplerType = type; }
+		SamplerType GetSampler() const { return m_SamplerType; }
+		void SetSamplerSeed(uint32_t seed) { m_SamplerSeed = seed; }
+
+		//samples per tile instead of the image, in the window or saved once
+		void ToggleSampleHeatmap();
+		//true when it failed, like SaveBufferToImage
+		bool SaveSampleHeatmap(const char* filePath);
+
+		//edge-avoiding filter over the HDR planes after every frame, guided by what the camera rays hit
+		void ToggleDenoiser();
+		bool IsDenoising() const { return m_DenoiserEnabled; }
+		//averages the frames of a camera that holds still before filtering, the progressive mode already does that itself
+		void ToggleTemporalDenoising() { m_TemporalDenoisingEnabled = !m_TemporalDenoisingEnabled; }
+		bool IsTemporalDenoising() const { return m_TemporalDenoisingEnabled; }
+		float GetDenoiseTime() const { return m_DenoiseMilliseconds; } //ms the last frame's filter took
+
+		//what the last Render traced, stays zero when RAY_STATS is off
+		const RayCounters& GetFrameCounters() const { return m_FrameCounters; }
 
 	private:
 		enum class LightingMode
@@ -42,18 +137,242 @@ namespace dae
 			ObservedArea, //Lambert Cosine Law
 			Radiance, //Incident Radiance
 			BRDF, //Scattering of the Light
-			Combined //Observed Area * Radiance * BRDF
+			Combined, //Observed Area * Radiance * BRDF
+
+			//cost of every pixel (primary ray + shadow rays), colored relative to the most expensive pixel of the frame
+			TestsHeatmap, //sphere, plane and triangle tests (needs RAY_STATS)
+			NodesHeatmap, //bounding boxes visited (needs RAY_STATS)
+			ShadowRaysHeatmap, //shadow rays cast
+			TimeHeatmap //nanoseconds spent
 		};
+		static constexpr int m_NrOfLightingModes{ 8 };
+
+		static constexpr bool IsHeatmap(LightingMode lightingMode) { return lightingMode >= LightingMode::TestsHeatmap; }
+
+		enum class ToneMapping
+		{
+			Clamp, //every channel clamped to 1
+			MaxToOne, //the whole color scaled down when a channel goes over 1
+			ACES //filmic curve (Narkowicz fit)
+		};
+		static constexpr int m_NrOfToneMappings{ 3 };
+
+		//the screen is rendered in square tiles, the hits of one tile get shaded as one batch
+		static constexpr int m_TileSize{ 16 };
+		//light samples a tile queues before they get shaded, so the batch stays small with any number of lights
+		static constexpr size_t m_MaxQueuedSamples{ m_TileSize * m_TileSize * 32 };
+
+		//a reflection waiting on the per-thread ray stack
+		struct BounceRay
+		{
+			Ray ray{};
+			ColorRGB throughput{};
+			uint32_t localIndex{}; //pixel in the tile it adds its light to
+			int depth{};
+		};
+		static constexpr int m_MaxBounceLimit{ 8 };
+		static constexpr int m_RouletteDepth{ 2 }; //bounces before this one are never cut at random
+		static constexpr float m_MinThroughput{ 0.01f };
+
+		static constexpr int m_MaxShadowSampleLimit{ 64 };
+		static constexpr float m_ShadowSamplesPerSteradian{ 64.f }; //a light covering 1/4 sr gets 16 samples
+		using LightSamples = std::array<LightUtils::LightSample, m_MaxShadowSampleLimit>;
+		static constexpr int m_LightPicksPerHit{ 4 };
+		static_assert(m_LightPicksPerHit <= LightTree::m_MaxPicks);
+
+		//One kernel per lighting mode, shadow toggle and set of primitives in the scene
+		//so none of them has to be checked per pixel or per light
+		template<LightingMode lightingMode, bool shadowsEnabled, uint8_t primitives>
+		void RenderTile(Scene* pScene, uint32_t tileIndex, const Vector3& cameraOrigin);
+
+		//same traversal as RenderTile, but stores what it cost instead of shading
+		template<LightingMode lightingMode, bool shadowsEnabled, uint8_t primitives>
+		void RenderHeatmapTile(Scene* pScene, uint32_t tileIndex, const Vector3& cameraOrigin);
+
+		/**
+		 * \brief Stratified samples of an area light seen from a hit, on a square grid as big as the budget allows for its solid angle
+		 * The grid is shifted by the sampler's light dimensions, so the frames (or samples) move it around inside the strata
+		 * \param nrOfVisible out, the first this many samples aren't in shadow
+		 * \return how many samples were taken, what every visible sample's light gets divided by
+		 */
+		template<bool shadowsEnabled, uint8_t primitives>
+		int SampleAreaLight(const Scene* pScene, const Light& light, uint32_t lightIndex, const HitRecord& hit, Sampler& sampler, uint32_t dimension,
+			LightSamples& samples, int& nrOfVisible, uint64_t& nrOfShadowRays) const;
+		//side of the sample grid of an area light
+		int GetShadowSampleGridSize(const Light& light, const Vector3& target) const;
+		//rebuilds the light tree when a light changed
+		void UpdateLightTree(const Scene* pScene);
+		//whether hits shade a few lights picked from the tree instead of all of them
+		bool IsUsingLightTree() const { return m_LightTreeEnabled && m_LightTree.GetNrOfLights() > static_cast<uint32_t>(m_LightPicksPerHit); }
+		bool IsResamplingLights() const { return m_LightResamplingEnabled && !m_ProgressiveEnabled && m_CurrentLightingMode == LightingMode::Combined; }
+		bool IsCullingLights() const { return m_LightCullingEnabled && m_LightCutoff > 0.f; }
+		//redoes the influence radii when a light or the cutoff changed
+		void UpdateLightRadii(const Scene* pScene);
+		//whether a light's influence reaches a point, always for directional lights
+		bool IsInRange(const Light& light, uint32_t lightIndex, const Vector3& target) const
+		{
+			return (light.origin - target).SqrMagnitude() <= m_LightRadii[lightIndex] * m_LightRadii[lightIndex];
+		}
+		/**
+		 * \brief The lights whose influence reaches the part of a tile's frustum between its nearest and farthest hit
+		 * \param minDepth, maxDepth of the tile's hits along the camera's forward axis
+		 */
+		void CullTileLights(uint32_t tileIndex, float minDepth, float maxDepth, const Vector3& cameraOrigin, const std::vector<Light>& lights,
+			std::vector<uint32_t>& tileLights) const;
+
+		//stores what the camera rays of a tile hit, the light resampling needs the surfaces of the whole frame before any tile shades
+		template<uint8_t primitives>
+		void TraceSurfacesTile(Scene* pScene, uint32_t tileIndex, const Vector3& cameraOrigin);
+		using SurfaceKernel = void (Renderer::*)(Scene*, uint32_t, const Vector3&);
+		static SurfaceKernel GetSurfaceKernel(uint8_t primitives);
+		//traces the surfaces and resamples their light, before the tiles get rendered
+		void ResampleLights(ThreadPool* pThreadPool, Scene* pScene, const Vector3& cameraOrigin);
+
+		using TileKernel = void (Renderer::*)(Scene*, uint32_t, const Vector3&);
+		static TileKernel GetTileKernel(LightingMode lightingMode, bool shadowsEnabled, uint8_t primitives);
+
+		void Initialize();
+
+		//exposure, tone mapping, sRGB and packing of the HDR colors of one tile into the surface
+		void ResolveTile(uint32_t tileIndex) const;
+		uint32_t ResolvePixel(ColorRGB color) const;
+
+		//turns the heat values into colors in the HDR planes, prints the legend when the mode was just picked
+		void ColorHeatmap();
+
+		//picks next frame's bounce depth from the rays every depth cost this frame
+		void UpdateBounceDepth();
+		static ColorRGB GetHeatColor(float heat);
+
+		//camera ray through any point of the screen, in pixels
+		Vector3 GetCameraDirection(float x, float y) const;
+		//adds this frame's colors of a tile to their running means, the means are what gets resolved
+		void AccumulateTile(uint32_t tileIndex, const std::array<ColorRGB, m_TileSize * m_TileSize>& tileColors);
+		void ResetAccumulation();
+		//counts the samples of the frame and retires the tiles that converged
+		void UpdateActiveTiles();
+		uint32_t GetTilePixelCount(uint32_t tileIndex) const;
+
+		void ColorSampleHeatmap();
+		void RestoreAccumulatedImage();
+
+		//changes whenever the scene or a setting that changes the image does
+		uint64_t GetImageKey(const Scene* pScene) const;
+		//filters the frame (or the accumulated image) into the HDR planes
+		void Denoise(ThreadPool* pThreadPool, bool isAccumulating, uint64_t imageKey);
 
 		LightingMode m_CurrentLightingMode{ LightingMode::Combined };
 		bool m_ShadowsEnabled{ true };
 
+		ToneMapping m_CurrentToneMapping{ ToneMapping::MaxToOne };
+		float m_Exposure{ 1.f };
+		bool m_SrgbEnabled{ false };
+
 		SDL_Window* m_pWindow{};
 
 		SDL_Surface* m_pBuffer{};
 		uint32_t* m_pBufferPixels{};
+		bool m_OwnsBuffer{};
 
 		int m_Width{};
 		int m_Height{};
+
+		std::unique_ptr<ThreadPool> m_pThreadPool{ std::make_unique<ThreadPool>() };
+
+		RayCounters m_FrameCounters{};
+
+		bool m_ReflectionsEnabled{ true };
+		int m_MaxBounces{ 4 };
+		int m_BounceDepth{ 4 }; //m_MaxBounces unless the budget forced it lower
+		float m_BounceBudgetPerPixel{ 1.f };
+		int m_MaxShadowSamples{ 16 };
+		std::array<std::atomic<uint32_t>, m_MaxBounceLimit + 1> m_BounceRayCounts{};
+		uint32_t m_FrameIndex{};
+
+		LightTree m_LightTree{};
+		uint64_t m_LightTreeKey{}; //hash of the lights the tree was built from
+		bool m_LightTreeEnabled{ true };
+		std::vector<uint32_t> m_DirectionalLights{}; //not in the tree, shaded at every hit
+
+		LightResampler m_LightResampler{};
+		bool m_LightResamplingEnabled{ false };
+		uint64_t m_ResamplingKey{}; //lights and candidate source the resampler's history belongs to
+		uint32_t m_ResampledFrameIndex{ UINT32_MAX }; //last frame that resampled, the history is only good for the next one
+
+		bool m_LightCullingEnabled{ false };
+		float m_LightCutoff{ 1.f / 256.f }; //radiance a pixel may lose to the culled lights, about an 8 bit step at an exposure of 1
+		std::vector<float> m_LightRadii{}; //per light, FLT_MAX for the ones that reach everything
+		uint64_t m_LightRadiiKey{}; //hash of the lights the radii are of
+		float m_LightRadiiCutoff{ -1.f }; //and the cutoff
+
+		SamplerType m_SamplerType{ SamplerType::Sobol };
+		uint32_t m_SamplerSeed{};
+
+		bool m_ProgressiveEnabled{ false };
+		uint32_t m_NrOfAccumulatedFrames{};
+		uint64_t m_NrOfAccumulatedSamples{};
+		uint64_t m_NrOfFrameSamples{};
+		uint64_t m_AccumulationKey{}; //scene state and settings the buffers were accumulated with
+		std::chrono::steady_clock::time_point m_AccumulationStart{};
+
+		bool m_AdaptiveSamplingEnabled{ false };
+		bool m_AccumulationFinished{ false };
+		bool m_ShowSampleHeatmap{ false };
+		static constexpr uint32_t m_MinAdaptiveSamples{ 8 }; //fewer samples say too little about the variance
+		float m_TileErrorThreshold{ .01f };
+		float m_ErrorTarget{ .005f };
+		float m_TimeBudget{ 60.f };
+
+		Denoiser m_Denoiser{};
+		bool m_DenoiserEnabled{ false };
+		bool m_TemporalDenoisingEnabled{ true };
+		uint64_t m_DenoiseKey{}; //image the denoiser's history belongs to
+		float m_DenoiseMilliseconds{};
+
+		//per tile, the sums are over its pixels: variance of the mean and mean luminance
+		std::vector<uint32_t> m_TileSampleCounts{};
+		std::vector<float> m_TileVarianceSums{};
+		std::vector<float> m_TileLuminanceSums{};
+		std::vector<uint32_t> m_ActiveTiles{}; //tiles that still get samples
+
+		//float HDR framebuffer, one plane per channel so the resolve pass loads 8 pixels per register
+		std::vector<float> m_HdrRed{};
+		std::vector<float> m_HdrGreen{};
+		std::vector<float> m_HdrBlue{};
+
+		//running mean per channel, plus the mean and Welford's sum of squared differences of the luminance
+		//the luminance is clamped to 1 like the display does, so a few fireflies don't swamp the noise estimate
+		std::vector<float> m_AccumRed{};
+		std::vector<float> m_AccumGreen{};
+		std::vector<float> m_AccumBlue{};
+		std::vector<float> m_AccumLuminance{};
+		std::vector<float> m_AccumLuminanceM2{};
+		std::vector<float> m_AccumVariance{}; //of the luminance's mean (-1 after one sample), what the denoiser needs to tell noise from detail
+
+		//cost per pixel of the heatmap modes
+		std::vector<float> m_HeatValues{};
+		bool m_PrintHeatmapLegend{};
+
+		//linear [0, 1] > 8 bit sRGB
+		static constexpr int m_SrgbLutSize{ 4096 };
+		std::array<uint32_t, m_SrgbLutSize> m_SrgbLut{};
+
+		uint32_t m_NrOfTiles{};
+		int m_NrOfTilesX{};
+
+		//Camera ray cache
+		//camera space directions only depend on fov + resolution, world space ones on the camera rotation
+		std::vector<Vector3> m_CameraRayDirections{};
+		std::vector<Vector3> m_WorldRayDirections{};
+		float m_CachedFovAngle{ -1.f };
+		float m_CachedFovScale{}; //tan(fov / 2)
+		float m_CachedAspectRatio{};
+		int m_CachedWidth{};
+		int m_CachedHeight{};
+		Vector3 m_CachedRight{};
+		Vector3 m_CachedUp{};
+		Vector3 m_CachedForward{};
+
+		void UpdateRayDirections(const Camera& camera, const Matrix& cameraToWorld);
 	};
 }
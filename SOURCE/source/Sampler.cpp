@@ -0,0 +1,151 @@
+#include "Sampler.h"
+
+//Standard includes
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace dae
+{
+	const char* GetSamplerName(SamplerType type)
+	{
+		switch (type)
+		{
+		case SamplerType::Sobol:
+			return "sobol";
+		case SamplerType::BlueNoise:
+			return "bluenoise";
+		default:
+			return "random";
+		}
+	}
+
+	bool ParseSamplerName(const std::string& name, SamplerType& type)
+	{
+		for (int idx{}; idx < NrOfSamplerTypes; ++idx)
+		{
+			if (name == GetSamplerName(static_cast<SamplerType>(idx)))
+			{
+				type = static_cast<SamplerType>(idx);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	//void-and-cluster (Ulichney 1993): the pixel in the tightest cluster gets removed and the one in the largest void gets filled first
+	static std::array<float, BlueNoiseSize * BlueNoiseSize> GenerateBlueNoiseMask()
+	{
+		constexpr int size{ BlueNoiseSize };
+		constexpr int nrOfPixels{ size * size };
+		constexpr float sigma{ 1.5f };
+
+		//gaussian per wrapped offset, the mask tiles so distances wrap around too
+		std::vector<float> gaussian(nrOfPixels);
+		for (int y{}; y < size; ++y)
+		{
+			for (int x{}; x < size; ++x)
+			{
+				const int dx{ std::min(x, size - x) };
+				const int dy{ std::min(y, size - y) };
+				gaussian[x + y * size] = std::exp(-(dx * dx + dy * dy) / (2.f * sigma * sigma));
+			}
+		}
+
+		std::vector<bool> isSet(nrOfPixels);
+		std::vector<float> energy(nrOfPixels);
+		const auto set = [&](int pixel, bool value)
+		{
+			isSet[pixel] = value;
+			const int px{ pixel % size }, py{ pixel / size };
+			const float sign{ value ? 1.f : -1.f };
+			for (int y{}; y < size; ++y)
+			{
+				const int gy{ ((y - py) & (size - 1)) * size };
+				for (int x{}; x < size; ++x)
+				{
+					energy[x + y * size] += sign * gaussian[((x - px) & (size - 1)) + gy];
+				}
+			}
+		};
+		const auto findTightestCluster = [&]()
+		{
+			int best{ -1 };
+			for (int pixel{}; pixel < nrOfPixels; ++pixel)
+			{
+				if (isSet[pixel] && (best < 0 || energy[pixel] > energy[best]))
+					best = pixel;
+			}
+			return best;
+		};
+		const auto findLargestVoid = [&]()
+		{
+			int best{ -1 };
+			for (int pixel{}; pixel < nrOfPixels; ++pixel)
+			{
+				if (!isSet[pixel] && (best < 0 || energy[pixel] < energy[best]))
+					best = pixel;
+			}
+			return best;
+		};
+
+		//initial pattern: a tenth of the pixels picked by a hash, then spread out until it's stable
+		const int nrOfInitialPixels{ nrOfPixels / 10 };
+		uint32_t state{ 1u };
+		for (int count{}; count < nrOfInitialPixels;)
+		{
+			state = state * 747796405u + 2891336453u;
+			const int pixel{ static_cast<int>((state >> 8) % nrOfPixels) };
+			if (!isSet[pixel])
+			{
+				set(pixel, true);
+				++count;
+			}
+		}
+		while (true)
+		{
+			const int cluster{ findTightestCluster() };
+			set(cluster, false);
+			const int emptiest{ findLargestVoid() };
+			set(emptiest, true);
+			if (emptiest == cluster)
+				break;
+		}
+
+		std::vector<int> ranks(nrOfPixels);
+		const std::vector<bool> initialPattern{ isSet };
+		const std::vector<float> initialEnergy{ energy };
+
+		//phase 1: the initial pixels get their ranks by removing them, tightest cluster first
+		for (int rank{ nrOfInitialPixels - 1 }; rank >= 0; --rank)
+		{
+			const int cluster{ findTightestCluster() };
+			set(cluster, false);
+			ranks[cluster] = rank;
+		}
+
+		//phase 2 and 3: the rest by filling the largest void
+		//(the tightest cluster of the empty pixels in the second half is that same pixel, the energies add up to a constant)
+		isSet = initialPattern;
+		energy = initialEnergy;
+		for (int rank{ nrOfInitialPixels }; rank < nrOfPixels; ++rank)
+		{
+			const int emptiest{ findLargestVoid() };
+			set(emptiest, true);
+			ranks[emptiest] = rank;
+		}
+
+		std::array<float, BlueNoiseSize * BlueNoiseSize> mask{};
+		for (int pixel{}; pixel < nrOfPixels; ++pixel)
+		{
+			mask[pixel] = (ranks[pixel] + .5f) / nrOfPixels;
+		}
+		return mask;
+	}
+
+	const std::array<float, BlueNoiseSize * BlueNoiseSize>& GetBlueNoiseMask()
+	{
+		static const std::array<float, BlueNoiseSize * BlueNoiseSize> mask{ GenerateBlueNoiseMask() };
+		return mask;
+	}
+}
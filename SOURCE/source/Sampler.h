@@ -0,0 +1,222 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <string>
+
+namespace dae
+{
+	enum class SamplerType
+	{
+		Random, //hash per pixel, dimension and sample, no structure at all
+		Sobol, //Owen-scrambled Sobol, every power of two of samples is stratified in every pair of dimensions
+		BlueNoise //tiled void-and-cluster mask, offset per dimension and shifted along the R2 sequence per sample
+	};
+	constexpr int NrOfSamplerTypes{ 3 };
+
+	const char* GetSamplerName(SamplerType type);
+	//false when the name isn't one GetSamplerName gives
+	bool ParseSamplerName(const std::string& name, SamplerType& type);
+
+	//which random number of a pixel's sample is used for what
+	//grouped by four so the pairs that have to be stratified together share a Sobol index
+	namespace SampleDimension
+	{
+		constexpr uint32_t PixelX{ 0 };
+		constexpr uint32_t PixelY{ 1 };
+		//2 and 3 are still free, for a lens or a shutter
+
+		//the dimensions of the hit at this depth, 0 = the one the camera ray found
+		constexpr uint32_t GetBounce(int depth) { return 4 * (depth + 1); }
+		constexpr uint32_t LightU{ 0 };
+		constexpr uint32_t LightV{ 1 };
+		constexpr uint32_t LightPick{ 2 };
+		constexpr uint32_t Roulette{ 3 };
+
+		//the dimensions of a step of the light resampling (its candidates, then the reservoirs it reuses), far past the deepest bounce
+		constexpr uint32_t GetResampling(int step) { return 4 * (64 + step); }
+		constexpr uint32_t Keep{ 3 }; //whether the reservoir keeps the sample, LightU and LightV pick it or a neighbor
+	}
+
+	//64 x 64 ranks in [0, 1), generated once on first use
+	constexpr int BlueNoiseSize{ 64 };
+	const std::array<float, BlueNoiseSize * BlueNoiseSize>& GetBlueNoiseMask();
+
+	//generator matrices of the first four Sobol dimensions (Joe-Kuo direction numbers)
+	constexpr std::array<std::array<uint32_t, 32>, 4> GenerateSobolMatrices()
+	{
+		struct Polynomial { uint32_t degree; uint32_t coefficients; std::array<uint32_t, 3> initial; };
+		constexpr std::array<Polynomial, 3> polynomials{ Polynomial{ 1, 0, { 1, 0, 0 } }, Polynomial{ 2, 1, { 1, 3, 0 } }, Polynomial{ 3, 1, { 1, 3, 1 } } };
+
+		std::array<std::array<uint32_t, 32>, 4> matrices{};
+		for (uint32_t bit{}; bit < 32; ++bit)
+			matrices[0][bit] = 1u << (31 - bit);
+
+		for (uint32_t dimension{ 1 }; dimension < 4; ++dimension)
+		{
+			const Polynomial& polynomial{ polynomials[dimension - 1] };
+			std::array<uint32_t, 32>& directions{ matrices[dimension] };
+			for (uint32_t bit{}; bit < 32; ++bit)
+			{
+				if (bit < polynomial.degree)
+				{
+					directions[bit] = polynomial.initial[bit] << (31 - bit);
+					continue;
+				}
+
+				directions[bit] = directions[bit - polynomial.degree] ^ (directions[bit - polynomial.degree] >> polynomial.degree);
+				for (uint32_t k{ 1 }; k < polynomial.degree; ++k)
+				{
+					if ((polynomial.coefficients >> (polynomial.degree - 1 - k)) & 1)
+						directions[bit] ^= directions[bit - k];
+				}
+			}
+		}
+		return matrices;
+	}
+
+	//the same matrices applied to every byte of the index at once, four lookups instead of a branch per bit
+	constexpr std::array<std::array<std::array<uint32_t, 256>, 4>, 4> GenerateSobolTables()
+	{
+		constexpr std::array<std::array<uint32_t, 32>, 4> matrices{ GenerateSobolMatrices() };
+
+		std::array<std::array<std::array<uint32_t, 256>, 4>, 4> tables{};
+		for (size_t dimension{}; dimension < 4; ++dimension)
+		{
+			for (size_t byte{}; byte < 4; ++byte)
+			{
+				for (uint32_t value{}; value < 256; ++value)
+				{
+					uint32_t bits{};
+					for (uint32_t bit{}; bit < 8; ++bit)
+					{
+						if ((value >> bit) & 1)
+							bits ^= matrices[dimension][byte * 8 + bit];
+					}
+					tables[dimension][byte][value] = bits;
+				}
+			}
+		}
+		return tables;
+	}
+	inline constexpr std::array<std::array<std::array<uint32_t, 256>, 4>, 4> SobolTables{ GenerateSobolTables() };
+
+	//state of one pixel's sample, small enough to live on the stack of whichever thread renders the pixel
+	//the numbers only depend on the pixel, sample, dimension and seed, never on the thread or the order they're asked in
+	class Sampler final
+	{
+	public:
+		explicit Sampler(SamplerType type, uint32_t seed = 0) :
+			m_Type{ type },
+			m_Seed{ seed },
+			m_pBlueNoise{ type == SamplerType::BlueNoise ? GetBlueNoiseMask().data() : nullptr }
+		{
+		}
+
+		//cheap to call again for the same pixel, so the reflections of a tile can switch between pixels
+		void StartPixel(int px, int py, uint32_t sampleIndex)
+		{
+			if (px == m_PixelX && py == m_PixelY && sampleIndex == m_SampleIndex)
+				return;
+
+			m_PixelX = px;
+			m_PixelY = py;
+			m_SampleIndex = sampleIndex;
+			m_PixelSeed = Hash(static_cast<uint32_t>(px) * 0x8da6b343u ^ static_cast<uint32_t>(py) * 0xd8163841u ^ m_Seed * 0xcb1ab31fu);
+			m_Group = UINT32_MAX;
+		}
+
+		//[0, 1)
+		float Get1D(uint32_t dimension)
+		{
+			switch (m_Type)
+			{
+			case SamplerType::Sobol:
+				return GetSobol(dimension);
+			case SamplerType::BlueNoise:
+				return GetBlueNoise(dimension);
+			default:
+				return ToFloat(Hash(m_PixelSeed ^ Hash(dimension * 0x9e3779b9u ^ Hash(m_SampleIndex))));
+			}
+		}
+
+	private:
+		SamplerType m_Type;
+		uint32_t m_Seed;
+		const float* m_pBlueNoise;
+
+		int m_PixelX{ -1 };
+		int m_PixelY{ -1 };
+		uint32_t m_SampleIndex{};
+		uint32_t m_PixelSeed{};
+
+		//the shuffled Sobol index of the last group of four dimensions
+		uint32_t m_Group{ UINT32_MAX };
+		uint32_t m_ShuffledIndex{};
+
+		static float ToFloat(uint32_t bits) { return (bits >> 8) * (1.f / 16777216.f); }
+
+		//PCG output permutation
+		static uint32_t Hash(uint32_t value)
+		{
+			const uint32_t state{ value * 747796405u + 2891336453u };
+			const uint32_t word{ ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u };
+			return (word >> 22u) ^ word;
+		}
+
+		static uint32_t HashCombine(uint32_t seed, uint32_t value)
+		{
+			return seed ^ (Hash(value) + 0x9e3779b9u + (seed << 6) + (seed >> 2));
+		}
+
+		static uint32_t ReverseBits(uint32_t x)
+		{
+			x = ((x >> 1) & 0x55555555u) | ((x & 0x55555555u) << 1);
+			x = ((x >> 2) & 0x33333333u) | ((x & 0x33333333u) << 2);
+			x = ((x >> 4) & 0x0f0f0f0fu) | ((x & 0x0f0f0f0fu) << 4);
+			x = ((x >> 8) & 0x00ff00ffu) | ((x & 0x00ff00ffu) << 8);
+			return (x >> 16) | (x << 16);
+		}
+
+		//Owen scrambling as a hash on reversed bits (Burley 2020, Laine-Karras permutation)
+		static uint32_t NestedUniformScramble(uint32_t x, uint32_t seed)
+		{
+			x = ReverseBits(x);
+			x += seed;
+			x ^= x * 0x6c50b47cu;
+			x ^= x * 0xb82f1e52u;
+			x ^= x * 0xc7afe638u;
+			x ^= x * 0x8d22f6e6u;
+			return ReverseBits(x);
+		}
+
+		float GetSobol(uint32_t dimension)
+		{
+			//every group of four dimensions shuffles the sample order its own way, which decorrelates the groups (padding)
+			const uint32_t group{ dimension / 4 };
+			if (group != m_Group)
+			{
+				m_Group = group;
+				m_ShuffledIndex = NestedUniformScramble(m_SampleIndex, HashCombine(m_PixelSeed, group));
+			}
+
+			const std::array<std::array<uint32_t, 256>, 4>& table{ SobolTables[dimension % 4] };
+			const uint32_t bits{ table[0][m_ShuffledIndex & 0xff] ^ table[1][(m_ShuffledIndex >> 8) & 0xff]
+				^ table[2][(m_ShuffledIndex >> 16) & 0xff] ^ table[3][m_ShuffledIndex >> 24] };
+			return ToFloat(NestedUniformScramble(bits, HashCombine(m_PixelSeed, dimension + 0x51ed27u)));
+		}
+
+		float GetBlueNoise(uint32_t dimension)
+		{
+			//a different part of the mask per dimension, so the dimensions of a pixel don't correlate
+			const uint32_t offset{ Hash(dimension ^ m_Seed * 0x27d4eb2fu) };
+			const int x{ (m_PixelX + static_cast<int>(offset & 0xffff)) & (BlueNoiseSize - 1) };
+			const int y{ (m_PixelY + static_cast<int>(offset >> 16)) & (BlueNoiseSize - 1) };
+
+			//the R2 sequence (plastic number) keeps the samples of one pixel spread out over time, in both dimensions of a pair
+			//one step per dimension would put the pairs on a line, in 0.32 fixed point so it wraps by itself
+			constexpr std::array<uint32_t, 2> steps{ 3242174889u, 2447445413u };
+			const uint32_t rank{ static_cast<uint32_t>(m_pBlueNoise[x + y * BlueNoiseSize] * 16777216.f) << 8 };
+			return ToFloat(rank + m_SampleIndex * steps[dimension & 1]);
+		}
+	};
+}
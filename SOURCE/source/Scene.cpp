@@ -1,13 +1,14 @@
 #include "Scene.h"
 #include "Utils.h"
 #include "Material.h"
+#include "RayStats.h"
 
 namespace dae {
 
 #pragma region Base Scene
 	//Initialize Scene with Default Solid Color Material (RED)
 	Scene::Scene():
-		m_Materials({ new Material_SolidColor({1,0,0})})
+		m_Materials({ Material::CreateSolidColor({1,0,0}) })
 	{
 		m_SphereGeometries.reserve(32);
 		m_PlaneGeometries.reserve(32);
@@ -15,97 +16,222 @@ namespace dae {
 		m_Lights.reserve(32);
 	}
 
-	Scene::~Scene()
+	Scene::~Scene() = default;
+
+	void Scene::GetClosestHit(const Ray& ray, HitRecord& closestHit) const
 	{
-		for(auto& pMaterial : m_Materials)
-		{
-			delete pMaterial;
-			pMaterial = nullptr;
-		}
+		GetClosestHit<Primitives::All>(ray, closestHit);
+	}
 
-		m_Materials.clear();
+	bool Scene::DoesHit(const Ray& ray) const
+	{
+		return DoesHit<Primitives::All>(ray);
 	}
 
-	void dae::Scene::GetClosestHit(const Ray& ray, HitRecord& closestHit) const
+	template<uint8_t primitives>
+	void Scene::GetClosestHit(const Ray& ray, HitRecord& closestHit) const
 	{
 		HitRecord currentHit{};
 		Ray workingRay{ ray };
 		float t{ ray.max };
 
-		for (auto& sphere : m_SphereGeometries)
+		if constexpr ((primitives & Primitives::Spheres) != 0)
 		{
-			GeometryUtils::HitTest_Sphere(sphere, ray, currentHit);
-			if (currentHit.didHit)
+			RAY_STATS_ADD(sphereTests, m_SphereGeometries.size());
+			for (auto& sphere : m_SphereGeometries)
 			{
-				//if new hit is closer than current closer hit than store current hit in closerHit
-				if (currentHit.t < closestHit.t)
+				//didHit sticks once set, so the hit count goes by what the test returns
+				const bool didHit{ GeometryUtils::HitTest_Sphere(sphere, ray, currentHit) };
+				RAY_STATS_ADD(hits, didHit);
+				if (currentHit.didHit)
 				{
-					closestHit = currentHit;
-					t = currentHit.t;
-					workingRay.max = t;
+					//if new hit is closer than current closer hit than store current hit in closerHit
+					if (currentHit.t < closestHit.t)
+					{
+						closestHit = currentHit;
+						t = currentHit.t;
+						workingRay.max = t;
+					}
 				}
 			}
 		}
 
-		for (auto& plane : m_PlaneGeometries)
+		if constexpr ((primitives & Primitives::Planes) != 0)
 		{
-			GeometryUtils::HitTest_Plane(plane, ray, currentHit);
-			if (currentHit.didHit)
+			RAY_STATS_ADD(planeTests, m_PlaneGeometries.size());
+			for (auto& plane : m_PlaneGeometries)
 			{
-				//if new hit is closer than current closer hit than store current hit in closerHit
-				if (currentHit.t < closestHit.t)
+				const bool didHit{ GeometryUtils::HitTest_Plane(plane, ray, currentHit) };
+				RAY_STATS_ADD(hits, didHit);
+				if (currentHit.didHit)
 				{
-					closestHit = currentHit;
-					t = currentHit.t;
-					workingRay.max = t;
+					//if new hit is closer than current closer hit than store current hit in closerHit
+					if (currentHit.t < closestHit.t)
+					{
+						closestHit = currentHit;
+						t = currentHit.t;
+						workingRay.max = t;
+					}
 				}
 			}
 		}
 
-		for (auto& triangleMesh : m_TriangleMeshGeometries)
+		if constexpr ((primitives & Primitives::Meshes) != 0)
 		{
-			GeometryUtils::HitTest_TriangleMesh(triangleMesh, ray, currentHit);
-			if (currentHit.didHit)
+			for (auto& triangleMesh : m_TriangleMeshGeometries)
 			{
-				//if new hit is closer than current closer hit than store current hit in closerHit
-				if (currentHit.t < closestHit.t)
+				GeometryUtils::HitTest_TriangleMesh(triangleMesh, ray, currentHit);
+				if (currentHit.didHit)
 				{
-					closestHit = currentHit;
-					t = currentHit.t;
-					workingRay.max = t;
+					//if new hit is closer than current closer hit than store current hit in closerHit
+					if (currentHit.t < closestHit.t)
+					{
+						closestHit = currentHit;
+						t = currentHit.t;
+						workingRay.max = t;
+					}
 				}
 			}
 		}
 	}
 
+	template<uint8_t primitives>
 	bool Scene::DoesHit(const Ray& ray) const
 	{
-		for (auto& sphere : m_SphereGeometries)
+		if constexpr ((primitives & Primitives::Spheres) != 0)
 		{
-			if (GeometryUtils::HitTest_Sphere(sphere, ray))
+			for (size_t idx{}; idx < m_SphereGeometries.size(); ++idx)
 			{
-				return true;
+				if (GeometryUtils::HitTest_Sphere(m_SphereGeometries[idx], ray))
+				{
+					RAY_STATS_ADD(sphereTests, idx + 1);
+					RAY_STATS_ADD(hits, 1);
+					RAY_STATS_ADD(earlyOuts, 1);
+					return true;
+				}
 			}
+			RAY_STATS_ADD(sphereTests, m_SphereGeometries.size());
 		}
 
-		for (auto& plane : m_PlaneGeometries)
+		if constexpr ((primitives & Primitives::Planes) != 0)
 		{
-			if (GeometryUtils::HitTest_Plane(plane, ray))
+			for (size_t idx{}; idx < m_PlaneGeometries.size(); ++idx)
 			{
-				return true;
+				if (GeometryUtils::HitTest_Plane(m_PlaneGeometries[idx], ray))
+				{
+					RAY_STATS_ADD(planeTests, idx + 1);
+					RAY_STATS_ADD(hits, 1);
+					RAY_STATS_ADD(earlyOuts, 1);
+					return true;
+				}
 			}
+			RAY_STATS_ADD(planeTests, m_PlaneGeometries.size());
 		}
 
-		for (auto& triangleMesh : m_TriangleMeshGeometries)
+		if constexpr ((primitives & Primitives::Meshes) != 0)
 		{
-			if (GeometryUtils::HitTest_TriangleMesh(triangleMesh, ray))
+			for (auto& triangleMesh : m_TriangleMeshGeometries)
 			{
-				return true;
+				if (GeometryUtils::HitTest_TriangleMesh(triangleMesh, ray))
+				{
+					return true;
+				}
 			}
 		}
 		return false;
 	}
 
+	//every primitive combination the render kernels can ask for
+#define INSTANTIATE_HIT_TESTS(primitives) \
+	template void Scene::GetClosestHit<primitives>(const Ray& ray, HitRecord& closestHit) const; \
+	template bool Scene::DoesHit<primitives>(const Ray& ray) const;
+
+	INSTANTIATE_HIT_TESTS(0)
+	INSTANTIATE_HIT_TESTS(1)
+	INSTANTIATE_HIT_TESTS(2)
+	INSTANTIATE_HIT_TESTS(3)
+	INSTANTIATE_HIT_TESTS(4)
+	INSTANTIATE_HIT_TESTS(5)
+	INSTANTIATE_HIT_TESTS(6)
+	INSTANTIATE_HIT_TESTS(7)
+#undef INSTANTIATE_HIT_TESTS
+
+	uint8_t Scene::GetPrimitives() const
+	{
+		uint8_t primitives{};
+		if (!m_SphereGeometries.empty()) primitives |= Primitives::Spheres;
+		if (!m_PlaneGeometries.empty()) primitives |= Primitives::Planes;
+		if (!m_TriangleMeshGeometries.empty()) primitives |= Primitives::Meshes;
+		return primitives;
+	}
+
+	//FNV-1a, the members get hashed one by one so padding never counts
+	static void AddToHash(uint64_t& hash, const void* pData, size_t size)
+	{
+		const unsigned char* pBytes{ static_cast<const unsigned char*>(pData) };
+		for (size_t idx{}; idx < size; ++idx)
+		{
+			hash = (hash ^ pBytes[idx]) * 1099511628211ull;
+		}
+	}
+
+	uint64_t Scene::GetStateHash() const
+	{
+		//every value that changes what a ray sees
+		uint64_t hash{ 14695981039346656037ull };
+		const auto add = [&hash](const void* pData, size_t size) { AddToHash(hash, pData, size); };
+
+		for (const Sphere& sphere : m_SphereGeometries)
+		{
+			add(&sphere.origin, sizeof(Vector3));
+			add(&sphere.radius, sizeof(float));
+			add(&sphere.materialIndex, sizeof(unsigned char));
+		}
+		for (const Plane& plane : m_PlaneGeometries)
+		{
+			add(&plane.origin, sizeof(Vector3));
+			add(&plane.normal, sizeof(Vector3));
+			add(&plane.materialIndex, sizeof(unsigned char));
+		}
+		//the triangles themselves only change through the transforms
+		for (const TriangleMesh& mesh : m_TriangleMeshGeometries)
+		{
+			add(&mesh.rotationTransform, sizeof(Matrix));
+			add(&mesh.translationTransform, sizeof(Matrix));
+			add(&mesh.scaleTransform, sizeof(Matrix));
+			add(&mesh.materialIndex, sizeof(unsigned char));
+		}
+		const uint64_t lightHash{ GetLightHash() };
+		add(&lightHash, sizeof(uint64_t));
+
+		add(&m_Camera.origin, sizeof(Vector3));
+		add(&m_Camera.forward, sizeof(Vector3));
+		add(&m_Camera.fovAngle, sizeof(float));
+
+		const size_t nrOfMaterials{ m_Materials.size() };
+		add(&nrOfMaterials, sizeof(size_t));
+		return hash;
+	}
+
+	uint64_t Scene::GetLightHash() const
+	{
+		uint64_t hash{ 14695981039346656037ull };
+		const auto add = [&hash](const void* pData, size_t size) { AddToHash(hash, pData, size); };
+
+		for (const Light& light : m_Lights)
+		{
+			add(&light.origin, sizeof(Vector3));
+			add(&light.direction, sizeof(Vector3));
+			add(&light.color, sizeof(ColorRGB));
+			add(&light.intensity, sizeof(float));
+			add(&light.type, sizeof(LightType));
+			add(&light.halfWidth, sizeof(Vector3));
+			add(&light.halfHeight, sizeof(Vector3));
+			add(&light.radius, sizeof(float));
+		}
+		return hash;
+	}
+
 #pragma region Scene Helpers
 	Sphere* Scene::AddSphere(const Vector3& origin, float radius, unsigned char materialIndex)
 	{
@@ -163,9 +289,37 @@ namespace dae {
 		return &m_Lights.back();
 	}
 
-	unsigned char Scene::AddMaterial(Material* pMaterial)
+	Light* Scene::AddRectLight(const Vector3& origin, const Vector3& halfWidth, const Vector3& halfHeight, float intensity, const ColorRGB& color)
+	{
+		Light l;
+		l.origin = origin;
+		l.direction = Vector3::Cross(halfWidth, halfHeight).Normalized();
+		l.halfWidth = halfWidth;
+		l.halfHeight = halfHeight;
+		l.intensity = intensity;
+		l.color = color;
+		l.type = LightType::Rect;
+
+		m_Lights.emplace_back(l);
+		return &m_Lights.back();
+	}
+
+	Light* Scene::AddSphereLight(const Vector3& origin, float radius, float intensity, const ColorRGB& color)
+	{
+		Light l;
+		l.origin = origin;
+		l.radius = radius;
+		l.intensity = intensity;
+		l.color = color;
+		l.type = LightType::Sphere;
+
+		m_Lights.emplace_back(l);
+		return &m_Lights.back();
+	}
+
+	unsigned char Scene::AddMaterial(const Material& material)
 	{
-		m_Materials.push_back(pMaterial);
+		m_Materials.push_back(material);
 		return static_cast<unsigned char>(m_Materials.size() - 1);
 	}
 #pragma endregion
@@ -176,11 +330,11 @@ namespace dae {
 	{
 	//			//default: Material id0 >> SolidColor Material (RED)
 	//	constexpr unsigned char matId_Solid_Red = 0;
-	//	const unsigned char matId_Solid_Blue = AddMaterial(new Material_SolidColor{ colors::Blue });
+	//	const unsigned char matId_Solid_Blue = AddMaterial(Material::CreateSolidColor(colors::Blue));
 
-	//	const unsigned char matId_Solid_Yellow = AddMaterial(new Material_SolidColor{ colors::Yellow });
-	//	const unsigned char matId_Solid_Green = AddMaterial(new Material_SolidColor{ colors::Green });
-	//	const unsigned char matId_Solid_Magenta = AddMaterial(new Material_SolidColor{ colors::Magenta });
+	//	const unsigned char matId_Solid_Yellow = AddMaterial(Material::CreateSolidColor(colors::Yellow));
+	//	const unsigned char matId_Solid_Green = AddMaterial(Material::CreateSolidColor(colors::Green));
+	//	const unsigned char matId_Solid_Magenta = AddMaterial(Material::CreateSolidColor(colors::Magenta));
 
 	//	//Spheres
 	//	AddSphere({ -25.f, 0.f, 100.f }, 50.f, matId_Solid_Red);
@@ -202,10 +356,10 @@ namespace dae {
 	//	//default: Material id0 >> SolidColor Material (RED)
 	//	constexpr unsigned char matId_Solid_Red = 0;
 
-	//	const unsigned char matId_Solid_Blue = AddMaterial(new Material_SolidColor{ colors::Blue });
-	//	const unsigned char matId_Solid_Yellow = AddMaterial(new Material_SolidColor{ colors::Yellow });
-	//	const unsigned char matId_Solid_Green = AddMaterial(new Material_SolidColor{ colors::Green });
-	//	const unsigned char matId_Solid_Magenta = AddMaterial(new Material_SolidColor{ colors::Magenta });
+	//	const unsigned char matId_Solid_Blue = AddMaterial(Material::CreateSolidColor(colors::Blue));
+	//	const unsigned char matId_Solid_Yellow = AddMaterial(Material::CreateSolidColor(colors::Yellow));
+	//	const unsigned char matId_Solid_Green = AddMaterial(Material::CreateSolidColor(colors::Green));
+	//	const unsigned char matId_Solid_Magenta = AddMaterial(Material::CreateSolidColor(colors::Magenta));
 
 	//	//Spheres
 	//	AddSphere(Vector3{ -1.75f, 1.f, 0.f }, .75f, matId_Solid_Red);
@@ -233,9 +387,9 @@ namespace dae {
 		//m_Camera.fovAngle = 45.f;
 
 		////default: Material id0 >> SolidColor Material (RED)
-		//const unsigned char matId_Solid_Red = AddMaterial(new Material_Lambert(colors::Red, 1.f));
-		//const auto matId_Solid_Blue = AddMaterial(new Material_LambertPhong( colors::Blue, 1.f, 1.f, 30.f ));
-		//const unsigned char matId_Solid_Yellow = AddMaterial(new Material_Lambert(colors::Yellow, 1.f));
+		//const unsigned char matId_Solid_Red = AddMaterial(Material::CreateLambert(colors::Red, 1.f));
+		//const auto matId_Solid_Blue = AddMaterial(Material::CreateLambertPhong( colors::Blue, 1.f, 1.f, 30.f ));
+		//const unsigned char matId_Solid_Yellow = AddMaterial(Material::CreateLambert(colors::Yellow, 1.f));
 
 		////Spheres
 		//AddSphere({ -.75f, 1.f, .0f }, 1.f, matId_Solid_Red);
@@ -252,15 +406,15 @@ namespace dae {
 		//m_Camera.origin = { 0.f, 3.f, -9.f };
 		//m_Camera.fovAngle = 45.f;
 
-		//const auto matCT_GrayRoughMetal = AddMaterial(new Material_CookTorrence({ .972f, .960f, .915f }, 1.f, 1.f));
-		//const auto matCT_GrayMediumMetal = AddMaterial(new Material_CookTorrence({ .972f, .960f, .915f }, 1.f, .6f));
-		//const auto matCT_GraySmoothMetal = AddMaterial(new Material_CookTorrence({ .972f, .960f, .915f }, 1.f, .1f));
-		//const auto matCT_GrayRoughPlastic = AddMaterial(new Material_CookTorrence({ .75f, .75f, .75f }, .0f, 1.f));
-		//const auto matCT_GrayMediumPlastic = AddMaterial(new Material_CookTorrence({ .75f, .75f, .75f }, .0f, .6f));
-		//const auto matCT_GraySmoothPlastic = AddMaterial(new Material_CookTorrence({ .75f, .75f, .75f }, .0f, .1f));
+		//const auto matCT_GrayRoughMetal = AddMaterial(Material::CreateCookTorrence({ .972f, .960f, .915f }, 1.f, 1.f));
+		//const auto matCT_GrayMediumMetal = AddMaterial(Material::CreateCookTorrence({ .972f, .960f, .915f }, 1.f, .6f));
+		//const auto matCT_GraySmoothMetal = AddMaterial(Material::CreateCookTorrence({ .972f, .960f, .915f }, 1.f, .1f));
+		//const auto matCT_GrayRoughPlastic = AddMaterial(Material::CreateCookTorrence({ .75f, .75f, .75f }, .0f, 1.f));
+		//const auto matCT_GrayMediumPlastic = AddMaterial(Material::CreateCookTorrence({ .75f, .75f, .75f }, .0f, .6f));
+		//const auto matCT_GraySmoothPlastic = AddMaterial(Material::CreateCookTorrence({ .75f, .75f, .75f }, .0f, .1f));
 
-		//const auto matLambert_GrayBlue = AddMaterial(new Material_Lambert({ .49f, 0.57f, 0.57f }, 1.f));
-		//const auto matLambert_White = AddMaterial(new Material_Lambert(colors::White, 1.f));
+		//const auto matLambert_GrayBlue = AddMaterial(Material::CreateLambert({ .49f, 0.57f, 0.57f }, 1.f));
+		//const auto matLambert_White = AddMaterial(Material::CreateLambert(colors::White, 1.f));
 
 		////Planes
 		//AddPlane(Vector3{ 0.f, 0.f, 10.f }, Vector3{ 0.f, 0.f, -1.f }, matLambert_GrayBlue); //BACK
@@ -270,9 +424,9 @@ namespace dae {
 		//AddPlane(Vector3{ -5.f, 0.f, 0.f }, Vector3{ 1.f, 0.f, 0.f }, matLambert_GrayBlue); //LEFT
 
 		////Temorary Lambert-Phong Spheres & Materials
-		//const auto matLambertPhong1 = AddMaterial(new Material_LambertPhong(colors::Blue, 0.5f, 0.5f, 3.f));
-		//const auto matLambertPhong2 = AddMaterial(new Material_LambertPhong(colors::Blue, 0.5f, 0.5f, 15.f));
-		//const auto matLambertPhong3 = AddMaterial(new Material_LambertPhong(colors::Blue, 0.5f, 0.5f, 50.f));
+		//const auto matLambertPhong1 = AddMaterial(Material::CreateLambertPhong(colors::Blue, 0.5f, 0.5f, 3.f));
+		//const auto matLambertPhong2 = AddMaterial(Material::CreateLambertPhong(colors::Blue, 0.5f, 0.5f, 15.f));
+		//const auto matLambertPhong3 = AddMaterial(Material::CreateLambertPhong(colors::Blue, 0.5f, 0.5f, 50.f));
 
 		////Spheres
 		//AddSphere(Vector3{ -1.75f, 1.f, 0.f }, .75f, matLambertPhong1);
@@ -295,15 +449,15 @@ namespace dae {
 		//m_Camera.origin = { 0, 3, -9 };
 		//m_Camera.fovAngle = 45.f;
 
-		//const auto matCT_GrayRoughMetal = AddMaterial(new Material_CookTorrence({ .972f, .960f, .915f }, 1.f, 1.f));
-		//const auto matCT_GrayMediumMetal = AddMaterial(new Material_CookTorrence({ .972f, .960f, .915f }, 1.f, .6f));
-		//const auto matCT_GraySmoothMetal = AddMaterial(new Material_CookTorrence({ .972f, .960f, .915f }, 1.f, .1f));
-		//const auto matCT_GrayRoughPlastic = AddMaterial(new Material_CookTorrence({ .75f, .75f, .75f }, .0f, 1.f));
-		//const auto matCT_GrayMediumPlastic = AddMaterial(new Material_CookTorrence({ .75f, .75f, .75f }, .0f, .6f));
-		//const auto matCT_GraySmoothPlastic = AddMaterial(new Material_CookTorrence({ .75f, .75f, .75f }, .0f, .1f));
+		//const auto matCT_GrayRoughMetal = AddMaterial(Material::CreateCookTorrence({ .972f, .960f, .915f }, 1.f, 1.f));
+		//const auto matCT_GrayMediumMetal = AddMaterial(Material::CreateCookTorrence({ .972f, .960f, .915f }, 1.f, .6f));
+		//const auto matCT_GraySmoothMetal = AddMaterial(Material::CreateCookTorrence({ .972f, .960f, .915f }, 1.f, .1f));
+		//const auto matCT_GrayRoughPlastic = AddMaterial(Material::CreateCookTorrence({ .75f, .75f, .75f }, .0f, 1.f));
+		//const auto matCT_GrayMediumPlastic = AddMaterial(Material::CreateCookTorrence({ .75f, .75f, .75f }, .0f, .6f));
+		//const auto matCT_GraySmoothPlastic = AddMaterial(Material::CreateCookTorrence({ .75f, .75f, .75f }, .0f, .1f));
 
-		//const auto matLambert_GrayBlue = AddMaterial(new Material_Lambert({ .49f, 0.57f, 0.57f }, 1.f));
-		//const auto matLambert_White = AddMaterial(new Material_Lambert(colors::White, 1.f));
+		//const auto matLambert_GrayBlue = AddMaterial(Material::CreateLambert({ .49f, 0.57f, 0.57f }, 1.f));
+		//const auto matLambert_White = AddMaterial(Material::CreateLambert(colors::White, 1.f));
 
 		//AddPlane(Vector3{ 0.f, 0.f, 10.f }, Vector3{ 0.f, 0.f, -1.f }, matLambert_GrayBlue); //BACK
 		//AddPlane(Vector3{ 0.f, 0.f, 0.f }, Vector3{ 0.f, 1.f, 0.f }, matLambert_GrayBlue); //BOTTOM
@@ -329,16 +483,16 @@ namespace dae {
 		//m_Camera.origin = { 0, 3, -9 };
 		//m_Camera.fovAngle = 45.f;
 
-		//const auto matCT_GrayRoughMetal = AddMaterial(new Material_CookTorrence({ .972f, .960f, .915f }, 1.f, 1.f));
-		//const auto matCT_GrayMediumMetal = AddMaterial(new Material_CookTorrence({ .972f, .960f, .915f }, 1.f, .6f));
-		//const auto matCT_GraySmoothMetal = AddMaterial(new Material_CookTorrence({ .972f, .960f, .915f }, 1.f, .1f));
-		//const auto matCT_GrayRoughPlastic = AddMaterial(new Material_CookTorrence({ .75f, .75f, .75f }, .0f, 1.f));
-		//const auto matCT_GrayMediumPlastic = AddMaterial(new Material_CookTorrence({ .75f, .75f, .75f }, .0f, .6f));
-		//const auto matCT_GraySmoothPlastic = AddMaterial(new Material_CookTorrence({ .75f, .75f, .75f }, .0f, .1f));
+		//const auto matCT_GrayRoughMetal = AddMaterial(Material::CreateCookTorrence({ .972f, .960f, .915f }, 1.f, 1.f));
+		//const auto matCT_GrayMediumMetal = AddMaterial(Material::CreateCookTorrence({ .972f, .960f, .915f }, 1.f, .6f));
+		//const auto matCT_GraySmoothMetal = AddMaterial(Material::CreateCookTorrence({ .972f, .960f, .915f }, 1.f, .1f));
+		//const auto matCT_GrayRoughPlastic = AddMaterial(Material::CreateCookTorrence({ .75f, .75f, .75f }, .0f, 1.f));
+		//const auto matCT_GrayMediumPlastic = AddMaterial(Material::CreateCookTorrence({ .75f, .75f, .75f }, .0f, .6f));
+		//const auto matCT_GraySmoothPlastic = AddMaterial(Material::CreateCookTorrence({ .75f, .75f, .75f }, .0f, .1f));
 
-		//const auto matLambert_GrayBlue = AddMaterial(new Material_Lambert({ .49f, 0.57f, 0.57f }, 1.f));
-		//const auto matLambert_White = AddMaterial(new Material_Lambert(colors::White, 1.f));
-		//const auto matLambert_Gray = AddMaterial(new Material_Lambert(colors::Gray, 1.f));
+		//const auto matLambert_GrayBlue = AddMaterial(Material::CreateLambert({ .49f, 0.57f, 0.57f }, 1.f));
+		//const auto matLambert_White = AddMaterial(Material::CreateLambert(colors::White, 1.f));
+		//const auto matLambert_Gray = AddMaterial(Material::CreateLambert(colors::Gray, 1.f));
 
 		//AddPlane(Vector3{ 0.f, 0.f, 10.f }, Vector3{ 0.f, 0.f, -1.f }, matLambert_GrayBlue); //BACK
 		//AddPlane(Vector3{ 0.f, 0.f, 0.f }, Vector3{ 0.f, 1.f, 0.f }, matLambert_GrayBlue); //BOTTOM
@@ -396,16 +550,16 @@ namespace dae {
 		m_Camera.origin = { 0, 3, -9 };
 		m_Camera.fovAngle = 45.f;
 
-		const auto matCT_GrayRoughMetal = AddMaterial(new Material_CookTorrence({ .972f, .960f, .915f }, 1.f, 1.f));
-		const auto matCT_GrayMediumMetal = AddMaterial(new Material_CookTorrence({ .972f, .960f, .915f }, 1.f, .6f));
-		const auto matCT_GraySmoothMetal = AddMaterial(new Material_CookTorrence({ .972f, .960f, .915f }, 1.f, .1f));
-		const auto matCT_GrayRoughPlastic = AddMaterial(new Material_CookTorrence({ .75f, .75f, .75f }, .0f, 1.f));
-		const auto matCT_GrayMediumPlastic = AddMaterial(new Material_CookTorrence({ .75f, .75f, .75f }, .0f, .6f));
-		const auto matCT_GraySmoothPlastic = AddMaterial(new Material_CookTorrence({ .75f, .75f, .75f }, .0f, .1f));
+		const auto matCT_GrayRoughMetal = AddMaterial(Material::CreateCookTorrence({ .972f, .960f, .915f }, 1.f, 1.f));
+		const auto matCT_GrayMediumMetal = AddMaterial(Material::CreateCookTorrence({ .972f, .960f, .915f }, 1.f, .6f));
+		const auto matCT_GraySmoothMetal = AddMaterial(Material::CreateCookTorrence({ .972f, .960f, .915f }, 1.f, .1f));
+		const auto matCT_GrayRoughPlastic = AddMaterial(Material::CreateCookTorrence({ .75f, .75f, .75f }, .0f, 1.f));
+		const auto matCT_GrayMediumPlastic = AddMaterial(Material::CreateCookTorrence({ .75f, .75f, .75f }, .0f, .6f));
+		const auto matCT_GraySmoothPlastic = AddMaterial(Material::CreateCookTorrence({ .75f, .75f, .75f }, .0f, .1f));
 
-		const auto matLambert_GrayBlue = AddMaterial(new Material_Lambert({ .49f, 0.57f, 0.57f }, 1.f));
-		const auto matLambert_White = AddMaterial(new Material_Lambert(colors::White, 1.f));
-		const auto matLambert_Gray = AddMaterial(new Material_Lambert(colors::Gray, 1.f));
+		const auto matLambert_GrayBlue = AddMaterial(Material::CreateLambert({ .49f, 0.57f, 0.57f }, 1.f));
+		const auto matLambert_White = AddMaterial(Material::CreateLambert(colors::White, 1.f));
+		const auto matLambert_Gray = AddMaterial(Material::CreateLambert(colors::Gray, 1.f));
 
 		AddPlane(Vector3{ 0.f, 0.f, 10.f }, Vector3{ 0.f, 0.f, -1.f }, matLambert_GrayBlue); //BACK
 		AddPlane(Vector3{ 0.f, 0.f, 0.f }, Vector3{ 0.f, 1.f, 0.f }, matLambert_GrayBlue); //BOTTOM
@@ -451,8 +605,8 @@ namespace dae {
 		m_Camera.origin = { 0, 3, -9 };
 		m_Camera.fovAngle = 45.f;
 
-		const auto matLambert_GrayBlue = AddMaterial(new Material_Lambert({ .49f, 0.57f, 0.57f }, 1.f));
-		const auto matLambert_White = AddMaterial(new Material_Lambert(colors::White, 1.f));
+		const auto matLambert_GrayBlue = AddMaterial(Material::CreateLambert({ .49f, 0.57f, 0.57f }, 1.f));
+		const auto matLambert_White = AddMaterial(Material::CreateLambert(colors::White, 1.f));
 
 		AddPlane(Vector3{ 0.f, 0.f, 10.f }, Vector3{ 0.f, 0.f, -1.f }, matLambert_GrayBlue); //BACK
 		AddPlane(Vector3{ 0.f, 0.f, 0.f }, Vector3{ 0.f, 1.f, 0.f }, matLambert_GrayBlue); //BOTTOM
@@ -522,16 +676,16 @@ namespace dae {
 		m_Camera.origin = { 0, 3, -9 };
 		m_Camera.fovAngle = 45.f;
 
-		const auto matCT_GrayRoughMetal = AddMaterial(new Material_CookTorrence({ .972f, .960f, .915f }, 1.f, 1.f));
-		const auto matCT_GrayMediumMetal = AddMaterial(new Material_CookTorrence({ .972f, .960f, .915f }, 1.f, .6f));
-		const auto matCT_GraySmoothMetal = AddMaterial(new Material_CookTorrence({ .972f, .960f, .915f }, 1.f, .1f));
-		const auto matCT_GrayRoughPlastic = AddMaterial(new Material_CookTorrence({ .75f, .75f, .75f }, .0f, 1.f));
-		const auto matCT_GrayMediumPlastic = AddMaterial(new Material_CookTorrence({ .75f, .75f, .75f }, .0f, .6f));
-		const auto matCT_GraySmoothPlastic = AddMaterial(new Material_CookTorrence({ .75f, .75f, .75f }, .0f, .1f));
+		const auto matCT_GrayRoughMetal = AddMaterial(Material::CreateCookTorrence({ .972f, .960f, .915f }, 1.f, 1.f));
+		const auto matCT_GrayMediumMetal = AddMaterial(Material::CreateCookTorrence({ .972f, .960f, .915f }, 1.f, .6f));
+		const auto matCT_GraySmoothMetal = AddMaterial(Material::CreateCookTorrence({ .972f, .960f, .915f }, 1.f, .1f));
+		const auto matCT_GrayRoughPlastic = AddMaterial(Material::CreateCookTorrence({ .75f, .75f, .75f }, .0f, 1.f));
+		const auto matCT_GrayMediumPlastic = AddMaterial(Material::CreateCookTorrence({ .75f, .75f, .75f }, .0f, .6f));
+		const auto matCT_GraySmoothPlastic = AddMaterial(Material::CreateCookTorrence({ .75f, .75f, .75f }, .0f, .1f));
 
-		const auto matLambert_GrayBlue = AddMaterial(new Material_Lambert({ .49f, 0.57f, 0.57f }, 1.f));
-		const auto matLambert_White = AddMaterial(new Material_Lambert(colors::White, 1.f));
-		const auto matLambert_Gray = AddMaterial(new Material_Lambert(colors::Gray, 1.f));
+		const auto matLambert_GrayBlue = AddMaterial(Material::CreateLambert({ .49f, 0.57f, 0.57f }, 1.f));
+		const auto matLambert_White = AddMaterial(Material::CreateLambert(colors::White, 1.f));
+		const auto matLambert_Gray = AddMaterial(Material::CreateLambert(colors::Gray, 1.f));
 
 		AddPlane(Vector3{ 0.f, 0.f, 10.f }, Vector3{ 0.f, 0.f, -1.f }, matLambert_GrayBlue); //BACK
 		AddPlane(Vector3{ 0.f, 0.f, 0.f }, Vector3{ 0.f, 1.f, 0.f }, matLambert_GrayBlue); //BOTTOM
@@ -589,8 +743,8 @@ namespace dae {
 		m_Camera.origin = { 0, 3, -9 };
 		m_Camera.fovAngle = 45.f;
 
-		const auto matLambert_GrayBlue = AddMaterial(new Material_Lambert({ .49f, 0.57f, 0.57f }, 1.f));
-		const auto matLambert_White = AddMaterial(new Material_Lambert(colors::White, 1.f));
+		const auto matLambert_GrayBlue = AddMaterial(Material::CreateLambert({ .49f, 0.57f, 0.57f }, 1.f));
+		const auto matLambert_White = AddMaterial(Material::CreateLambert(colors::White, 1.f));
 
 		AddPlane(Vector3{ 0.f, 0.f, 10.f }, Vector3{ 0.f, 0.f, -1.f }, matLambert_GrayBlue); //BACK
 		AddPlane(Vector3{ 0.f, 0.f, 0.f }, Vector3{ 0.f, 1.f, 0.f }, matLambert_GrayBlue); //BOTTOM
@@ -629,11 +783,11 @@ namespace dae {
 		m_Camera.origin = { 0, 3, -9 };
 		m_Camera.fovAngle = 45.f;
 
-		const auto matLambert_GrayBlue = AddMaterial(new Material_Lambert({ 0.15f, 0.15f, 0.35f }, 0.45f));
-		const auto matLambert_White = AddMaterial(new Material_Lambert(colors::White, 0.5f));
+		const auto matLambert_GrayBlue = AddMaterial(Material::CreateLambert({ 0.15f, 0.15f, 0.35f }, 0.45f));
+		const auto matLambert_White = AddMaterial(Material::CreateLambert(colors::White, 0.5f));
 
-		const auto matLambert_Bottom = AddMaterial(new Material_Lambert({ 0.15f, 0.3f, 0.15f }, 1.f));
-		const auto matLambert_Top = AddMaterial(new Material_Lambert({ 0.2f, 0.2f, 0.8f }, 1.f));
+		const auto matLambert_Bottom = AddMaterial(Material::CreateLambert({ 0.15f, 0.3f, 0.15f }, 1.f));
+		const auto matLambert_Top = AddMaterial(Material::CreateLambert({ 0.2f, 0.2f, 0.8f }, 1.f));
 
 		AddPlane(Vector3{ 0.f, 0.f, 0.f }, Vector3{ 0.f, 1.f, 0.f }, matLambert_Bottom); //BOTTOM
 		AddPlane(Vector3{ 0.f, 10.f, 0.f }, Vector3{ 0.f, -1.f, 0.f }, matLambert_Top); //TOP
@@ -664,4 +818,160 @@ namespace dae {
 		//pMesh->RotateY(PI_DIV_2 * pTimer->GetTotal());
 		pMesh->UpdateTransforms();
 	}
+
+#pragma region SYNTHETIC SCENES
+	void SphereGridScene::Initialize()
+	{
+		sceneName = "Sphere Grid Scene";
+		m_Camera.origin = { 0, 3, -9 };
+		m_Camera.fovAngle = 45.f;
+
+		const unsigned char materials[]
+		{
+			AddMaterial(Material::CreateCookTorrence({ .972f, .960f, .915f }, 1.f, .6f)),
+			AddMaterial(Material::CreateCookTorrence({ .75f, .75f, .75f }, .0f, .3f)),
+			AddMaterial(Material::CreateLambertPhong(colors::Blue, .5f, .5f, 60.f)),
+			AddMaterial(Material::CreateLambert({ .49f, 0.57f, 0.57f }, 1.f))
+		};
+		const auto matLambert_Gray = AddMaterial(Material::CreateLambert(colors::Gray, 1.f));
+
+		AddPlane(Vector3{ 0.f, 0.f, 10.f }, Vector3{ 0.f, 0.f, -1.f }, matLambert_Gray); //BACK
+		AddPlane(Vector3{ 0.f, 0.f, 0.f }, Vector3{ 0.f, 1.f, 0.f }, matLambert_Gray); //BOTTOM
+
+		//12 x 8 spheres, staggered in depth so they shadow each other
+		const int nrOfColumns{ 12 }, nrOfRows{ 8 };
+		for (int row{}; row < nrOfRows; ++row)
+		{
+			for (int column{}; column < nrOfColumns; ++column)
+			{
+				const Vector3 center{ -4.4f + column * .8f, .4f + row * .7f, 1.f + (column + row) % 3 };
+				AddSphere(center, .3f, materials[(column + row) % std::size(materials)]);
+			}
+		}
+
+		AddPointLight(Vector3{ 0.f, 5.f, 5.f }, 50.f, ColorRGB{ 1.f, .61f, .45f }); //Backlight
+		AddPointLight(Vector3{ -2.5f, 5.f, -5.f }, 70.f, ColorRGB{ 1.f, .8f, .45f }); //Front Light Left
+		AddPointLight(Vector3{ 2.5f, 2.5f, -5.f }, 50.f, ColorRGB{ .34f, .47f, .68f });
+	}
+
+	void TriangleFieldScene::Initialize()
+	{
+		sceneName = "Triangle Field Scene";
+		m_Camera.origin = { 0, 3, -9 };
+		m_Camera.fovAngle = 45.f;
+
+		const auto matLambert_GrayBlue = AddMaterial(Material::CreateLambert({ .49f, 0.57f, 0.57f }, 1.f));
+		const auto matCT_GrayMediumPlastic = AddMaterial(Material::CreateCookTorrence({ .75f, .75f, .75f }, .0f, .6f));
+
+		AddPlane(Vector3{ 0.f, 0.f, 10.f }, Vector3{ 0.f, 0.f, -1.f }, matLambert_GrayBlue); //BACK
+
+		//8 x 8 cells of rolling hills, two triangles each (every ray still tests all of them)
+		const int nrOfCells{ 8 };
+		const float cellSize{ 8.f / nrOfCells };
+		const auto height{ [](float x, float z) { return 1.f + .5f * sinf(x * 1.5f) * cosf(z * 1.5f); } };
+
+		pMesh = AddTriangleMesh(TriangleCullMode::NoCulling, matCT_GrayMediumPlastic);
+		for (int cellZ{}; cellZ < nrOfCells; ++cellZ)
+		{
+			for (int cellX{}; cellX < nrOfCells; ++cellX)
+			{
+				const float x0{ -4.f + cellX * cellSize }, x1{ x0 + cellSize };
+				const float z0{ -4.f + cellZ * cellSize }, z1{ z0 + cellSize };
+				const Vector3 v00{ x0, height(x0, z0), z0 }, v10{ x1, height(x1, z0), z0 };
+				const Vector3 v01{ x0, height(x0, z1), z1 }, v11{ x1, height(x1, z1), z1 };
+
+				pMesh->AppendTriangle(Triangle{ v00, v01, v10 }, true);
+				pMesh->AppendTriangle(Triangle{ v10, v01, v11 }, true);
+			}
+		}
+		pMesh->Translate({ 0.f, 0.f, 3.f });
+		pMesh->UpdateAABB();
+		pMesh->UpdateTransforms();
+
+		AddPointLight(Vector3{ 0.f, 5.f, 5.f }, 50.f, ColorRGB{ 1.f, .61f, .45f }); //Backlight
+		AddPointLight(Vector3{ -2.5f, 5.f, -5.f }, 70.f, ColorRGB{ 1.f, .8f, .45f }); //Front Light Left
+		AddPointLight(Vector3{ 2.5f, 2.5f, -5.f }, 50.f, ColorRGB{ .34f, .47f, .68f });
+	}
+	void TriangleFieldScene::Update(Timer* pTimer)
+	{
+		Scene::Update(pTimer);
+
+		pMesh->RotateY(.25f * pTimer->GetTotal());
+		pMesh->UpdateTransforms();
+	}
+
+	void AreaLightScene::Initialize()
+	{
+		sceneName = "Area Light Scene";
+		m_Camera.origin = { 0, 3, -9 };
+		m_Camera.fovAngle = 45.f;
+
+		const auto matCT_GrayMediumMetal = AddMaterial(Material::CreateCookTorrence({ .972f, .960f, .915f }, 1.f, .6f));
+		const auto matCT_GrayRoughPlastic = AddMaterial(Material::CreateCookTorrence({ .75f, .75f, .75f }, .0f, 1.f));
+		const auto matLambert_GrayBlue = AddMaterial(Material::CreateLambert({ .49f, 0.57f, 0.57f }, 1.f));
+		const auto matLambert_White = AddMaterial(Material::CreateLambert(colors::White, 1.f));
+
+		AddPlane(Vector3{ 0.f, 0.f, 10.f }, Vector3{ 0.f, 0.f, -1.f }, matLambert_GrayBlue); //BACK
+		AddPlane(Vector3{ 0.f, 0.f, 0.f }, Vector3{ 0.f, 1.f, 0.f }, matLambert_White); //BOTTOM
+
+		AddSphere(Vector3{ -1.75f, 1.f, 0.f }, .75f, matCT_GrayRoughPlastic);
+		AddSphere(Vector3{ 0.f, .5f, -1.f }, .5f, matLambert_GrayBlue);
+		AddSphere(Vector3{ 1.75f, 1.f, 0.f }, .75f, matCT_GrayMediumMetal);
+
+		//a 3 x 2 panel facing down and a ball off to the side, wide penumbras on the floor
+		AddRectLight(Vector3{ 0.f, 5.f, 0.f }, Vector3{ 1.5f, 0.f, 0.f }, Vector3{ 0.f, 0.f, 1.f }, 150.f, ColorRGB{ 1.f, .8f, .6f });
+		AddSphereLight(Vector3{ 3.f, 2.5f, -4.f }, .75f, 60.f, ColorRGB{ .34f, .47f, .68f });
+	}
+
+	void ManyLightsScene::Initialize()
+	{
+		sceneName = "Many Lights Scene";
+		m_Camera.origin = { 0, 3, -9 };
+		m_Camera.fovAngle = 45.f;
+
+		const auto matCT_GrayMediumPlastic = AddMaterial(Material::CreateCookTorrence({ .75f, .75f, .75f }, .0f, .6f));
+		const auto matCT_GrayMediumMetal = AddMaterial(Material::CreateCookTorrence({ .972f, .960f, .915f }, 1.f, .6f));
+		const auto matLambert_GrayBlue = AddMaterial(Material::CreateLambert({ .49f, 0.57f, 0.57f }, 1.f));
+		const auto matLambert_White = AddMaterial(Material::CreateLambert(colors::White, 1.f));
+
+		AddPlane(Vector3{ 0.f, 0.f, 10.f }, Vector3{ 0.f, 0.f, -1.f }, matLambert_GrayBlue); //BACK
+		AddPlane(Vector3{ 0.f, 0.f, 0.f }, Vector3{ 0.f, 1.f, 0.f }, matLambert_White); //BOTTOM
+
+		AddSphere(Vector3{ -1.75f, 1.f, 0.f }, .75f, matCT_GrayMediumPlastic);
+		AddSphere(Vector3{ 0.f, 1.f, 0.f }, .75f, matCT_GrayMediumMetal);
+		AddSphere(Vector3{ 1.75f, 1.f, 0.f }, .75f, matCT_GrayMediumPlastic);
+
+		//100 x 100 lights over the floor in front of the back wall, at heights and in colors that look random but are the same every run
+		const ColorRGB palette[]{ { 1.f, .61f, .45f }, { 1.f, .8f, .45f }, { .34f, .47f, .68f }, { .55f, .9f, .5f } };
+		const int nrOfColumns{ 100 }, nrOfRows{ 100 };
+		for (int row{}; row < nrOfRows; ++row)
+		{
+			for (int column{}; column < nrOfColumns; ++column)
+			{
+				const int index{ column + row * nrOfColumns };
+				const float height{ .25f + 4.f * (.5f + .5f * sinf(index * 12.9898f)) };
+				const Vector3 origin{ -6.f + column * .12f, height, -2.f + row * .12f };
+				AddPointLight(origin, .02f, palette[(index * 7 + row) % std::size(palette)]);
+			}
+		}
+	}
+#pragma endregion
+
+#pragma region SCENE FACTORY
+	std::unique_ptr<Scene> CreateScene(const std::string& name)
+	{
+		if (name == "Scene_W1") return std::make_unique<Scene_W1>();
+		if (name == "Scene_W2") return std::make_unique<Scene_W2>();
+		if (name == "Scene_W3") return std::make_unique<Scene_W3>();
+		if (name == "Scene_W4") return std::make_unique<Scene_W4>();
+		if (name == "ReferenceScene") return std::make_unique<ReferenceScene>();
+		if (name == "BunnyScene") return std::make_unique<BunnyScene>();
+		if (name == "ExtraScene") return std::make_unique<ExtraScene>();
+		if (name == "SphereGridScene") return std::make_unique<SphereGridScene>();
+		if (name == "TriangleFieldScene") return std::make_unique<TriangleFieldScene>();
+		if (name == "AreaLightScene") return std::make_unique<AreaLightScene>();
+		if (name == "ManyLightsScene") return std::make_unique<ManyLightsScene>();
+		return nullptr;
+	}
+#pragma endregion
 }
@@ -1,20 +1,31 @@
 #pragma once
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <vector>
 
 #include "Math.h"
 #include "DataTypes.h"
 #include "Camera.h"
+#include "Material.h"
 
 namespace dae
 {
 	//Forward Declarations
 	class Timer;
-	class Material;
 	struct Plane;
 	struct Sphere;
 	struct Light;
 
+	//Primitive types present in a scene, the render kernels are specialized on these
+	namespace Primitives
+	{
+		constexpr uint8_t Spheres{ 1 << 0 };
+		constexpr uint8_t Planes{ 1 << 1 };
+		constexpr uint8_t Meshes{ 1 << 2 };
+		constexpr uint8_t All{ Spheres | Planes | Meshes };
+	}
+
 	//Scene Base Class
 	class Scene
 	{
@@ -37,10 +48,23 @@ namespace dae
 		void GetClosestHit(const Ray& ray, HitRecord& closestHit) const;
 		bool DoesHit(const Ray& ray) const;
 
+		//only tests the primitive types in the mask, instantiated for every combination in Scene.cpp
+		template<uint8_t primitives>
+		void GetClosestHit(const Ray& ray, HitRecord& closestHit) const;
+		template<uint8_t primitives>
+		bool DoesHit(const Ray& ray) const;
+
+		uint8_t GetPrimitives() const;
+
+		//stays the same as long as the camera, the primitives and the lights don't move or change
+		uint64_t GetStateHash() const;
+		//only of the lights, what the renderer's light tree is built from
+		uint64_t GetLightHash() const;
+
 		const std::vector<Plane>& GetPlaneGeometries() const { return m_PlaneGeometries; }
 		const std::vector<Sphere>& GetSphereGeometries() const { return m_SphereGeometries; }
 		const std::vector<Light>& GetLights() const { return m_Lights; }
-		const std::vector<Material*> GetMaterials() const { return m_Materials; }
+		const std::vector<Material>& GetMaterials() const { return m_Materials; }
 
 	protected:
 		std::string	sceneName;
@@ -49,7 +73,7 @@ namespace dae
 		std::vector<Sphere> m_SphereGeometries{};
 		std::vector<TriangleMesh> m_TriangleMeshGeometries{};
 		std::vector<Light> m_Lights{};
-		std::vector<Material*> m_Materials{};
+		std::vector<Material> m_Materials{};
 
 		Camera m_Camera{};
 
@@ -59,7 +83,10 @@ namespace dae
 
 		Light* AddPointLight(const Vector3& origin, float intensity, const ColorRGB& color);
 		Light* AddDirectionalLight(const Vector3& direction, float intensity, const ColorRGB& color);
-		unsigned char AddMaterial(Material* pMaterial);
+		//shines towards Cross(halfWidth, halfHeight), the two halves should be perpendicular
+		Light* AddRectLight(const Vector3& origin, const Vector3& halfWidth, const Vector3& halfHeight, float intensity, const ColorRGB& color);
+		Light* AddSphereLight(const Vector3& origin, float radius, float intensity, const ColorRGB& color);
+		unsigned char AddMaterial(const Material& material);
 	};
 
 	//+++++++++++++++++++++++++++++++++++++++++
@@ -193,4 +220,75 @@ namespace dae
 	private:
 		TriangleMesh* pMesh{ nullptr };
 	};
+
+	//+++++++++++++++++++++++++++++++++++++++++
+	//SYNTHETIC Sphere Grid (benchmark): lots of spheres in every material model
+	class SphereGridScene final : public Scene
+	{
+	public:
+		SphereGridScene() = default;
+		~SphereGridScene() override = default;
+
+		SphereGridScene(const SphereGridScene&) = delete;
+		SphereGridScene(SphereGridScene&&) noexcept = delete;
+		SphereGridScene& operator=(const SphereGridScene&) = delete;
+		SphereGridScene& operator=(SphereGridScene&&) noexcept = delete;
+
+		void Initialize() override;
+	};
+	//+++++++++++++++++++++++++++++++++++++++++
+	//SYNTHETIC Triangle Field (benchmark): procedural height field mesh, needs no resource files
+	class TriangleFieldScene final : public Scene
+	{
+	public:
+		TriangleFieldScene() = default;
+		~TriangleFieldScene() override = default;
+
+		TriangleFieldScene(const TriangleFieldScene&) = delete;
+		TriangleFieldScene(TriangleFieldScene&&) noexcept = delete;
+		TriangleFieldScene& operator=(const TriangleFieldScene&) = delete;
+		TriangleFieldScene& operator=(TriangleFieldScene&&) noexcept = delete;
+
+		void Initialize() override;
+		void Update(Timer* pTimer) override;
+
+	private:
+		TriangleMesh* pMesh{ nullptr };
+	};
+
+	//+++++++++++++++++++++++++++++++++++++++++
+	//SYNTHETIC Area Lights: soft shadows of a rect and a sphere light, needs no resource files
+	class AreaLightScene final : public Scene
+	{
+	public:
+		AreaLightScene() = default;
+		~AreaLightScene() override = default;
+
+		AreaLightScene(const AreaLightScene&) = delete;
+		AreaLightScene(AreaLightScene&&) noexcept = delete;
+		AreaLightScene& operator=(const AreaLightScene&) = delete;
+		AreaLightScene& operator=(AreaLightScene&&) noexcept = delete;
+
+		void Initialize() override;
+	};
+
+	//+++++++++++++++++++++++++++++++++++++++++
+	//SYNTHETIC Many Lights: 10k small colored point lights over spheres on a floor, for the light tree
+	class ManyLightsScene final : public Scene
+	{
+	public:
+		ManyLightsScene() = default;
+		~ManyLightsScene() override = default;
+
+		ManyLightsScene(const ManyLightsScene&) = delete;
+		ManyLightsScene(ManyLightsScene&&) noexcept = delete;
+		ManyLightsScene& operator=(const ManyLightsScene&) = delete;
+		ManyLightsScene& operator=(ManyLightsScene&&) noexcept = delete;
+
+		void Initialize() override;
+	};
+
+	//+++++++++++++++++++++++++++++++++++++++++
+	//Creates a scene by class name ("ReferenceScene", "Scene_W4", ...), nullptr for an unknown name
+	std::unique_ptr<Scene> CreateScene(const std::string& name);
 }
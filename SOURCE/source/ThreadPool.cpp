@@ -0,0 +1,92 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+#include "Trace.h"
+
+using namespace dae;
+
+ThreadPool::ThreadPool(int nrOfThreads)
+{
+	if (nrOfThreads <= 0)
+	{
+		nrOfThreads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+	}
+
+	//the thread calling ParallelFor is the first one
+	m_Workers.reserve(nrOfThreads - 1);
+	for (int threadIndex{ 1 }; threadIndex < nrOfThreads; ++threadIndex)
+	{
+		m_Workers.emplace_back(&ThreadPool::WorkerLoop, this, threadIndex);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard lock{ m_Mutex };
+		m_Stop = true;
+	}
+	m_WorkAvailable.notify_all();
+
+	for (std::thread& worker : m_Workers)
+	{
+		worker.join();
+	}
+}
+
+void ThreadPool::ParallelFor(uint32_t count, const Task& task)
+{
+	{
+		std::lock_guard lock{ m_Mutex };
+		m_pTask = &task;
+		m_Count = count;
+		m_NextIndex = 0;
+		m_NrOfBusyWorkers = static_cast<int>(m_Workers.size());
+		++m_Generation;
+	}
+	m_WorkAvailable.notify_all();
+
+	RunTasks(0);
+
+	std::unique_lock lock{ m_Mutex };
+	m_WorkDone.wait(lock, [this] { return m_NrOfBusyWorkers == 0; });
+	m_pTask = nullptr;
+}
+
+void ThreadPool::WorkerLoop(int threadIndex)
+{
+	uint64_t generation{};
+	while (true)
+	{
+		{
+			std::unique_lock lock{ m_Mutex };
+			m_WorkAvailable.wait(lock, [&] { return m_Stop || m_Generation != generation; });
+			if (m_Stop)
+			{
+				return;
+			}
+			generation = m_Generation;
+		}
+
+		RunTasks(threadIndex);
+
+		std::lock_guard lock{ m_Mutex };
+		if (--m_NrOfBusyWorkers == 0)
+		{
+			m_WorkDone.notify_one();
+		}
+	}
+}
+
+void ThreadPool::RunTasks(int threadIndex)
+{
+	//the gaps between these per thread are time spent waiting
+	TRACE_SCOPE("ParallelFor");
+
+	//indices are handed out one by one, so uneven tiles still balance out
+	for (uint32_t index{ m_NextIndex++ }; index < m_Count; index = m_NextIndex++)
+	{
+		(*m_pTask)(index, threadIndex);
+	}
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace dae
+{
+	/**
+	 * \brief Fixed set of worker threads that split index ranges between them
+	 * Unlike std::execution::par the amount of threads is known and stable, every task knows which thread runs it
+	 */
+	class ThreadPool final
+	{
+	public:
+		using Task = std::function<void(uint32_t index, int threadIndex)>;
+
+		//0 = one thread per hardware thread
+		explicit ThreadPool(int nrOfThreads = 0);
+		~ThreadPool();
+
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool(ThreadPool&&) noexcept = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+		ThreadPool& operator=(ThreadPool&&) noexcept = delete;
+
+		/**
+		 * \brief Runs task for every index in [0, count), the calling thread works along as thread 0
+		 * Returns when every index is done
+		 */
+		void ParallelFor(uint32_t count, const Task& task);
+
+		int GetNrOfThreads() const { return static_cast<int>(m_Workers.size()) + 1; }
+
+	private:
+		void WorkerLoop(int threadIndex);
+		void RunTasks(int threadIndex);
+
+		std::vector<std::thread> m_Workers{};
+
+		std::mutex m_Mutex{};
+		std::condition_variable m_WorkAvailable{};
+		std::condition_variable m_WorkDone{};
+		uint64_t m_Generation{};
+		int m_NrOfBusyWorkers{};
+		bool m_Stop{};
+
+		const Task* m_pTask{};
+		uint32_t m_Count{};
+		std::atomic<uint32_t> m_NextIndex{};
+	};
+}
@@ -5,6 +5,8 @@
 
 #include <iostream>
 #include <fstream>
+#include <algorithm>
+#include <cmath>
 
 #include "SDL.h"
 using namespace dae;
@@ -93,6 +95,8 @@ void Timer::Update()
 	//FPS LOGIC
 	m_FPSTimer += m_ElapsedTime;
 	++m_FPSCount;
+	RecordFrame();
+
 	if (m_FPSTimer >= 1.0f)
 	{
 		m_dFPS = m_FPSCount / m_FPSTimer;
@@ -125,6 +129,13 @@ void Timer::Update()
 				fileStream << "HIGH = " << m_BenchmarkHigh << std::endl;
 				fileStream << "LOW = " << m_BenchmarkLow << std::endl;
 				fileStream << "AVG = " << m_BenchmarkAvg << std::endl;
+
+				//the averages above hide hitches, the per-frame percentiles don't
+				const FrameTimeStats frameStats{ GetFrameTimeStats() };
+				fileStream << "P50_MS = " << frameStats.p50 << std::endl;
+				fileStream << "P90_MS = " << frameStats.p90 << std::endl;
+				fileStream << "P99_MS = " << frameStats.p99 << std::endl;
+				fileStream << "MAX_MS = " << frameStats.max << std::endl;
 				fileStream.close();
 			}
 		}
@@ -141,3 +152,131 @@ void Timer::Stop()
 		m_IsStopped = true;
 	}
 }
+
+void Timer::Step(float elapsedTime)
+{
+	m_ElapsedTime = elapsedTime;
+	m_TotalTime += elapsedTime;
+}
+
+void Timer::StartPhase(FramePhase phase)
+{
+	m_PhaseStarts[static_cast<int>(phase)] = SDL_GetPerformanceCounter();
+}
+
+void Timer::EndPhase(FramePhase phase)
+{
+	const uint64_t endTime = SDL_GetPerformanceCounter();
+	const int phaseIndex{ static_cast<int>(phase) };
+	m_CurrentFrame.phases[phaseIndex] += (endTime - m_PhaseStarts[phaseIndex]) * m_SecondsPerCount * 1000.f;
+}
+
+void Timer::RecordFrame()
+{
+	m_CurrentFrame.total = m_ElapsedTime * 1000.f;
+
+	m_FrameHistory[m_FrameHistoryNext] = m_CurrentFrame;
+	m_FrameHistoryNext = (m_FrameHistoryNext + 1) % m_FrameHistorySize;
+	m_FrameHistoryCount = std::min(m_FrameHistoryCount + 1, m_FrameHistorySize);
+
+	m_CurrentFrame = FrameRecord{};
+}
+
+const Timer::FrameRecord& Timer::GetRecordedFrame(int age) const
+{
+	const int oldest{ (m_FrameHistoryNext - m_FrameHistoryCount + m_FrameHistorySize) % m_FrameHistorySize };
+	return m_FrameHistory[(oldest + age) % m_FrameHistorySize];
+}
+
+static FrameTimeStats GetStats(std::vector<float>& times)
+{
+	FrameTimeStats stats{};
+	if (times.empty())
+		return stats;
+
+	//nearest rank, every value is a frame that really happened
+	std::sort(times.begin(), times.end());
+	const auto percentile = [&times](float percent)
+	{
+		const size_t rank{ static_cast<size_t>(std::ceil(percent / 100.f * times.size())) };
+		return times[std::clamp<size_t>(rank, 1, times.size()) - 1];
+	};
+
+	stats.p50 = percentile(50.f);
+	stats.p90 = percentile(90.f);
+	stats.p99 = percentile(99.f);
+	stats.max = times.back();
+	return stats;
+}
+
+FrameTimeStats Timer::GetFrameTimeStats() const
+{
+	std::vector<float> times(m_FrameHistoryCount);
+	for (int age{}; age < m_FrameHistoryCount; ++age)
+		times[age] = GetRecordedFrame(age).total;
+
+	return GetStats(times);
+}
+
+FrameTimeStats Timer::GetFrameTimeStats(FramePhase phase) const
+{
+	std::vector<float> times(m_FrameHistoryCount);
+	for (int age{}; age < m_FrameHistoryCount; ++age)
+		times[age] = GetRecordedFrame(age).phases[static_cast<int>(phase)];
+
+	return GetStats(times);
+}
+
+Timer::FrameHistogram Timer::GetFrameHistogram() const
+{
+	FrameHistogram histogram{};
+	for (int age{}; age < m_FrameHistoryCount; ++age)
+	{
+		const float total{ GetRecordedFrame(age).total };
+		const auto bucket{ std::lower_bound(HistogramLimits.begin(), HistogramLimits.end(), total) - HistogramLimits.begin() };
+		++histogram[bucket];
+	}
+	return histogram;
+}
+
+void Timer::PrintFrameTimeStats() const
+{
+	constexpr const char* phaseNames[NrOfFramePhases]{ "update", "render", "present" };
+
+	const auto print = [](const char* name, const FrameTimeStats& stats)
+	{
+		std::cout << ">> " << name << ": p50 " << stats.p50 << " ms, p90 " << stats.p90 << " ms, p99 " << stats.p99 << " ms, max " << stats.max << " ms\n";
+	};
+
+	std::cout << "**FRAME TIMES** last " << m_FrameHistoryCount << " frames\n";
+	print("frame", GetFrameTimeStats());
+	for (int phase{}; phase < NrOfFramePhases; ++phase)
+		print(phaseNames[phase], GetFrameTimeStats(static_cast<FramePhase>(phase)));
+
+	const FrameHistogram histogram{ GetFrameHistogram() };
+	for (size_t bucket{}; bucket < histogram.size(); ++bucket)
+	{
+		if (bucket < HistogramLimits.size())
+			std::cout << ">> <= " << HistogramLimits[bucket] << " ms: " << histogram[bucket] << "\n";
+		else
+			std::cout << ">> > " << HistogramLimits.back() << " ms: " << histogram[bucket] << "\n";
+	}
+}
+
+bool Timer::SaveFrameTimesToCsv(const std::string& filePath) const
+{
+	std::ofstream fileStream(filePath);
+	if (!fileStream)
+		return false;
+
+	fileStream << "frame,total_ms,update_ms,render_ms,present_ms\n";
+	for (int age{}; age < m_FrameHistoryCount; ++age)
+	{
+		const FrameRecord& record{ GetRecordedFrame(age) };
+		fileStream << age << "," << record.total;
+		for (const float phase : record.phases)
+			fileStream << "," << phase;
+		fileStream << "\n";
+	}
+	return static_cast<bool>(fileStream);
+}
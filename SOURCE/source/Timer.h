@@ -1,11 +1,31 @@
 #pragma once
 
 //Standard includes
+#include <array>
 #include <cstdint>
+#include <string>
 #include <vector>
 
 namespace dae
 {
+	//parts of a frame the main loop times separately
+	enum class FramePhase
+	{
+		Update,
+		Render,
+		Present
+	};
+	constexpr int NrOfFramePhases{ 3 };
+
+	//over the frames still in the history, in milliseconds
+	struct FrameTimeStats
+	{
+		float p50{};
+		float p90{};
+		float p99{};
+		float max{};
+	};
+
 	class Timer
 	{
 	public:
@@ -24,12 +44,31 @@ namespace dae
 		void Update();
 		void Stop();
 
+		//advances by a fixed amount instead of the real clock, for deterministic headless runs
+		void Step(float elapsedTime);
+
 		uint32_t GetFPS() const { return m_FPS; };
 		float GetdFPS() const { return m_dFPS; };
 		float GetElapsed() const { return m_ElapsedTime; };
 		float GetTotal() const { return m_TotalTime; };
 		bool IsRunning() const { return !m_IsStopped; };
 
+		//the time between the two calls is stored as that phase of the frame that's ended by the next Update
+		void StartPhase(FramePhase phase);
+		void EndPhase(FramePhase phase);
+
+		//upper limits of the histogram buckets in milliseconds, the last bucket takes everything above
+		static constexpr std::array<float, 10> HistogramLimits{ 4.f, 8.f, 16.f, 33.f, 50.f, 100.f, 200.f, 500.f, 1000.f, 2000.f };
+		using FrameHistogram = std::array<uint32_t, HistogramLimits.size() + 1>;
+
+		FrameTimeStats GetFrameTimeStats() const;
+		FrameTimeStats GetFrameTimeStats(FramePhase phase) const;
+		FrameHistogram GetFrameHistogram() const;
+		void PrintFrameTimeStats() const;
+
+		//one line per frame in the history, oldest first
+		bool SaveFrameTimesToCsv(const std::string& filePath) const;
+
 	private:
 		uint64_t m_BaseTime = 0;
 		uint64_t m_PausedTime = 0;
@@ -57,5 +96,22 @@ namespace dae
 		int m_BenchmarkFrames{ 0 };
 		int m_BenchmarkCurrFrame{ 0 };
 		std::vector<float> m_Benchmarks{};
+
+		//frame times in ms, whole frame first and then every phase
+		struct FrameRecord
+		{
+			float total{};
+			std::array<float, NrOfFramePhases> phases{};
+		};
+		static constexpr int m_FrameHistorySize{ 1024 };
+		std::array<FrameRecord, m_FrameHistorySize> m_FrameHistory{};
+		int m_FrameHistoryNext{ 0 };
+		int m_FrameHistoryCount{ 0 };
+
+		FrameRecord m_CurrentFrame{};
+		std::array<uint64_t, NrOfFramePhases> m_PhaseStarts{};
+
+		void RecordFrame();
+		const FrameRecord& GetRecordedFrame(int age) const; //0 = oldest frame in the history
 	};
 }
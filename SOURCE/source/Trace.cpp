@@ -0,0 +1,123 @@
+#include "Trace.h"
+
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace dae
+{
+	namespace Trace
+	{
+		std::atomic<bool> g_IsEnabled{ false };
+
+		//only the owning thread writes events and size, the writer reads size after the frame has joined
+		struct alignas(64) ThreadBuffer
+		{
+			std::vector<Event> events{};
+			std::atomic<uint32_t> size{};
+			uint32_t nrOfDropped{};
+			uint32_t threadId{};
+		};
+
+		static std::mutex g_RegistryMutex{};
+		static std::vector<std::unique_ptr<ThreadBuffer>> g_Buffers{};
+		static uint32_t g_MaxEventsPerThread{};
+		static std::chrono::steady_clock::time_point g_StartTime{};
+
+		static ThreadBuffer& RegisterThread()
+		{
+			std::lock_guard lock{ g_RegistryMutex };
+			g_Buffers.push_back(std::make_unique<ThreadBuffer>());
+
+			ThreadBuffer& buffer{ *g_Buffers.back() };
+			buffer.events.resize(g_MaxEventsPerThread);
+			buffer.threadId = static_cast<uint32_t>(g_Buffers.size() - 1);
+			return buffer;
+		}
+
+		void Start(uint32_t maxEventsPerThread)
+		{
+			std::lock_guard lock{ g_RegistryMutex };
+			g_MaxEventsPerThread = maxEventsPerThread;
+			for (const auto& pBuffer : g_Buffers)
+			{
+				pBuffer->events.resize(maxEventsPerThread);
+				pBuffer->size.store(0, std::memory_order_relaxed);
+				pBuffer->nrOfDropped = 0;
+			}
+
+			g_StartTime = std::chrono::steady_clock::now();
+			g_IsEnabled.store(true, std::memory_order_release);
+		}
+
+		void Stop()
+		{
+			g_IsEnabled.store(false, std::memory_order_release);
+		}
+
+		void Record(const char* name, char type, uint32_t index)
+		{
+			thread_local ThreadBuffer& buffer{ RegisterThread() };
+
+			const uint32_t size{ buffer.size.load(std::memory_order_relaxed) };
+			if (size >= buffer.events.size())
+			{
+				++buffer.nrOfDropped;
+				return;
+			}
+
+			const auto timestamp{ std::chrono::steady_clock::now() - g_StartTime };
+			buffer.events[size] = Event{ name, static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(timestamp).count()), index, type };
+			buffer.size.store(size + 1, std::memory_order_release);
+		}
+
+		bool WriteJson(const std::string& filePath)
+		{
+			std::ofstream stream{ filePath };
+			if (!stream)
+			{
+				std::cout << "Could not open " << filePath << "\n";
+				return false;
+			}
+
+			std::lock_guard lock{ g_RegistryMutex };
+
+			//chrome wants microseconds, keep the ns as decimals
+			stream << std::fixed << std::setprecision(3);
+			stream << "{ \"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+
+			bool isFirst{ true };
+			uint64_t nrOfDropped{};
+			for (const auto& pBuffer : g_Buffers)
+			{
+				nrOfDropped += pBuffer->nrOfDropped;
+
+				stream << (isFirst ? "" : ",\n") << "{ \"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << pBuffer->threadId
+					<< ", \"args\": { \"name\": \"Thread " << pBuffer->threadId << "\" } }";
+				isFirst = false;
+
+				const uint32_t size{ pBuffer->size.load(std::memory_order_acquire) };
+				for (uint32_t idx{}; idx < size; ++idx)
+				{
+					const Event& event{ pBuffer->events[idx] };
+					stream << ",\n{ \"name\": \"" << event.name << "\", \"ph\": \"" << event.type << "\", \"ts\": " << event.timestamp / 1000.0
+						<< ", \"pid\": 1, \"tid\": " << pBuffer->threadId;
+					if (event.index != NoIndex)
+						stream << ", \"args\": { \"index\": " << event.index << " }";
+					stream << " }";
+				}
+			}
+			stream << "\n] }\n";
+
+			if (nrOfDropped > 0)
+			{
+				std::cout << "Trace buffers were full, " << nrOfDropped << " events dropped\n";
+			}
+			return static_cast<bool>(stream);
+		}
+	}
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace dae
+{
+	/**
+	 * \brief Opt-in timeline of begin/end events, written as Chrome trace JSON (chrome://tracing, Perfetto)
+	 * Every thread records into its own fixed-size buffer without locking, events past the end are dropped
+	 */
+	namespace Trace
+	{
+		inline constexpr uint32_t NoIndex{ UINT32_MAX };
+
+		struct Event
+		{
+			const char* name{}; //string literal, only the pointer is stored
+			uint64_t timestamp{}; //ns since Start
+			uint32_t index{ NoIndex }; //tile or job index, shown as an argument
+			char type{}; //'B'egin or 'E'nd
+		};
+
+		extern std::atomic<bool> g_IsEnabled;
+		inline bool IsEnabled() { return g_IsEnabled.load(std::memory_order_relaxed); }
+
+		//Start clears the buffers, only call Start, Stop and WriteJson while nothing is being recorded (between frames)
+		void Start(uint32_t maxEventsPerThread = 1 << 16);
+		void Stop();
+		bool WriteJson(const std::string& filePath);
+
+		void Record(const char* name, char type, uint32_t index = NoIndex);
+
+		//begin event now, end event when it goes out of scope
+		class Scope final
+		{
+		public:
+			explicit Scope(const char* name, uint32_t index = NoIndex) :
+				m_Name{ IsEnabled() ? name : nullptr },
+				m_Index{ index }
+			{
+				if (m_Name)
+					Record(m_Name, 'B', m_Index);
+			}
+
+			~Scope()
+			{
+				if (m_Name)
+					Record(m_Name, 'E', m_Index);
+			}
+
+			Scope(const Scope&) = delete;
+			Scope(Scope&&) noexcept = delete;
+			Scope& operator=(const Scope&) = delete;
+			Scope& operator=(Scope&&) noexcept = delete;
+
+		private:
+			const char* m_Name;
+			uint32_t m_Index;
+		};
+	}
+}
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SCOPE(...) ::dae::Trace::Scope TRACE_CONCAT(traceScope, __LINE__){ __VA_ARGS__ }
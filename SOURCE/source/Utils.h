@@ -3,6 +3,7 @@
 #include <fstream>
 #include "Math.h"
 #include "DataTypes.h"
+#include "RayStats.h"
 
 namespace dae
 {
@@ -308,8 +309,10 @@ namespace dae
 		inline bool HitTest_TriangleMesh(const TriangleMesh& mesh, const Ray& ray, HitRecord& hitRecord, bool ignoreHitRecord = false)
 		{
 			//SlabTest
+			RAY_STATS_ADD(boxTests, 1);
 			if (!SlabTest_TriangleMesh(mesh, ray))
 			{
+				RAY_STATS_ADD(earlyOuts, 1);
 				return false;
 			}
 			
@@ -332,6 +335,9 @@ namespace dae
 					tempTriangle.cullMode = mesh.cullMode;
 					if (HitTest_Triangle_MullerTrombore(tempTriangle, tempRay))
 					{
+						RAY_STATS_ADD(triangleTests, idx + 1);
+						RAY_STATS_ADD(hits, 1);
+						RAY_STATS_ADD(earlyOuts, 1);
 						return true;
 					}
 				}
@@ -351,9 +357,12 @@ namespace dae
 					if (HitTest_Triangle_MullerTrombore(tempTriangle, tempRay, hitRecord))
 					{
 						tempRay.max = hitRecord.t;
+						RAY_STATS_ADD(hits, 1);
 					}
 				}
 			}
+			//any-hit rays that get here missed every triangle, so both paths tested the full mesh
+			RAY_STATS_ADD(triangleTests, mesh.indices.size() / 3);
 			if (!hitRecord.didHit) 
 			{ 
 				return false; 
@@ -374,17 +383,19 @@ namespace dae
 
 	namespace LightUtils
 	{
-		//direction from target to light
+		constexpr bool IsAreaLight(const Light& light) { return light.type == LightType::Rect || light.type == LightType::Sphere; }
+
+		//direction from target to light (its center for area lights)
 		inline Vector3 GetDirectionToLight(const Light& light, const Vector3 origin)
 		{
 			switch (light.type)
 			{
-			case LightType::Point :
-				return (light.origin - origin);
-				break;
 			case LightType::Directional :
 				return (-light.direction);
 				break;
+			default :
+				return (light.origin - origin);
+				break;
 			}
 		}
 
@@ -392,13 +403,111 @@ namespace dae
 		{
 			switch (light.type)
 			{
-			case LightType::Point :
-				return light.color * (light.intensity /(light.origin - target).SqrMagnitude());
-				break;
 			case LightType::Directional :
 				return light.color * light.intensity;
 				break;
+			default :
+				return light.color * (light.intensity /(light.origin - target).SqrMagnitude());
+				break;
+			}
+		}
+
+		/**
+		 * \brief Distance from the light's origin past which it brings less than radianceThreshold to any point (in its brightest channel)
+		 * The 1 / d² falloff never reaches 0, the light can be culled past this. Area lights add their extent, their nearest point can be that much closer
+		 * \return FLT_MAX for directional lights or a threshold of 0, those reach everything
+		 */
+		inline float GetInfluenceRadius(const Light& light, float radianceThreshold)
+		{
+			if (light.type == LightType::Directional || radianceThreshold <= 0.f)
+				return FLT_MAX;
+
+			const float maxIntensity{ std::max({ light.color.r, light.color.g, light.color.b }) * light.intensity };
+			float extent{};
+			if (light.type == LightType::Rect)
+				extent = (light.halfWidth + light.halfHeight).Magnitude();
+			else if (light.type == LightType::Sphere)
+				extent = light.radius;
+			return sqrtf(maxIntensity / radianceThreshold) + extent;
+		}
+
+		//solid angle an area light covers seen from target, what its shadow sample budget scales with
+		inline float GetSolidAngle(const Light& light, const Vector3& target)
+		{
+			const Vector3 toLight{ light.origin - target };
+			const float sqrDistance{ toLight.SqrMagnitude() };
+			switch (light.type)
+			{
+			case LightType::Rect :
+			{
+				//the area seen from the center, good enough for a budget as long as the light isn't huge and close
+				const Vector3 normal{ Vector3::Cross(light.halfWidth, light.halfHeight) };
+				const float cosLight{ std::abs(Vector3::Dot(normal, toLight)) / (normal.Magnitude() * sqrtf(sqrDistance)) };
+				return std::min(4.f * normal.Magnitude() * cosLight / sqrDistance, PI_2);
+			}
+			case LightType::Sphere :
+				if (sqrDistance <= light.radius * light.radius)
+					return PI_4;
+				return PI_2 * (1.f - sqrtf(1.f - light.radius * light.radius / sqrDistance));
+			default :
+				return 0.f;
+			}
+		}
+
+		//one sample of the light seen from target, radiance is already divided by the sample's pdf so it adds up like a point light's
+		struct LightSample
+		{
+			Vector3 direction{}; //normalized
+			float distance{};
+			ColorRGB radiance{};
+		};
+
+		/**
+		 * \brief Point on an area light for the random numbers u and v in [0, 1), stratified u and v give stratified points
+		 * A rect gets sampled by area, a sphere by the cone of directions it covers, so only its visible half gets samples
+		 * \return false when the sample can't light target (the back of a rect, or target inside the sphere)
+		 */
+		inline bool SampleAreaLight(const Light& light, const Vector3& target, float u, float v, LightSample& sample)
+		{
+			if (light.type == LightType::Rect)
+			{
+				//radiance = intensity / area, pdf = 1 / area
+				const Vector3 point{ light.origin + light.halfWidth * (2.f * u - 1.f) + light.halfHeight * (2.f * v - 1.f) };
+				sample.direction = point - target;
+				const float sqrDistance{ sample.direction.SqrMagnitude() };
+				sample.distance = sample.direction.Normalize();
+
+				const float cosLight{ -Vector3::Dot(Vector3::Cross(light.halfWidth, light.halfHeight).Normalized(), sample.direction) };
+				if (cosLight <= 0.f)
+					return false;
+
+				sample.radiance = light.color * (light.intensity * cosLight / sqrDistance);
+				return true;
 			}
+
+			//sphere, radiance = intensity / (PI * radius²), pdf = 1 / cone solid angle
+			Vector3 toCenter{ light.origin - target };
+			const float sqrDistance{ toCenter.SqrMagnitude() };
+			const float sqrRadius{ light.radius * light.radius };
+			if (sqrDistance <= sqrRadius)
+				return false;
+			const float distance{ toCenter.Normalize() };
+
+			const float cosMax{ sqrtf(1.f - sqrRadius / sqrDistance) };
+			const float cosTheta{ 1.f - u * (1.f - cosMax) };
+			const float sinTheta{ sqrtf(std::max(1.f - cosTheta * cosTheta, 0.f)) };
+			const float phi{ PI_2 * v };
+
+			//any two axes perpendicular to the center direction
+			const Vector3 helper{ std::abs(toCenter.x) > .9f ? Vector3{ 0.f, 1.f, 0.f } : Vector3{ 1.f, 0.f, 0.f } };
+			const Vector3 tangent{ Vector3::Cross(helper, toCenter).Normalized() };
+			const Vector3 bitangent{ Vector3::Cross(toCenter, tangent) };
+			sample.direction = tangent * (sinTheta * cosf(phi)) + bitangent * (sinTheta * sinf(phi)) + toCenter * cosTheta;
+
+			//to the near side of the sphere
+			sample.distance = distance * cosTheta - sqrtf(std::max(sqrRadius - sqrDistance * sinTheta * sinTheta, 0.f));
+			sample.radiance = light.color * (light.intensity / (PI * sqrRadius) * PI_2 * (1.f - cosMax));
+			return true;
 		}
 	}
 
@@ -1,9 +1,19 @@
 #pragma once
+#include <cassert>
+#include <cmath>
+#include <type_traits>
+
+#include "Vector3.h"
+
+//x64 always has SSE2, define MATH_SCALAR to force the plain float fallback
+#if !defined(MATH_SCALAR) && (defined(_M_X64) || defined(__SSE2__))
+#define MATH_SSE
+#include <xmmintrin.h>
+#endif
 
 namespace dae
 {
-	struct Vector3;
-	struct Vector4
+	struct alignas(16) Vector4
 	{
 		float x;
 		float y;
@@ -11,22 +21,135 @@ namespace dae
 		float w;
 
 		Vector4() = default;
-		Vector4(float _x, float _y, float _z, float _w);
-		Vector4(const Vector3& v, float _w);
+		constexpr Vector4(float _x, float _y, float _z, float _w) : x(_x), y(_y), z(_z), w(_w) {}
+		constexpr Vector4(const Vector3& v, float _w) : x(v.x), y(v.y), z(v.z), w(_w) {}
+
+		float Magnitude() const
+		{
+			return sqrtf(Dot(*this, *this));
+		}
+
+		constexpr float SqrMagnitude() const
+		{
+			return Dot(*this, *this);
+		}
+
+		float Normalize()
+		{
+			const float m = Magnitude();
+			x /= m;
+			y /= m;
+			z /= m;
+			w /= m;
 
-		float Magnitude() const;
-		float SqrMagnitude() const;
-		float Normalize();
-		Vector4 Normalized() const;
+			return m;
+		}
 
-		static float Dot(const Vector4& v1, const Vector4& v2);
+		Vector4 Normalized() const
+		{
+			const float m = Magnitude();
+			return { x / m, y / m, z / m, w / m };
+		}
 
+		static constexpr float Dot(const Vector4& v1, const Vector4& v2)
+		{
+#if defined(MATH_SSE)
+			if (!std::is_constant_evaluated())
+			{
+				//(x*x + y*y) + (z*z + w*w)
+				const __m128 mul{ _mm_mul_ps(v1.Load(), v2.Load()) };
+				const __m128 pairs{ _mm_add_ps(mul, _mm_movehl_ps(mul, mul)) };
+				return _mm_cvtss_f32(_mm_add_ss(pairs, _mm_shuffle_ps(pairs, pairs, _MM_SHUFFLE(1, 1, 1, 1))));
+			}
+#endif
+			return { (v1.x * v2.x) + (v1.y * v2.y) + (v1.z * v2.z) + (v1.w * v2.w) };
+		}
+
+#if defined(MATH_SSE)
+		__m128 Load() const { return _mm_load_ps(&x); }
+		void Store(__m128 v) { _mm_store_ps(&x, v); }
+
+		static Vector4 FromSSE(__m128 v)
+		{
+			Vector4 result;
+			result.Store(v);
+			return result;
+		}
+#endif
+
+#pragma region Operator Overloads
 		// operator overloading
-		Vector4 operator*(float scale) const;
-		Vector4 operator+(const Vector4& v) const;
-		Vector4 operator-(const Vector4& v) const;
-		Vector4& operator+=(const Vector4& v);
-		float& operator[](int index);
-		float operator[](int index) const;
+		constexpr Vector4 operator*(float scale) const
+		{
+#if defined(MATH_SSE)
+			if (!std::is_constant_evaluated())
+			{
+				return FromSSE(_mm_mul_ps(Load(), _mm_set1_ps(scale)));
+			}
+#endif
+			return { x * scale, y * scale, z * scale, w * scale };
+		}
+
+		constexpr Vector4 operator+(const Vector4& v) const
+		{
+#if defined(MATH_SSE)
+			if (!std::is_constant_evaluated())
+			{
+				return FromSSE(_mm_add_ps(Load(), v.Load()));
+			}
+#endif
+			return { x + v.x, y + v.y, z + v.z, w + v.w };
+		}
+
+		constexpr Vector4 operator-(const Vector4& v) const
+		{
+#if defined(MATH_SSE)
+			if (!std::is_constant_evaluated())
+			{
+				return FromSSE(_mm_sub_ps(Load(), v.Load()));
+			}
+#endif
+			return { x - v.x, y - v.y, z - v.z, w - v.w };
+		}
+
+		constexpr Vector4& operator+=(const Vector4& v)
+		{
+			*this = *this + v;
+			return *this;
+		}
+
+		constexpr float& operator[](int index)
+		{
+			assert(index <= 3 && index >= 0);
+
+			if (index == 0)return x;
+			if (index == 1)return y;
+			if (index == 2)return z;
+			return w;
+		}
+
+		constexpr float operator[](int index) const
+		{
+			assert(index <= 3 && index >= 0);
+
+			if (index == 0)return x;
+			if (index == 1)return y;
+			if (index == 2)return z;
+			return w;
+		}
+#pragma endregion
 	};
+
+	//Vector3 <> Vector4 conversions, need both types to be complete
+	constexpr Vector3::Vector3(const Vector4& v) : x(v.x), y(v.y), z(v.z) {}
+
+	constexpr Vector4 Vector3::ToPoint4() const
+	{
+		return { x, y, z, 1 };
+	}
+
+	constexpr Vector4 Vector3::ToVector4() const
+	{
+		return { x, y, z, 0 };
+	}
 }
@@ -6,11 +6,19 @@
 
 //Standard includes
 #include <iostream>
+#include <stdexcept>
+#include <string>
 
 //Project includes
 #include "Timer.h"
 #include "Renderer.h"
 #include "Scene.h"
+#include "MicroBenchmark.h"
+#include "Headless.h"
+#include "Benchmark.h"
+#include "ImageDiff.h"
+#include "Convergence.h"
+#include "Trace.h"
 
 using namespace dae;
 
@@ -22,9 +30,67 @@ void ShutDown(SDL_Window* pWindow)
 
 int main(int argc, char* args[])
 {
-	//Unreferenced parameters
-	(void)argc;
-	(void)args;
+	//Headless microbenchmarks, runs without creating a window
+	if (argc > 1 && std::string{ args[1] } == "--microbench")
+	{
+		if (argc <= 2)
+		{
+			MicroBenchmark::RunIntersectionBenchmarks();
+			return 0;
+		}
+
+		int numRays{};
+		try
+		{
+			numRays = std::stoi(args[2]);
+		}
+		catch (const std::exception&)
+		{
+		}
+		if (numRays <= 0)
+		{
+			std::cout << "Usage: --microbench [rays], the ray count has to be a positive number\n";
+			return 1;
+		}
+		MicroBenchmark::RunIntersectionBenchmarks(numRays);
+		return 0;
+	}
+
+	//Offscreen rendering, for machines without a display
+	if (argc > 1 && std::string{ args[1] } == "--headless")
+	{
+		Headless::Settings settings{};
+		if (!Headless::ParseArguments(argc, args, 2, settings))
+			return 1;
+		return Headless::Run(settings);
+	}
+
+	//Fixed camera paths + frame counts over a set of scenes and thread counts, results as JSON
+	if (argc > 1 && std::string{ args[1] } == "--benchmark")
+	{
+		Benchmark::Settings settings{};
+		if (!Benchmark::ParseArguments(argc, args, 2, settings))
+			return 1;
+		return Benchmark::Run(settings);
+	}
+
+	//Compares renders against golden images, fails when a scene changed beyond the tolerances
+	if (argc > 1 && std::string{ args[1] } == "--imagediff")
+	{
+		ImageDiff::Settings settings{};
+		if (!ImageDiff::ParseArguments(argc, args, 2, settings))
+			return 1;
+		return ImageDiff::Run(settings);
+	}
+
+	//Measures how fast every sampler converges on a still scene
+	if (argc > 1 && std::string{ args[1] } == "--convergence")
+	{
+		Convergence::Settings settings{};
+		if (!Convergence::ParseArguments(argc, args, 2, settings))
+			return 1;
+		return Convergence::Run(settings);
+	}
 
 	//Create window + surfaces
 	SDL_Init(SDL_INIT_VIDEO);
@@ -52,6 +118,8 @@ int main(int argc, char* args[])
 	pTimer->Start();
 
 	float printTimer = 0.f;
+	uint64_t nrOfRays = 0;
+	uint64_t nrOfSamples = 0;
 	bool isLooping = true;
 	bool takeScreenshot = false;
 	while (isLooping)
@@ -68,6 +136,11 @@ int main(int argc, char* args[])
 			case SDL_KEYUP:
 				if(e.key.keysym.scancode == SDL_SCANCODE_X)
 					takeScreenshot = true;
+				if (e.key.keysym.scancode == SDL_SCANCODE_F1)
+				{
+					pRenderer->CycleSampler();
+					std::cout << "**SAMPLER** " << GetSamplerName(pRenderer->GetSampler()) << std::endl;
+				}
 				if(e.key.keysym.scancode == SDL_SCANCODE_F2)
 				{
 					pRenderer->ToggleShadows();
@@ -76,28 +149,130 @@ int main(int argc, char* args[])
 				{
 					pRenderer->CycleLightingMode();
 				}
+				if (e.key.keysym.scancode == SDL_SCANCODE_F4)
+				{
+					pRenderer->CycleToneMapping();
+				}
+				if (e.key.keysym.scancode == SDL_SCANCODE_F5)
+				{
+					pRenderer->ToggleSrgb();
+				}
+				if (e.key.keysym.scancode == SDL_SCANCODE_F9)
+				{
+					pRenderer->ToggleReflections();
+				}
+				if (e.key.keysym.scancode == SDL_SCANCODE_F10)
+				{
+					pRenderer->ToggleProgressive();
+					std::cout << (pRenderer->IsProgressive() ? "**PROGRESSIVE ON**" : "**PROGRESSIVE OFF**") << std::endl;
+				}
+				if (e.key.keysym.scancode == SDL_SCANCODE_F11)
+				{
+					pRenderer->ToggleAdaptiveSampling();
+					std::cout << (pRenderer->IsAdaptiveSampling() ? "**ADAPTIVE SAMPLING ON**" : "**ADAPTIVE SAMPLING OFF**") << std::endl;
+				}
+				if (e.key.keysym.scancode == SDL_SCANCODE_F12)
+				{
+					pRenderer->ToggleSampleHeatmap();
+				}
+				if (e.key.keysym.scancode == SDL_SCANCODE_N)
+				{
+					pRenderer->ToggleDenoiser();
+					std::cout << (pRenderer->IsDenoising() ? "**DENOISER ON**" : "**DENOISER OFF**") << std::endl;
+				}
+				if (e.key.keysym.scancode == SDL_SCANCODE_T)
+				{
+					pRenderer->ToggleTemporalDenoising();
+					std::cout << (pRenderer->IsTemporalDenoising() ? "**TEMPORAL DENOISING ON**" : "**TEMPORAL DENOISING OFF**") << std::endl;
+				}
+				if (e.key.keysym.scancode == SDL_SCANCODE_L)
+				{
+					pRenderer->ToggleLightTree();
+					std::cout << (pRenderer->IsLightTreeEnabled() ? "**LIGHT TREE ON**" : "**LIGHT TREE OFF**") << std::endl;
+				}
+				if (e.key.keysym.scancode == SDL_SCANCODE_R)
+				{
+					pRenderer->ToggleLightResampling();
+					std::cout << (pRenderer->IsLightResampling() ? "**LIGHT RESAMPLING ON**" : "**LIGHT RESAMPLING OFF**") << std::endl;
+				}
+				if (e.key.keysym.scancode == SDL_SCANCODE_C)
+				{
+					pRenderer->ToggleLightCulling();
+					std::cout << (pRenderer->IsLightCulling() ? "**LIGHT CULLING ON**" : "**LIGHT CULLING OFF**") << std::endl;
+				}
 				if (e.key.keysym.scancode == SDL_SCANCODE_F6)
 				{
 					// Start Benchmark
 					pTimer->StartBenchmark();
 				}
+				if (e.key.keysym.scancode == SDL_SCANCODE_F7)
+				{
+					pTimer->PrintFrameTimeStats();
+					if (pTimer->SaveFrameTimesToCsv("frametimes.csv"))
+						std::cout << "Frame times saved!" << std::endl;
+					else
+						std::cout << "Something went wrong. Frame times not saved!" << std::endl;
+				}
+				if (e.key.keysym.scancode == SDL_SCANCODE_F8)
+				{
+					//first press starts recording, the second one writes the trace
+					if (!Trace::IsEnabled())
+					{
+						Trace::Start();
+						std::cout << "**TRACE STARTED**" << std::endl;
+					}
+					else
+					{
+						Trace::Stop();
+						if (Trace::WriteJson("trace.json"))
+							std::cout << "Trace saved!" << std::endl;
+					}
+				}
 				break;
 			}
 		}
 
 		//--------- Update ---------
-		pScene->Update(pTimer);
+		pTimer->StartPhase(FramePhase::Update);
+		{
+			TRACE_SCOPE("Scene::Update");
+			pScene->Update(pTimer);
+		}
+		pTimer->EndPhase(FramePhase::Update);
 
 		//--------- Render ---------
+		pTimer->StartPhase(FramePhase::Render);
 		pRenderer->Render(pScene);
+		pTimer->EndPhase(FramePhase::Render);
+
+		pTimer->StartPhase(FramePhase::Present);
+		pRenderer->Present();
+		pTimer->EndPhase(FramePhase::Present);
 
 		//--------- Timer ---------
 		pTimer->Update();
 		printTimer += pTimer->GetElapsed();
+		nrOfRays += pRenderer->GetFrameCounters().GetNrOfRays();
+		nrOfSamples += pRenderer->GetNrOfFrameSamples();
 		if (printTimer >= 1.f)
 		{
-			printTimer = 0.f;
+#if defined(RAY_STATS)
+			std::cout << "dFPS: " << pTimer->GetdFPS() << ", Mrays/s: " << nrOfRays / (printTimer * 1'000'000.f) << std::endl;
+#else
 			std::cout << "dFPS: " << pTimer->GetdFPS() << std::endl;
+#endif
+			if (pRenderer->IsProgressive())
+			{
+				std::cout << "Samples/pixel: " << pRenderer->GetSamplesPerPixel() << ", Msamples/s: " << nrOfSamples / (printTimer * 1'000'000.f)
+					<< ", noise: " << pRenderer->EstimateNoise() * 100.f << "%" << std::endl;
+			}
+			if (pRenderer->IsDenoising())
+			{
+				std::cout << "Denoise: " << pRenderer->GetDenoiseTime() << " ms" << std::endl;
+			}
+			printTimer = 0.f;
+			nrOfRays = 0;
+			nrOfSamples = 0;
 		}
 
 		//Save screenshot after full render